@@ -1,10 +1,15 @@
+#include "../src/metrics/thread_stats.hpp"
 #include "../src/node/capture_node.hpp"
 #include "market_data_simulator.hpp"
+#include "simulator_process.hpp"
+#include "soak_monitor.hpp"
 #include <boost/program_options.hpp>
 #include <chrono>
 #include <fmt/format.h>
 #include <fstream>
 #include <iostream>
+#include <map>
+#include <optional>
 
 namespace po = boost::program_options;
 using namespace tick_capture;
@@ -18,6 +23,23 @@ struct BenchmarkResult {
   double avg_latency_ns;
   uint64_t dropped_messages;
   std::chrono::microseconds run_time;
+
+  // CPU and scheduling cost of each pipeline stage over the run, keyed by
+  // thread name (threads of a stage, e.g. io-N, are kept apart)
+  struct StageUsage {
+    std::chrono::nanoseconds cpu_time{0};
+    uint64_t voluntary_switches = 0;
+    uint64_t involuntary_switches = 0;
+    uint64_t allocations = 0;
+  };
+  std::map<std::string, StageUsage> stages;
+  size_t start_rss_bytes = 0;
+  size_t end_rss_bytes = 0;
+  size_t peak_rss_bytes = 0;
+
+  // Allocations by the process thread after warm-up, unset if the run
+  // ended before warm-up did
+  std::optional<uint64_t> steady_process_allocations;
 };
 
 class BenchmarkRunner {
@@ -53,6 +75,22 @@ public:
     bool measure_latency = false;
     bool verify_messages = true;
     bool verbose_logging = true;
+    bool fixed_point_prices = false;
+    std::string trace_path; // Chrome trace per run, if set
+    uint32_t trace_sample_every = 1000;
+
+    // Run the simulator in a forked process, optionally pinning it and the
+    // capture node to disjoint CPUs (empty lists leave affinity alone)
+    bool fork_simulator = false;
+    std::vector<int> simulator_cpus;
+    std::vector<int> capture_cpus;
+
+    // Soak mode: one session of soak_duration (0 runs the benchmark
+    // instead), sampled every sample_interval. With soak_step set, the rate
+    // cycles through rates, moving on every soak_step.
+    std::chrono::seconds soak_duration{0};
+    std::chrono::seconds sample_interval{60};
+    std::chrono::seconds soak_step{0};
   };
 
   explicit BenchmarkRunner(const Config &config) : config_(config) {
@@ -63,20 +101,35 @@ public:
     fmt::print("\nStarting benchmark at {} msgs/sec for {} seconds\n",
                target_rate, config_.duration.count());
 
-    // Setup simulator config
-    MarketDataSimulator::Config sim_config;
-    sim_config.base_msg_rate = target_rate;
-    sim_config.num_symbols = 10;
-    sim_config.burst_size = 0;
-
-    // Setup capture config
-    CaptureConfig capture_config;
-    capture_config.output_dir =
-        fmt::format("{}/bench_{}", config_.output_dir, target_rate);
+    const auto sim_config = make_sim_config(target_rate);
+    auto capture_config = make_capture_config(
+        fmt::format("{}/bench_{}", config_.output_dir, target_rate));
     capture_config.enable_timestamps = config_.measure_latency;
+    if (!config_.trace_path.empty()) {
+      capture_config.trace_sample_every = config_.trace_sample_every;
+    }
 
-    // Create components
-    auto simulator = std::make_unique<MarketDataSimulator>(sim_config);
+    // The simulator can run well past its target rate; the sent-message
+    // log is only backed by memory as it fills
+    const size_t log_capacity =
+        std::max<size_t>(target_rate * 2ul, 1'000'000) *
+            config_.duration.count() +
+        65536;
+
+    // Create components. The simulator process is forked while this is
+    // still the only thread; capture threads inherit the pinning.
+    std::unique_ptr<MarketDataSimulator> simulator;
+    std::unique_ptr<SharedMessageLog> sent_log;
+    std::unique_ptr<SimulatorProcess> simulator_process;
+    if (config_.fork_simulator) {
+      simulator_process = fork_simulator(sim_config, log_capacity);
+    } else {
+      simulator = std::make_unique<MarketDataSimulator>(sim_config);
+      sent_log = std::make_unique<SharedMessageLog>(log_capacity);
+      simulator->record_to(sent_log.get());
+    }
+    const SharedMessageLog &message_log =
+        simulator_process ? simulator_process->message_log() : *sent_log;
     auto capture_node = std::make_unique<CaptureNode>(capture_config);
 
     // Start capture first
@@ -87,16 +140,57 @@ public:
 
     // Start simulation and timing
     const auto start_time = std::chrono::high_resolution_clock::now();
-    simulator->start();
+    if (simulator_process) {
+      simulator_process->start();
+    } else {
+      simulator->start();
+    }
+    const auto threads_before = sample_threads();
+    const size_t start_rss = resident_set_bytes();
+    size_t peak_rss = start_rss;
+
+    // Warm-up ends a sample after every symbol has a tick file, which the
+    // process thread opens on a symbol's first tick
+    std::optional<std::vector<ThreadUsage>> threads_warm;
+    bool files_open = false;
+
+    // Run for specified duration, sampling RSS along the way
+    const auto deadline = start_time + config_.duration;
+    while (std::chrono::high_resolution_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::min<std::chrono::nanoseconds>(
+          std::chrono::milliseconds(250),
+          deadline - std::chrono::high_resolution_clock::now()));
+      peak_rss = std::max(peak_rss, resident_set_bytes());
+      if (files_open && !threads_warm) {
+        threads_warm = sample_threads();
+      }
+      files_open = count_tick_files(capture_config.output_dir) >=
+                   sim_config.num_symbols;
+    }
 
-    // Run for specified duration
-    std::this_thread::sleep_for(config_.duration);
+    // Threads exit on stop, so take their totals first
+    const auto threads_after = sample_threads();
+    const size_t end_rss = resident_set_bytes();
 
     // Stop components in reverse order
-    simulator->stop();
+    if (simulator_process) {
+      simulator_process->stop();
+    } else {
+      simulator->stop();
+    }
     std::this_thread::sleep_for(
         std::chrono::milliseconds(100)); // Allow time for last messages
     capture_node->stop();
+    if (simulator_process) {
+      unpin_capture();
+    }
+
+    if (!config_.trace_path.empty()) {
+      const auto trace_path =
+          fmt::format("{}.{}.json", config_.trace_path, target_rate);
+      capture_node->export_trace(trace_path);
+      fmt::print("Wrote stage trace to {}\n", trace_path);
+    }
 
     const auto end_time = std::chrono::high_resolution_clock::now();
     const auto run_time = std::chrono::duration_cast<std::chrono::microseconds>(
@@ -105,7 +199,9 @@ public:
     // Calculate results
     BenchmarkResult result;
     result.target_rate = target_rate;
-    result.messages_sent = simulator->get_stats().messages_sent;
+    result.messages_sent = simulator_process
+                               ? simulator_process->get_stats().messages_sent
+                               : simulator->get_stats().messages_sent;
 
     auto capture_stats = capture_node->get_stats();
     result.messages_captured = capture_stats.messages_processed;
@@ -115,11 +211,40 @@ public:
                           static_cast<double>(result.messages_sent) * 100.0;
 
     result.run_time = run_time;
+    const auto &latency =
+        capture_node->metrics().histogram("process.latency_ns");
+    result.avg_latency_ns =
+        latency.count() > 0
+            ? static_cast<double>(latency.sum()) / latency.count()
+            : 0.0;
+    result.stages = stage_usage(threads_before, threads_after);
+    result.start_rss_bytes = start_rss;
+    result.end_rss_bytes = end_rss;
+    result.peak_rss_bytes = peak_rss;
+    if (threads_warm) {
+      const auto steady = stage_usage(*threads_warm, threads_after);
+      const auto it = steady.find("process");
+      result.steady_process_allocations =
+          it != steady.end() ? it->second.allocations : 0;
+    }
+
+    if (simulator_process) {
+      // Its threads are not ours to sample; the child reports its own usage
+      const auto stats = simulator_process->get_stats();
+      auto &stage = result.stages["simulator"];
+      stage.cpu_time = stats.cpu_time;
+      stage.voluntary_switches = stats.voluntary_switches;
+      stage.involuntary_switches = stats.involuntary_switches;
+      stage.allocations = stats.allocations;
+    }
+    if (const auto overflowed = message_log.overflowed()) {
+      fmt::print("Sent message log overflowed by {} messages\n", overflowed);
+    }
 
     // Verify captured messages if enabled
     if (config_.verify_messages) {
-      verify_capture(simulator->get_message_log(), capture_config.output_dir,
-                     sim_config);
+      verify_capture(message_log, capture_config.output_dir,
+                     capture_config.max_symbol_id, sim_config);
     }
 
     return result;
@@ -139,6 +264,63 @@ public:
     if (result.avg_latency_ns > 0) {
       fmt::print("Average Latency: {:.2f} ns\n", result.avg_latency_ns);
     }
+    if (result.steady_process_allocations) {
+      fmt::print("Process Allocations After Warm-up: {}\n",
+                 *result.steady_process_allocations);
+    }
+
+    print_efficiency(result);
+  }
+
+  // Per-stage CPU seconds, share of wall time, messages per CPU-second,
+  // context switches and heap allocations, plus process RSS. Stages are
+  // sampled while the simulator runs, so wall time here is the configured
+  // duration.
+  void print_efficiency(const BenchmarkResult &result) {
+    if (result.stages.empty())
+      return;
+
+    const double wall_s =
+        std::chrono::duration<double>(config_.duration).count();
+    double total_cpu_s = 0;
+
+    fmt::print("\nThread Efficiency:\n");
+    fmt::print("  {:<16} {:>9} {:>7} {:>14} {:>9} {:>9} {:>9}\n", "thread",
+               "cpu s", "% wall", "msgs/cpu-s", "vol cs", "invol cs",
+               "allocs");
+    for (const auto &[name, usage] : result.stages) {
+      const double cpu_s =
+          std::chrono::duration<double>(usage.cpu_time).count();
+      total_cpu_s += cpu_s;
+
+      // Messages each stage handles: the simulator sends, the capture and
+      // processing threads see what was captured
+      uint64_t messages = 0;
+      if (name == "simulator") {
+        messages = result.messages_sent;
+      } else if (name == "capture" || name == "process") {
+        messages = result.messages_captured;
+      }
+      const std::string per_cpu_s =
+          messages > 0 && cpu_s > 0 ? fmt::format("{:.0f}", messages / cpu_s)
+                                    : "-";
+      fmt::print("  {:<16} {:>9.4f} {:>6.2f}% {:>14} {:>9} {:>9} {:>9}\n",
+                 name, cpu_s, cpu_s / wall_s * 100.0, per_cpu_s,
+                 usage.voluntary_switches, usage.involuntary_switches,
+                 usage.allocations);
+    }
+
+    fmt::print("  Total CPU: {:.4f} s ({:.2f} cores)\n", total_cpu_s,
+               total_cpu_s / wall_s);
+    if (result.messages_captured > 0 && total_cpu_s > 0) {
+      fmt::print("  Captured msgs per CPU-second: {:.0f}\n",
+                 result.messages_captured / total_cpu_s);
+    }
+    fmt::print("  RSS: {:.1f} MiB at start, {:.1f} MiB at end, "
+               "{:.1f} MiB peak\n",
+               result.start_rss_bytes / 1048576.0,
+               result.end_rss_bytes / 1048576.0,
+               result.peak_rss_bytes / 1048576.0);
   }
 
   void log_message_sample(const MarketMessage &msg, const char *prefix) {
@@ -147,25 +329,248 @@ public:
                msg.trade.price, msg.trade.size);
   }
 
+  // Run a single capture session for config_.soak_duration and sample its
+  // health every config_.sample_interval, printing each sample and writing
+  // them to soak.csv in the output directory. Returns the number of drift
+  // or growth findings.
+  size_t run_soak() {
+    using namespace std::chrono;
+    fmt::print("\nStarting soak at {} msgs/sec for {:.1f} minutes, sampling "
+               "every {} seconds\n",
+               config_.rates.front(),
+               duration<double, std::ratio<60>>(config_.soak_duration).count(),
+               config_.sample_interval.count());
+
+    // No sent-message log: it would grow for the whole soak
+    const auto sim_config = make_sim_config(config_.rates.front());
+    auto capture_config =
+        make_capture_config(fmt::format("{}/soak", config_.output_dir));
+    capture_config.enable_timestamps = true; // For latency percentiles
+
+    std::unique_ptr<MarketDataSimulator> simulator;
+    std::unique_ptr<SimulatorProcess> simulator_process;
+    if (config_.fork_simulator) {
+      simulator_process = fork_simulator(sim_config, 0);
+    } else {
+      simulator = std::make_unique<MarketDataSimulator>(sim_config);
+    }
+    CaptureNode capture_node(capture_config);
+    SoakMonitor monitor(
+        std::filesystem::path(config_.output_dir) / "soak.csv");
+    auto &latency = capture_node.metrics().histogram("process.latency_ns");
+
+    const auto messages_sent = [&] {
+      return simulator_process ? simulator_process->messages_sent()
+                               : simulator->get_stats().messages_sent;
+    };
+
+    capture_node.start();
+    std::this_thread::sleep_for(milliseconds(100));
+    if (simulator_process) {
+      simulator_process->start();
+    } else {
+      simulator->start();
+    }
+
+    // Counters at the start of the current interval
+    const auto start = steady_clock::now();
+    auto last_time = start;
+    uint64_t last_sent = 0;
+    CaptureStats last_stats{};
+    uint64_t last_written = bytes_written();
+    auto last_latency = latency.snapshot();
+    capture_node.take_ring_high_water();
+    uint32_t rate = config_.rates.front();
+
+    for (auto next_sample = start + config_.sample_interval;
+         next_sample <= start + config_.soak_duration;
+         next_sample += config_.sample_interval) {
+      std::this_thread::sleep_until(next_sample);
+
+      const auto now = steady_clock::now();
+      const double interval_s = duration<double>(now - last_time).count();
+      const uint64_t sent = messages_sent();
+      const auto stats = capture_node.get_stats();
+      const uint64_t written = bytes_written();
+      const auto latency_now = latency.snapshot();
+      const auto window = latency_now - last_latency;
+
+      SoakSample sample;
+      sample.elapsed = duration_cast<seconds>(now - start);
+      sample.target_rate = rate;
+      sample.sent_per_sec = (sent - last_sent) / interval_s;
+      sample.captured_per_sec =
+          (stats.messages_processed - last_stats.messages_processed) /
+          interval_s;
+      sample.dropped = stats.messages_dropped - last_stats.messages_dropped;
+      sample.latency_p50_ns = window.percentile(0.5);
+      sample.latency_p99_ns = window.percentile(0.99);
+      sample.latency_p999_ns = window.percentile(0.999);
+      sample.rss_bytes = resident_set_bytes();
+      sample.open_fds = open_fd_count();
+      sample.ring_high_water = capture_node.take_ring_high_water();
+      sample.write_bytes_per_sec = (written - last_written) / interval_s;
+      monitor.add(sample);
+      print_soak_sample(sample);
+
+      last_time = now;
+      last_sent = sent;
+      last_stats = stats;
+      last_written = written;
+      last_latency = latency_now;
+
+      // Profile steps take effect from the first sample after each boundary
+      if (config_.soak_step.count() > 0 &&
+          now - start < config_.soak_duration) {
+        const auto step =
+            static_cast<size_t>((now - start) / config_.soak_step);
+        const uint32_t next_rate = config_.rates[step % config_.rates.size()];
+        if (next_rate != rate) {
+          rate = next_rate;
+          if (simulator_process) {
+            simulator_process->set_rate(rate);
+          } else {
+            simulator->set_rate(rate);
+          }
+          fmt::print("Soak rate now {} msgs/sec\n", rate);
+        }
+      }
+    }
+
+    if (simulator_process) {
+      simulator_process->stop();
+    } else {
+      simulator->stop();
+    }
+    std::this_thread::sleep_for(milliseconds(100));
+    capture_node.stop();
+    if (simulator_process) {
+      unpin_capture();
+    }
+
+    const auto findings = monitor.findings();
+    fmt::print("\nSoak Results ({} samples):\n", monitor.samples().size());
+    for (const auto &finding : findings) {
+      fmt::print("  {}\n", finding);
+    }
+    if (findings.empty()) {
+      fmt::print("  No drift or resource growth detected\n");
+    }
+    return findings.size();
+  }
+
 private:
-  bool is_valid_tick_file(const std::filesystem::path &path) {
+  MarketDataSimulator::Config make_sim_config(uint32_t rate) const {
+    MarketDataSimulator::Config sim_config;
+    sim_config.base_msg_rate = rate;
+    sim_config.num_symbols = 10;
+    sim_config.burst_size = 0;
+    return sim_config;
+  }
+
+  CaptureConfig make_capture_config(const std::string &output_dir) const {
+    CaptureConfig capture_config;
+    capture_config.output_dir = output_dir;
+    if (config_.fixed_point_prices) {
+      capture_config.price_encoding = PriceEncoding::FixedPoint;
+    }
+    return capture_config;
+  }
+
+  // Fork the simulator onto its CPUs and move this thread, and so the
+  // capture threads it starts, onto the capture CPUs
+  std::unique_ptr<SimulatorProcess>
+  fork_simulator(const MarketDataSimulator::Config &sim_config,
+                 size_t log_capacity) {
+    auto process = std::make_unique<SimulatorProcess>(
+        sim_config, log_capacity, config_.simulator_cpus);
+    if (!config_.capture_cpus.empty()) {
+      pin_to_cpus(config_.capture_cpus);
+    }
+    return process;
+  }
+
+  // The next run forks from an unpinned thread
+  void unpin_capture() {
+    if (!config_.capture_cpus.empty()) {
+      pin_to_cpus({});
+    }
+  }
+
+  static void print_soak_sample(const SoakSample &sample) {
+    const auto elapsed = sample.elapsed.count();
+    fmt::print("[{:02}:{:02}:{:02}] rate {} sent {:.0f}/s captured {:.0f}/s "
+               "dropped {} latency p50/p99/p99.9 {}/{}/{} us rss {:.1f} MiB "
+               "fds {} ring hw {} write {:.1f} KiB/s\n",
+               elapsed / 3600, elapsed / 60 % 60, elapsed % 60,
+               sample.target_rate, sample.sent_per_sec,
+               sample.captured_per_sec, sample.dropped,
+               sample.latency_p50_ns / 1000, sample.latency_p99_ns / 1000,
+               sample.latency_p999_ns / 1000,
+               sample.rss_bytes / 1048576.0, sample.open_fds,
+               sample.ring_high_water, sample.write_bytes_per_sec / 1024.0);
+  }
+
+  // Usage accrued between two samples, per thread name. Threads started
+  // after the first sample count from zero.
+  static std::map<std::string, BenchmarkResult::StageUsage>
+  stage_usage(const std::vector<ThreadUsage> &before,
+              const std::vector<ThreadUsage> &after) {
+    std::map<pid_t, const ThreadUsage *> start;
+    for (const auto &thread : before) {
+      start[thread.tid] = &thread;
+    }
+
+    std::map<std::string, BenchmarkResult::StageUsage> stages;
+    for (const auto &thread : after) {
+      auto &stage = stages[thread.name];
+      stage.cpu_time += thread.cpu_time;
+      stage.voluntary_switches += thread.voluntary_switches;
+      stage.involuntary_switches += thread.involuntary_switches;
+      stage.allocations += thread.allocations;
+
+      const auto it = start.find(thread.tid);
+      if (it != start.end()) {
+        stage.cpu_time -= it->second->cpu_time;
+        stage.voluntary_switches -= it->second->voluntary_switches;
+        stage.involuntary_switches -= it->second->involuntary_switches;
+        stage.allocations -= it->second->allocations;
+      }
+    }
+    return stages;
+  }
+
+  static size_t count_tick_files(const std::string &dir) {
+    std::error_code ec;
+    size_t count = 0;
+    for (std::filesystem::directory_iterator it(dir, ec), end;
+         !ec && it != end; it.increment(ec)) {
+      count += it->path().extension() == ".tick";
+    }
+    return count;
+  }
+
+  bool is_valid_tick_file(const std::filesystem::path &path,
+                          uint32_t max_symbol_id) {
     try {
       // Extract symbol id from filename
       auto stem = path.stem().string();
       auto symbol_id = std::stoul(stem);
-      return symbol_id > 0 && symbol_id <= 10000;
+      return symbol_id > 0 && symbol_id <= max_symbol_id;
     } catch (...) {
       return false;
     }
   }
 
-  void verify_capture(const MarketDataSimulator::MessageLog &sent_messages,
+  void verify_capture(const SharedMessageLog &sent_messages,
                       const std::string &capture_dir,
+                      uint32_t max_symbol_id,
                       const MarketDataSimulator::Config
                           &sim_config) { // Added sim_config parameter
 
     fmt::print("\nStarting message verification...\n");
     fmt::print("Verifying files in: {}\n", capture_dir);
+    const auto meta = SessionMeta::load(capture_dir);
 
     struct Stats {
       uint64_t total_read = 0;
@@ -173,6 +578,8 @@ private:
       uint64_t invalid_messages = 0;
       uint64_t mismatches = 0;
       uint64_t missing_sent = 0;
+      uint64_t corrupt_blocks = 0;
+      uint64_t verified_bytes = 0;
       uint64_t min_seq = UINT64_MAX;
       uint64_t max_seq = 0;
     } stats;
@@ -181,12 +588,21 @@ private:
     std::vector<std::filesystem::path> tick_files;
     for (const auto &entry : std::filesystem::directory_iterator(capture_dir)) {
       if (entry.path().extension() == ".tick" &&
-          is_valid_tick_file(entry.path())) {
+          is_valid_tick_file(entry.path(), max_symbol_id)) {
         tick_files.push_back(entry.path());
         fmt::print("Found valid tick file: {}\n", entry.path().string());
       }
     }
 
+    // Check every sealed block against its stored checksum
+    Scrubber::Config scrub_config;
+    scrub_config.bytes_per_second = 0;
+    Scrubber scrubber(scrub_config);
+    for (const auto &file_path : tick_files) {
+      stats.corrupt_blocks += scrubber.scrub_file(file_path).size();
+    }
+    stats.verified_bytes = scrubber.get_stats().bytes;
+
     // First pass - validate basic message structure
     for (const auto &file_path : tick_files) {
       std::ifstream file(file_path, std::ios::binary);
@@ -203,12 +619,12 @@ private:
         if (file_messages <= 5) {
           fmt::print("Read message {}: seq={}, sym={}, price={:.2f}, size={}\n",
                      file_messages, msg.sequence_number, msg.symbol_id,
-                     msg.trade.price, msg.trade.size);
+                     meta.price(msg), msg.trade.size);
         }
 
         if (msg.sequence_number > 0 && msg.symbol_id > 0 &&
-            msg.symbol_id <= 10000 && msg.type == MessageType::Trade &&
-            msg.trade.price > 0) {
+            msg.symbol_id <= max_symbol_id &&
+            msg.type == MessageType::Trade && meta.price(msg) > 0) {
 
           stats.valid_messages++;
           stats.min_seq = std::min(stats.min_seq, msg.sequence_number);
@@ -220,7 +636,7 @@ private:
                        "price={:.2f}\n",
                        file_path.filename().string(), msg.sequence_number,
                        msg.symbol_id, static_cast<int>(msg.type),
-                       msg.trade.price);
+                       meta.price(msg));
           }
         }
       }
@@ -232,6 +648,8 @@ private:
     fmt::print("  Total messages read: {}\n", stats.total_read);
     fmt::print("  Valid messages: {}\n", stats.valid_messages);
     fmt::print("  Invalid messages: {}\n", stats.invalid_messages);
+    fmt::print("  Checksummed bytes: {} Corrupt blocks: {}\n",
+               stats.verified_bytes, stats.corrupt_blocks);
 
     if (stats.valid_messages > 0) {
       fmt::print("  Sequence range: {} to {}\n", stats.min_seq, stats.max_seq);
@@ -247,16 +665,15 @@ private:
             if (msg.sequence_number > 0 && msg.symbol_id > 0 &&
                 msg.symbol_id <=
                     sim_config.num_symbols && // Using sim_config here
-                msg.type == MessageType::Trade &&
-                msg.trade.price > 0) {
+                msg.type == MessageType::Trade && meta.price(msg) > 0) {
 
-              MarketDataSimulator::MessageLog::const_accessor acc;
-              if (sent_messages.find(acc, msg.sequence_number)) {
-                const auto &sent = acc->second;
-                if (!compare_messages(msg, sent)) {
+              if (const auto *sent_msg =
+                      sent_messages.find(msg.sequence_number)) {
+                const auto &sent = *sent_msg;
+                if (!compare_messages(msg, sent, meta)) {
                   stats.mismatches++;
                   if (stats.mismatches < 10) {
-                    print_message_mismatch(msg, sent);
+                    print_message_mismatch(msg, sent, meta);
                   }
                 }
               } else {
@@ -286,25 +703,36 @@ private:
   }
 
   // Helper function to compare messages
-  bool compare_messages(const MarketMessage &a, const MarketMessage &b) {
+  bool compare_messages(const MarketMessage &a, const MarketMessage &b,
+                        const SessionMeta &meta) {
     return a.sequence_number == b.sequence_number &&
            a.symbol_id == b.symbol_id && a.type == b.type &&
-           std::abs(a.trade.price - b.trade.price) <
-               0.001 && // Allow small floating point differences
-           a.trade.size == b.trade.size;
+           same_price(a, b, meta) && a.trade.size == b.trade.size;
+  }
+
+  // Fixed-point prices must be exactly the sent price rounded to the tick;
+  // doubles allow small floating point differences
+  bool same_price(const MarketMessage &captured, const MarketMessage &sent,
+                  const SessionMeta &meta) {
+    if (meta.fixed_point()) {
+      return captured.trade.price_fixed ==
+             price_to_fixed(sent.trade.price, meta.tick_size(sent.symbol_id));
+    }
+    return std::abs(captured.trade.price - sent.trade.price) < 0.001;
   }
 
   // Helper function to print mismatches
   void print_message_mismatch(const MarketMessage &captured,
-                              const MarketMessage &sent) {
+                              const MarketMessage &sent,
+                              const SessionMeta &meta) {
     fmt::print("Mismatch at {}: ", captured.sequence_number);
     if (captured.symbol_id != sent.symbol_id)
       fmt::print("sym:{}->{} ", captured.symbol_id, sent.symbol_id);
     if (captured.type != sent.type)
       fmt::print("type:{}->{} ", static_cast<int>(captured.type),
                  static_cast<int>(sent.type));
-    if (std::abs(captured.trade.price - sent.trade.price) >= 0.001)
-      fmt::print("price:{:.2f}->{:.2f} ", captured.trade.price,
+    if (!same_price(captured, sent, meta))
+      fmt::print("price:{:.2f}->{:.2f} ", meta.price(captured),
                  sent.trade.price);
     if (captured.trade.size != sent.trade.size)
       fmt::print("size:{}->{}", captured.trade.size, sent.trade.size);
@@ -324,6 +752,24 @@ int main(int argc, char *argv[]) {
                                        "enable latency measurements")(
       "verify", po::bool_switch()->default_value(true),
       "verify captured messages")(
+      "fixed-point", po::bool_switch()->default_value(false),
+      "store prices as fixed-point ticks")(
+      "trace", po::value<std::string>(),
+      "write sampled stage traces to <path>.<rate>.json")(
+      "trace-every", po::value<uint32_t>()->default_value(1000),
+      "trace 1 in N messages")(
+      "fork-simulator", po::bool_switch()->default_value(false),
+      "run the simulator in a separate process")(
+      "simulator-cpus", po::value<std::string>(),
+      "CPUs for the forked simulator, e.g. 2-3")(
+      "capture-cpus", po::value<std::string>(),
+      "CPUs for the capture node with --fork-simulator, e.g. 0-1")(
+      "soak", po::value<double>(),
+      "soak for this many minutes instead of benchmarking")(
+      "sample-interval", po::value<uint32_t>()->default_value(60),
+      "soak sampling interval in seconds")(
+      "soak-step", po::value<double>()->default_value(0),
+      "minutes per rate when soaking through several rates")(
       "rate", po::value<std::vector<uint32_t>>()->multitoken(),
       "custom message rates to test");
 
@@ -342,19 +788,61 @@ int main(int argc, char *argv[]) {
   config.duration = std::chrono::seconds(vm["duration"].as<uint32_t>());
   config.measure_latency = vm["latency"].as<bool>();
   config.verify_messages = vm["verify"].as<bool>();
+  config.fixed_point_prices = vm["fixed-point"].as<bool>();
+  if (vm.count("trace")) {
+    config.trace_path = vm["trace"].as<std::string>();
+  }
+  config.trace_sample_every = vm["trace-every"].as<uint32_t>();
+  config.fork_simulator = vm["fork-simulator"].as<bool>();
+  try {
+    if (vm.count("simulator-cpus")) {
+      config.simulator_cpus =
+          parse_cpu_list(vm["simulator-cpus"].as<std::string>());
+    }
+    if (vm.count("capture-cpus")) {
+      config.capture_cpus =
+          parse_cpu_list(vm["capture-cpus"].as<std::string>());
+    }
+  } catch (const std::exception &e) {
+    fmt::print(stderr, "{}\n", e.what());
+    return 1;
+  }
+  if (!config.fork_simulator &&
+      (!config.simulator_cpus.empty() || !config.capture_cpus.empty())) {
+    fmt::print(stderr, "CPU pinning requires --fork-simulator\n");
+    return 1;
+  }
 
   if (vm.count("rate")) {
     config.rates = vm["rate"].as<std::vector<uint32_t>>();
   }
 
+  if (vm.count("soak")) {
+    config.soak_duration = std::chrono::seconds(
+        static_cast<int64_t>(vm["soak"].as<double>() * 60));
+    config.sample_interval = std::chrono::seconds(
+        std::max<uint32_t>(vm["sample-interval"].as<uint32_t>(), 1));
+    config.soak_step = std::chrono::seconds(
+        static_cast<int64_t>(vm["soak-step"].as<double>() * 60));
+    BenchmarkRunner runner(config);
+    return runner.run_soak() > 0 ? 1 : 0;
+  }
+
   // Run benchmarks
   BenchmarkRunner runner(config);
   bool exceeded_drop_threshold = false;
+  bool allocated_after_warmup = false;
 
   for (auto rate : config.rates) {
     auto result = runner.run_benchmark(rate);
     runner.print_results(result);
 
+    // The steady-state hot path must not touch the heap
+    if (result.steady_process_allocations.value_or(0) > 0) {
+      fmt::print("\nProcess thread allocated after warm-up\n");
+      allocated_after_warmup = true;
+    }
+
     // Stop if drop rate exceeds threshold
     if (result.capture_rate < 99.0) {
       fmt::print("\nCapture rate dropped below 99% - stopping benchmark\n");
@@ -366,5 +854,5 @@ int main(int argc, char *argv[]) {
     std::this_thread::sleep_for(std::chrono::seconds(5));
   }
 
-  return exceeded_drop_threshold ? 1 : 0;
+  return exceeded_drop_threshold || allocated_after_warmup ? 1 : 0;
 }
@@ -1,10 +1,14 @@
 #include "market_data_simulator.hpp"
+#include "simulator_process.hpp"
+#include "../src/metrics/thread_stats.hpp"
+#include <algorithm>
 #include <fmt/format.h>
 
 namespace tick_capture::benchmark {
 
 MarketDataSimulator::MarketDataSimulator(const Config &config)
-    : config_(config), socket_(io_context_, boost::asio::ip::udp::v4()) {
+    : config_(config), socket_(io_context_, boost::asio::ip::udp::v4()),
+      rate_(config.base_msg_rate) {
 
   using namespace boost::asio::ip;
 
@@ -49,7 +53,10 @@ void MarketDataSimulator::start() {
   if (running_)
     return;
   running_ = true;
-  sim_thread_ = std::thread([this] { run_simulation(); });
+  sim_thread_ = std::thread([this] {
+    set_thread_name("simulator");
+    run_simulation();
+  });
 }
 
 void MarketDataSimulator::stop() {
@@ -64,10 +71,8 @@ void MarketDataSimulator::stop() {
 void MarketDataSimulator::run_simulation() {
   using namespace std::chrono;
 
-  fmt::print("Starting simulator with rate: {} msgs/sec\n",
-             config_.base_msg_rate);
+  fmt::print("Starting simulator with rate: {} msgs/sec\n", rate_.load());
 
-  const auto base_interval = nanoseconds(1'000'000'000 / config_.base_msg_rate);
   auto next_send = steady_clock::now();
 
   while (running_) {
@@ -76,10 +81,8 @@ void MarketDataSimulator::run_simulation() {
     if (now >= next_send) {
       auto msg = generate_message();
       if (send_message(msg)) {
-        const auto sent = ++messages_sent_;
-        if (sent % 10000 == 0) {
-          fmt::print("Successfully sent {} messages\n", sent);
-        }
+        // Pace to the current rate; a late send is caught up next time
+        next_send += nanoseconds(1'000'000'000 / std::max(rate_.load(), 1u));
       } else {
         ++messages_dropped_;
         next_send += microseconds(100);
@@ -141,10 +144,8 @@ MarketMessage MarketDataSimulator::generate_message() {
 bool MarketDataSimulator::send_message(const MarketMessage &msg) {
   try {
     // Store message first
-    {
-      MessageLog::accessor acc;
-      message_log_.insert(acc, msg.sequence_number);
-      acc->second = msg;
+    if (message_log_) {
+      message_log_->record(msg);
     }
 
     // Send message
@@ -3,11 +3,12 @@
 #include <atomic>
 #include <boost/asio.hpp>
 #include <random>
-#include <tbb/concurrent_hash_map.h>
 #include <thread>
 
 namespace tick_capture::benchmark {
 
+class SharedMessageLog;
+
 class MarketDataSimulator {
 public:
   struct Config {
@@ -41,6 +42,9 @@ public:
   void start();
   void stop();
 
+  // Change the send rate of a running simulator
+  void set_rate(uint32_t msgs_per_sec) { rate_ = msgs_per_sec; }
+
   // Get statistics about sent messages
   struct Stats {
     uint64_t messages_sent{0};
@@ -49,9 +53,9 @@ public:
   };
   Stats get_stats() const;
 
-  // Message tracking for verification
-  using MessageLog = tbb::concurrent_hash_map<uint64_t, MarketMessage>;
-  const MessageLog &get_message_log() const { return message_log_; }
+  // Record sent messages in log for verification (none are kept
+  // otherwise). Call before start().
+  void record_to(SharedMessageLog *log) { message_log_ = log; }
 
 private:
   void run_simulation();
@@ -69,11 +73,12 @@ private:
   std::thread sim_thread_;
 
   // Message tracking
-  MessageLog message_log_;
+  SharedMessageLog *message_log_{nullptr};
   std::atomic<uint64_t> sequence_number_{0};
   std::atomic<uint64_t> messages_sent_{0};
   std::atomic<uint64_t> messages_dropped_{0};
   std::atomic<uint64_t> current_rate_{0};
+  std::atomic<uint32_t> rate_;
 
   // Market state
   struct SymbolState {
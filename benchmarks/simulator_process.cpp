@@ -0,0 +1,312 @@
+#include "simulator_process.hpp"
+#include "../src/memory/allocation_counter.hpp"
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <fmt/format.h>
+#include <new>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+namespace tick_capture::benchmark {
+
+namespace {
+
+// Shared mapping that stays valid in both processes after fork
+void *map_shared(size_t bytes) {
+  void *mapping = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (mapping == MAP_FAILED) {
+    throw std::runtime_error(
+        fmt::format("Failed to map {} shared bytes: {}", bytes,
+                    std::strerror(errno)));
+  }
+  return mapping;
+}
+
+struct Usage {
+  std::chrono::nanoseconds cpu_time{0};
+  uint64_t voluntary_switches{0};
+  uint64_t involuntary_switches{0};
+  uint64_t allocations{0};
+};
+
+Usage process_usage() {
+  rusage usage{};
+  ::getrusage(RUSAGE_SELF, &usage);
+  const auto to_ns = [](const timeval &tv) {
+    return std::chrono::seconds(tv.tv_sec) +
+           std::chrono::microseconds(tv.tv_usec);
+  };
+  uint64_t allocations = 0;
+  for (const auto &[tid, count] : allocations_by_thread()) {
+    allocations += count;
+  }
+  return {to_ns(usage.ru_utime) + to_ns(usage.ru_stime),
+          static_cast<uint64_t>(usage.ru_nvcsw),
+          static_cast<uint64_t>(usage.ru_nivcsw), allocations};
+}
+
+} // namespace
+
+// SharedMessageLog
+
+struct LogHeader {
+  std::atomic<uint64_t> overflowed{0};
+};
+
+SharedMessageLog::SharedMessageLog(size_t capacity)
+    : capacity_(capacity),
+      mapped_bytes_(sizeof(MarketMessage) * (capacity + 1)),
+      mapping_(map_shared(mapped_bytes_)) {
+  // Slot 0 holds the header, messages follow (untouched pages stay unbacked)
+  static_assert(sizeof(LogHeader) <= sizeof(MarketMessage));
+  new (mapping_) LogHeader();
+}
+
+SharedMessageLog::~SharedMessageLog() { ::munmap(mapping_, mapped_bytes_); }
+
+void SharedMessageLog::record(const MarketMessage &msg) noexcept {
+  if (msg.sequence_number == 0 || msg.sequence_number > capacity_) {
+    static_cast<LogHeader *>(mapping_)->overflowed.fetch_add(
+        1, std::memory_order_relaxed);
+    return;
+  }
+  static_cast<MarketMessage *>(mapping_)[msg.sequence_number] = msg;
+}
+
+const MarketMessage *
+SharedMessageLog::find(uint64_t sequence_number) const noexcept {
+  if (sequence_number == 0 || sequence_number > capacity_)
+    return nullptr;
+  const auto *slot =
+      static_cast<const MarketMessage *>(mapping_) + sequence_number;
+  // Never-written slots are zero
+  return slot->sequence_number == sequence_number ? slot : nullptr;
+}
+
+uint64_t SharedMessageLog::overflowed() const noexcept {
+  return static_cast<const LogHeader *>(mapping_)->overflowed.load(
+      std::memory_order_relaxed);
+}
+
+// CPU pinning
+
+std::vector<int> parse_cpu_list(const std::string &list) {
+  const long cpu_count = ::sysconf(_SC_NPROCESSORS_CONF);
+  std::vector<int> cpus;
+
+  size_t pos = 0;
+  while (pos < list.size()) {
+    const size_t end = std::min(list.find(',', pos), list.size());
+    const std::string item = list.substr(pos, end - pos);
+    pos = end + 1;
+
+    int first = 0;
+    int last = 0;
+    char extra = 0;
+    const int fields =
+        std::sscanf(item.c_str(), "%d-%d%c", &first, &last, &extra);
+    if (fields == 1) {
+      last = first;
+    } else if (fields != 2) {
+      throw std::runtime_error(fmt::format("Invalid CPU list: {}", list));
+    }
+    if (first < 0 || last < first || last >= cpu_count) {
+      throw std::runtime_error(fmt::format(
+          "CPU range {} outside 0-{} in {}", item, cpu_count - 1, list));
+    }
+    for (int cpu = first; cpu <= last; ++cpu) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+void pin_to_cpus(const std::vector<int> &cpus) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (cpus.empty()) {
+    const long cpu_count = ::sysconf(_SC_NPROCESSORS_CONF);
+    for (long cpu = 0; cpu < cpu_count && cpu < CPU_SETSIZE; ++cpu) {
+      CPU_SET(cpu, &set);
+    }
+  } else {
+    for (int cpu : cpus) {
+      CPU_SET(cpu, &set);
+    }
+  }
+
+  // pid 0 is the calling thread
+  if (::sched_setaffinity(0, sizeof(set), &set) != 0) {
+    throw std::runtime_error(
+        fmt::format("Failed to set CPU affinity: {}", std::strerror(errno)));
+  }
+}
+
+// SimulatorProcess
+
+struct SimulatorProcess::Control {
+  enum Phase : uint32_t { Starting, Ready, Running, Stopping, Done, Failed };
+
+  std::atomic<uint32_t> phase{Starting};
+  std::atomic<uint32_t> rate{0};          // Set by the parent
+  std::atomic<uint64_t> messages_sent{0}; // Updated while running
+  uint64_t messages_dropped{0};
+  int64_t cpu_ns{0};
+  uint64_t voluntary_switches{0};
+  uint64_t involuntary_switches{0};
+  uint64_t allocations{0};
+  char error[256]{};
+};
+static_assert(std::atomic<uint32_t>::is_always_lock_free &&
+                  std::atomic<uint64_t>::is_always_lock_free,
+              "Control must be usable across processes");
+
+SimulatorProcess::SimulatorProcess(const MarketDataSimulator::Config &config,
+                                   size_t log_capacity,
+                                   const std::vector<int> &cpus)
+    : log_(log_capacity),
+      control_(new (map_shared(sizeof(Control))) Control()) {
+  control_->rate = config.base_msg_rate;
+  // Unflushed output would otherwise be written by both processes
+  std::fflush(nullptr);
+
+  pid_ = ::fork();
+  if (pid_ < 0) {
+    const int err = errno;
+    ::munmap(control_, sizeof(Control));
+    throw std::runtime_error(
+        fmt::format("Failed to fork simulator: {}", std::strerror(err)));
+  }
+  if (pid_ == 0) {
+    run_child(config, *control_, log_, cpus);
+  }
+}
+
+SimulatorProcess::~SimulatorProcess() {
+  if (pid_ > 0) {
+    // Not stopped cleanly; don't leave the child sending
+    ::kill(pid_, SIGKILL);
+    wait_for_child();
+  }
+  ::munmap(control_, sizeof(Control));
+}
+
+void SimulatorProcess::run_child(const MarketDataSimulator::Config &config,
+                                 Control &control, SharedMessageLog &log,
+                                 const std::vector<int> &cpus) {
+  // Never returns: the child must not run the parent's destructors
+  int status = 0;
+  try {
+    // Don't outlive a benchmark that dies mid-run
+    ::prctl(PR_SET_PDEATHSIG, SIGKILL);
+    pin_to_cpus(cpus);
+
+    MarketDataSimulator simulator(config);
+    if (log.capacity() > 0) {
+      simulator.record_to(&log);
+    }
+    control.phase = Control::Ready;
+
+    while (control.phase.load() == Control::Ready) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    const auto usage_before = process_usage();
+    simulator.start();
+
+    while (control.phase.load() == Control::Running) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      simulator.set_rate(control.rate.load());
+      control.messages_sent = simulator.get_stats().messages_sent;
+    }
+    simulator.stop();
+    const auto usage_after = process_usage();
+
+    const auto stats = simulator.get_stats();
+    control.messages_sent = stats.messages_sent;
+    control.messages_dropped = stats.messages_dropped;
+    control.cpu_ns = (usage_after.cpu_time - usage_before.cpu_time).count();
+    control.voluntary_switches =
+        usage_after.voluntary_switches - usage_before.voluntary_switches;
+    control.involuntary_switches =
+        usage_after.involuntary_switches - usage_before.involuntary_switches;
+    control.allocations = usage_after.allocations - usage_before.allocations;
+    control.phase = Control::Done;
+  } catch (const std::exception &e) {
+    std::snprintf(control.error, sizeof(control.error), "%s", e.what());
+    control.phase = Control::Failed;
+    status = 1;
+  }
+  std::fflush(nullptr);
+  ::_exit(status);
+}
+
+void SimulatorProcess::start() {
+  while (control_->phase.load() == Control::Starting) {
+    int status = 0;
+    if (::waitpid(pid_, &status, WNOHANG) == pid_) {
+      pid_ = -1;
+      break;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  if (control_->phase.load() != Control::Ready) {
+    throw std::runtime_error(
+        fmt::format("Simulator process failed to start: {}",
+                    control_->error[0] ? control_->error : "exited"));
+  }
+  control_->phase = Control::Running;
+}
+
+void SimulatorProcess::stop() {
+  if (pid_ <= 0)
+    return;
+  if (control_->phase.load() != Control::Running) {
+    // Never started
+    ::kill(pid_, SIGKILL);
+    wait_for_child();
+    return;
+  }
+  control_->phase = Control::Stopping;
+  wait_for_child();
+
+  if (control_->phase.load() == Control::Failed) {
+    fmt::print(stderr, "Simulator process failed: {}\n", control_->error);
+  }
+}
+
+void SimulatorProcess::wait_for_child() {
+  int status = 0;
+  while (::waitpid(pid_, &status, 0) < 0 && errno == EINTR) {
+  }
+  pid_ = -1;
+}
+
+void SimulatorProcess::set_rate(uint32_t msgs_per_sec) {
+  control_->rate = msgs_per_sec;
+}
+
+uint64_t SimulatorProcess::messages_sent() const {
+  return control_->messages_sent.load();
+}
+
+SimulatorProcess::Stats SimulatorProcess::get_stats() const {
+  Stats stats;
+  stats.messages_sent = control_->messages_sent;
+  stats.messages_dropped = control_->messages_dropped;
+  stats.cpu_time = std::chrono::nanoseconds(control_->cpu_ns);
+  stats.voluntary_switches = control_->voluntary_switches;
+  stats.involuntary_switches = control_->involuntary_switches;
+  stats.allocations = control_->allocations;
+  return stats;
+}
+
+} // namespace tick_capture::benchmark
@@ -0,0 +1,100 @@
+#pragma once
+#include "market_data_simulator.hpp"
+#include <chrono>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+namespace tick_capture::benchmark {
+
+// Sent-message log in an anonymous shared mapping, created before fork so
+// a simulator process can fill it and the benchmark verify against it.
+// Sequence numbers start at 1 and index the slots directly, so recording
+// never allocates; pages are only backed as the log fills.
+class SharedMessageLog {
+public:
+  explicit SharedMessageLog(size_t capacity);
+  ~SharedMessageLog();
+
+  // Non-copyable
+  SharedMessageLog(const SharedMessageLog &) = delete;
+  SharedMessageLog &operator=(const SharedMessageLog &) = delete;
+
+  // Simulator side: keep msg for verification
+  void record(const MarketMessage &msg) noexcept;
+
+  // The sent message with this sequence number, or nullptr
+  const MarketMessage *find(uint64_t sequence_number) const noexcept;
+
+  size_t capacity() const noexcept { return capacity_; }
+  // Messages past capacity that could not be recorded
+  uint64_t overflowed() const noexcept;
+
+private:
+  size_t capacity_;
+  size_t mapped_bytes_;
+  void *mapping_;
+};
+
+// Parse a CPU list such as "0,2-3". Throws on malformed input or CPUs this
+// machine does not have.
+std::vector<int> parse_cpu_list(const std::string &list);
+
+// Restrict the calling thread, and threads it creates afterwards, to cpus.
+// An empty list allows every CPU.
+void pin_to_cpus(const std::vector<int> &cpus);
+
+// A MarketDataSimulator run in a forked child process, optionally pinned
+// to its own CPUs, so the feed does not share cores, caches or allocator
+// state with the capture node. Start and stop are signalled through shared
+// memory; the child records sent messages in a SharedMessageLog.
+//
+// Construct before the benchmark starts any threads: only the calling
+// thread survives fork.
+class SimulatorProcess {
+public:
+  SimulatorProcess(const MarketDataSimulator::Config &config,
+                   size_t log_capacity, const std::vector<int> &cpus);
+  ~SimulatorProcess();
+
+  // Non-copyable
+  SimulatorProcess(const SimulatorProcess &) = delete;
+  SimulatorProcess &operator=(const SimulatorProcess &) = delete;
+
+  // Block until the child has built its simulator, then start sending
+  void start();
+  // Stop sending and reap the child
+  void stop();
+
+  // Change the send rate while running
+  void set_rate(uint32_t msgs_per_sec);
+  // Messages sent so far, refreshed by the child every millisecond
+  uint64_t messages_sent() const;
+
+  // Valid after stop()
+  struct Stats {
+    uint64_t messages_sent{0};
+    uint64_t messages_dropped{0};
+    std::chrono::nanoseconds cpu_time{0}; // Child process, while running
+    uint64_t voluntary_switches{0};
+    uint64_t involuntary_switches{0};
+    uint64_t allocations{0}; // If the benchmark counts allocations
+  };
+  Stats get_stats() const;
+
+  const SharedMessageLog &message_log() const { return log_; }
+
+private:
+  struct Control;
+
+  static void run_child(const MarketDataSimulator::Config &config,
+                        Control &control, SharedMessageLog &log,
+                        const std::vector<int> &cpus);
+  void wait_for_child();
+
+  SharedMessageLog log_;
+  Control *control_;
+  pid_t pid_{-1};
+};
+
+} // namespace tick_capture::benchmark
@@ -0,0 +1,169 @@
+#include "soak_monitor.hpp"
+#include <algorithm>
+#include <fmt/format.h>
+#include <functional>
+#include <map>
+#include <stdexcept>
+
+namespace tick_capture::benchmark {
+
+namespace {
+
+// Fewer samples than this can't tell a trend from noise
+constexpr size_t kMinTrendSamples = 5;
+constexpr size_t kMinDriftSamples = 6;
+
+// A resource grows if it rose in at least this share of intervals
+constexpr double kMonotonicShare = 0.8;
+
+// Least-squares slope of values against elapsed time, per hour
+double slope_per_hour(const std::vector<SoakSample> &samples,
+                      const std::vector<double> &values) {
+  const double n = static_cast<double>(values.size());
+  double sum_x = 0, sum_y = 0, sum_xx = 0, sum_xy = 0;
+  for (size_t i = 0; i < values.size(); ++i) {
+    const double x = samples[i].elapsed.count() / 3600.0;
+    sum_x += x;
+    sum_y += values[i];
+    sum_xx += x * x;
+    sum_xy += x * values[i];
+  }
+  const double denominator = n * sum_xx - sum_x * sum_x;
+  return denominator > 0 ? (n * sum_xy - sum_x * sum_y) / denominator : 0;
+}
+
+// Flag values that rose through most of the run by at least min_rise
+void check_growth(const std::vector<SoakSample> &samples,
+                  const std::vector<double> &values, const std::string &name,
+                  double min_rise, double unit, const std::string &unit_name,
+                  std::vector<std::string> &findings) {
+  if (values.size() < kMinTrendSamples)
+    return;
+
+  size_t rising = 0;
+  for (size_t i = 1; i < values.size(); ++i) {
+    rising += values[i] >= values[i - 1];
+  }
+  const double share = static_cast<double>(rising) / (values.size() - 1);
+  const double rise = values.back() - values.front();
+  const double slope = slope_per_hour(samples, values);
+
+  if (share >= kMonotonicShare && rise >= min_rise && slope > 0) {
+    findings.push_back(fmt::format(
+        "{} grew in {:.0f}% of intervals, {:.1f} -> {:.1f} {} "
+        "({:+.1f} {}/hour)",
+        name, share * 100, values.front() / unit, values.back() / unit,
+        unit_name, slope / unit, unit_name));
+  }
+}
+
+double median(std::vector<double> values) {
+  std::sort(values.begin(), values.end());
+  return values[values.size() / 2];
+}
+
+// Compare the medians of the first and last third of samples at one rate.
+// Drift is the late median worse than the early one by more than
+// max_ratio, worse meaning higher if rising_is_bad, else lower.
+void check_drift(const std::vector<const SoakSample *> &samples,
+                 const std::function<double(const SoakSample &)> &metric,
+                 const std::string &name, double max_ratio, bool rising_is_bad,
+                 std::vector<std::string> &findings) {
+  const size_t third = samples.size() / 3;
+  std::vector<double> early, late;
+  for (size_t i = 0; i < third; ++i) {
+    early.push_back(metric(*samples[i]));
+    late.push_back(metric(*samples[samples.size() - third + i]));
+  }
+  const double before = median(early);
+  const double after = median(late);
+  if (before <= 0 || after <= 0)
+    return;
+
+  const double ratio = rising_is_bad ? after / before : before / after;
+  if (ratio > max_ratio) {
+    findings.push_back(fmt::format(
+        "{} drifted at {} msgs/sec: {:.1f} early -> {:.1f} late", name,
+        samples.front()->target_rate, before, after));
+  }
+}
+
+} // namespace
+
+SoakMonitor::SoakMonitor(const std::filesystem::path &csv_path)
+    : csv_(csv_path) {
+  if (!csv_) {
+    throw std::runtime_error(
+        fmt::format("Failed to open soak log: {}", csv_path.string()));
+  }
+  csv_ << "elapsed_s,target_rate,sent_per_sec,captured_per_sec,dropped,"
+          "latency_p50_ns,latency_p99_ns,latency_p999_ns,rss_bytes,"
+          "open_fds,ring_high_water,write_bytes_per_sec\n";
+}
+
+void SoakMonitor::add(const SoakSample &sample) {
+  samples_.push_back(sample);
+  csv_ << fmt::format("{},{},{:.1f},{:.1f},{},{},{},{},{},{},{},{:.1f}\n",
+                      sample.elapsed.count(), sample.target_rate,
+                      sample.sent_per_sec, sample.captured_per_sec,
+                      sample.dropped, sample.latency_p50_ns,
+                      sample.latency_p99_ns, sample.latency_p999_ns,
+                      sample.rss_bytes, sample.open_fds,
+                      sample.ring_high_water, sample.write_bytes_per_sec);
+  csv_.flush();
+}
+
+std::vector<std::string> SoakMonitor::findings() const {
+  std::vector<std::string> findings;
+
+  // Leaks: resources that keep growing whatever the rate
+  std::vector<double> rss, fds;
+  for (const auto &sample : samples_) {
+    rss.push_back(static_cast<double>(sample.rss_bytes));
+    fds.push_back(static_cast<double>(sample.open_fds));
+  }
+  if (!rss.empty()) {
+    check_growth(samples_, rss, "RSS", std::max(rss.front() * 0.1, 1048576.0),
+                 1048576.0, "MiB", findings);
+    check_growth(samples_, fds, "Open fds", 2, 1, "fds", findings);
+  }
+
+  // Drift: compare like with like, one rate of the profile at a time
+  std::map<uint32_t, std::vector<const SoakSample *>> by_rate;
+  for (const auto &sample : samples_) {
+    by_rate[sample.target_rate].push_back(&sample);
+  }
+  for (const auto &[rate, samples] : by_rate) {
+    if (samples.size() < kMinDriftSamples)
+      continue;
+
+    check_drift(
+        samples, [](const SoakSample &s) { return s.captured_per_sec; },
+        "Capture throughput (msgs/sec)", 1.05, false, findings);
+    // Percentiles come from power-of-two buckets, so one bucket is 2x
+    check_drift(
+        samples,
+        [](const SoakSample &s) {
+          return static_cast<double>(s.latency_p99_ns) / 1000.0;
+        },
+        "p99 latency (us)", 2.5, true, findings);
+    // A ring holding under 64 ticks is keeping up either way
+    check_drift(
+        samples,
+        [](const SoakSample &s) {
+          return std::max(static_cast<double>(s.ring_high_water), 64.0);
+        },
+        "Ring high-water mark", 2.0, true, findings);
+    check_drift(
+        samples,
+        [](const SoakSample &s) {
+          return s.captured_per_sec > 0
+                     ? s.write_bytes_per_sec / s.captured_per_sec
+                     : 0.0;
+        },
+        "Bytes written per message", 1.1, true, findings);
+  }
+  return findings;
+}
+
+} // namespace tick_capture::benchmark
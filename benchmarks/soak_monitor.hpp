@@ -0,0 +1,51 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace tick_capture::benchmark {
+
+// Pipeline health over one sampling interval of a soak run
+struct SoakSample {
+  std::chrono::seconds elapsed{0}; // Since the soak started
+  uint32_t target_rate{0};
+  double sent_per_sec{0};
+  double captured_per_sec{0};
+  uint64_t dropped{0}; // Ring overflows in this interval
+  uint64_t latency_p50_ns{0};
+  uint64_t latency_p99_ns{0};
+  uint64_t latency_p999_ns{0};
+  size_t rss_bytes{0};
+  size_t open_fds{0};
+  size_t ring_high_water{0};
+  double write_bytes_per_sec{0};
+};
+
+// Collects soak samples, appending each to a CSV file as it arrives so an
+// interrupted run keeps its history, and looks for slow degradation: a
+// resource growing through most of the run, or a metric drifting between
+// the early and late samples taken at the same rate.
+class SoakMonitor {
+public:
+  explicit SoakMonitor(const std::filesystem::path &csv_path);
+
+  // Non-copyable
+  SoakMonitor(const SoakMonitor &) = delete;
+  SoakMonitor &operator=(const SoakMonitor &) = delete;
+
+  void add(const SoakSample &sample);
+
+  // One line per problem found, empty if the run looks steady
+  std::vector<std::string> findings() const;
+
+  const std::vector<SoakSample> &samples() const { return samples_; }
+
+private:
+  std::ofstream csv_;
+  std::vector<SoakSample> samples_;
+};
+
+} // namespace tick_capture::benchmark
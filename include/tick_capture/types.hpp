@@ -1,7 +1,10 @@
 #pragma once
 #include <chrono>
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace tick_capture {
@@ -14,13 +17,35 @@ enum class MessageType : uint8_t {
   OrderCancel = 5
 };
 
+// Largest symbol id accepted unless configured otherwise
+constexpr uint32_t kDefaultMaxSymbolId = 10000;
+
+// Bits of MarketMessage::trade.flags
+enum TradeFlags : uint8_t {
+  kTradeBuyerInitiated = 1 << 0, // Aggressor was the buyer
+  kTradeCross = 1 << 1,          // Auction/cross print
+  kTradeSuspect = 1 << 2,        // Outside the symbol's price band
+};
+
+// Datagram layout on the capture socket
+enum class WireFormat : uint8_t {
+  Native,       // Packed MarketMessages, as sent by the simulator
+  MoldUdp64Itch // Nasdaq ITCH 5.0 in MoldUDP64 packets
+};
+
+// How trade prices are stored, fixed per capture session
+enum class PriceEncoding : uint8_t {
+  Double,    // trade.price
+  FixedPoint // trade.price_fixed, a whole number of the symbol's tick size
+};
+
 // Fixed-size message structure with explicit padding, alignment and checksum
 struct alignas(8) MarketMessage {
   // Header (24 bytes)
   uint64_t sequence_number; // 8 bytes
   uint64_t timestamp;       // 8 bytes
   uint32_t checksum;        // 4 bytes (New!)
-  uint32_t reserved;        // 4 bytes (for future use)
+  uint32_t reserved;        // 4 bytes (trace id of sampled ticks)
 
   // Identifiers (8 bytes)
   uint32_t symbol_id; // 4 bytes
@@ -30,7 +55,10 @@ struct alignas(8) MarketMessage {
   // Data section (32 bytes)
   union {
     struct {
-      double price;
+      union {
+        double price;        // PriceEncoding::Double
+        int64_t price_fixed; // PriceEncoding::FixedPoint
+      };
       uint32_t size;
       uint8_t flags;
       uint8_t padding[3];
@@ -51,22 +79,35 @@ struct alignas(8) MarketMessage {
     uint32_t sum = 0;
     const uint32_t *ptr = reinterpret_cast<const uint32_t *>(this);
     // Skip the checksum field itself
-    for (size_t i = 2; i < sizeof(MarketMessage) / 4; ++i) {
-      sum ^= ptr[i];
+    for (size_t i = 0; i < sizeof(MarketMessage) / 4; ++i) {
+      if (i != offsetof(MarketMessage, checksum) / 4)
+        sum ^= ptr[i];
     }
     return sum;
   }
 
   // Validate message
-  bool is_valid() const {
-    return sequence_number > 0 && symbol_id > 0 && symbol_id <= 10000 &&
-           type == MessageType::Trade && trade.price > 0 &&
-           trade.price < 1000000 && trade.size > 0 &&
+  bool is_valid(uint32_t max_symbol_id = kDefaultMaxSymbolId) const {
+    return sequence_number > 0 && symbol_id > 0 &&
+           symbol_id <= max_symbol_id && type == MessageType::Trade &&
+           trade.price > 0 && trade.price < 1000000 && trade.size > 0 &&
            checksum == calculate_checksum();
   }
 
   // Update checksum before sending
   void update_checksum() { checksum = calculate_checksum(); }
+
+  // XOR the words holding bytes [offset, offset + length) into the
+  // checksum. Called before and after changing those bytes it carries the
+  // change over, so unlike update_checksum() a wrong checksum stays wrong.
+  void toggle_checksum(size_t offset, size_t length) {
+    const auto *bytes = reinterpret_cast<const char *>(this);
+    for (size_t i = offset / 4; i < (offset + length + 3) / 4; ++i) {
+      uint32_t word;
+      std::memcpy(&word, bytes + i * 4, sizeof(word));
+      checksum ^= word;
+    }
+  }
 };
 
 static_assert(sizeof(MarketMessage) == 64, "MarketMessage must be 64 bytes");
@@ -77,25 +118,98 @@ struct CaptureConfig {
   // Network settings
   std::string multicast_addr = "239.255.0.1";
   uint16_t port = 12345;
+  WireFormat wire_format = WireFormat::Native;
 
   // Buffer sizes
   size_t ring_buffer_size = 131072;     // Increased to 128K entries
   size_t udp_buffer_size = 262144;      // Increased to 256KB
   size_t socket_buffer_size = 33554432; // 32MB
+  // Raw datagrams waiting for a venue decoder (non-native wire formats)
+  size_t decode_ring_size = 4194304; // 4MB
 
-  // Batch sizes
+  // Batch sizes: the processing thread adapts its batch between these to
+  // ring occupancy and drain rate
+  size_t min_batch_size = 8;
   size_t max_batch_size = 256; // Maximum messages to process in one batch
 
-  // Storage settings
+  // Shutdown: how long stop() may spend storing ticks still in the ring
+  std::chrono::milliseconds drain_timeout{2000};
+
+  // Storage settings. With a flush_interval, a tick file's writes are
+  // batched for up to that long instead of made one tick at a time.
   std::string output_dir;
+  std::chrono::milliseconds flush_interval{0};
+
+  // Reference data: symbol ids run 1..max_symbol_id. With a symbol master
+  // CSV, only listed symbols are accepted.
+  uint32_t max_symbol_id = kDefaultMaxSymbolId;
+  std::string symbol_master_path;
+
+  // Price bands: trades more than price_band_fraction from the symbol's
+  // last price (0 disables), or outside its symbol master band, are flagged
+  // kTradeSuspect. price_band_rebase suspect trades in a row move the band.
+  double price_band_fraction = 0.0;
+  uint32_t price_band_rebase = 3;
+
+  // Stored price encoding. Fixed-point prices are scaled by the symbol
+  // master tick size, or by fixed_point_tick for symbols without one.
+  PriceEncoding price_encoding = PriceEncoding::Double;
+  double fixed_point_tick = 0.0001;
+
+  // Anomaly alerts: trades more than anomaly_jump_sigma EWMA deviations
+  // from the symbol's EWMA price, and symbols silent for longer than
+  // stale_after. Zero disables either check.
+  double anomaly_jump_sigma = 0.0;
+  double anomaly_ewma_alpha = 0.05;
+  std::chrono::milliseconds stale_after{0};
+
+  // Stall watchdog: a pipeline thread without progress for this long is
+  // reported stalled (0 disables)
+  std::chrono::milliseconds stall_threshold{1000};
+
+  // Stage tracing: time 1 in trace_sample_every ticks through the
+  // pipeline (0 disables)
+  uint32_t trace_sample_every = 0;
+
+  // Background scrubbing of output_dir's tick files against their block
+  // checksums, reading at most scrub_bytes_per_sec (0 disables). Files with
+  // a corrupt block are moved to output_dir/quarantine if scrub_quarantine
+  // is set.
+  uint64_t scrub_bytes_per_sec = 0;
+  std::chrono::seconds scrub_interval{3600};
+  bool scrub_quarantine = false;
 
   // Feature flags
   bool enable_timestamps = false;
   bool verify_checksums = true; // New option
 
-  // Coordinator settings (optional)
+  // Coordinator settings (optional). node_id names this node to its peers
+  // (default: "<hostname>/<coordinator_address>").
   std::string coordinator_address;
   std::vector<std::string> peer_addresses;
+  std::string node_id;
+
+  // Replay server settings (optional), serves output_dir to clients
+  std::string replay_address;
+
+  // Live tick distribution (optional), fed from the processing thread
+  std::string publish_address;
+
+  // Replication (optional): ship output_dir as replicate_name (default: its
+  // last path component) to the replica receiver at replicate_address, at
+  // most replicate_bytes_per_sec, including unsealed records if
+  // replicate_unsealed is set. A node with replica_address set receives
+  // its peers' replicas into replica_dir.
+  std::string replicate_address;
+  std::string replicate_name;
+  uint64_t replicate_bytes_per_sec = 32 * 1024 * 1024;
+  bool replicate_unsealed = false;
+  std::string replica_address;
+  std::string replica_dir;
+
+  // Zero-downtime restart (optional): a running node listens on this Unix
+  // socket path and hands its capture socket to a successor that connects
+  std::string handover_path;
 };
 
 struct CaptureStats {
@@ -103,6 +217,7 @@ struct CaptureStats {
   uint64_t messages_processed = 0;
   uint64_t messages_dropped = 0;
   uint64_t messages_invalid = 0;
+  uint64_t messages_suspect = 0; // Kept, but flagged kTradeSuspect
   uint64_t checksum_errors = 0; // New counter
   std::chrono::nanoseconds avg_latency{0};
   std::chrono::nanoseconds max_latency{0};
@@ -0,0 +1,53 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+namespace tick_capture {
+
+// Chooses how many ticks a consumer takes from its ring per pass, from the
+// ring's occupancy and the recent drain rate.
+//
+// The batch is paced at twice the recent average taken per pass, so while
+// the consumer keeps up batches stay small and ticks are stored soon after
+// they arrive. A pass that leaves ticks behind raises the average, and
+// with it the batch, within a few passes. On top of that the batch grows
+// in proportion to occupancy, reaching max_batch at high_water (an eighth
+// of the ring), so a backlog is cleared in fewer, larger passes.
+class AdaptiveBatchSizer {
+public:
+  AdaptiveBatchSizer(size_t min_batch, size_t max_batch, size_t ring_capacity)
+      : min_(std::max<size_t>(min_batch, 1)),
+        max_(std::max(max_batch, min_)),
+        high_water_(std::max(ring_capacity / 8, max_)) {}
+
+  // Batch size for a pass over a ring holding `occupancy` ticks
+  size_t next(size_t occupancy) noexcept {
+    const auto paced = std::clamp(
+        static_cast<size_t>(std::ceil(drain_rate_ * 2.0)), min_, max_);
+    if (occupancy <= paced) {
+      return paced;
+    }
+    const double fill = std::min(
+        1.0, static_cast<double>(occupancy) / static_cast<double>(high_water_));
+    return paced +
+           static_cast<size_t>(fill * static_cast<double>(max_ - paced));
+  }
+
+  // Ticks actually taken by the pass
+  void record(size_t popped) noexcept {
+    drain_rate_ += kAlpha * (static_cast<double>(popped) - drain_rate_);
+  }
+
+  double drain_rate() const { return drain_rate_; }
+
+private:
+  static constexpr double kAlpha = 0.1; // EWMA weight per pass
+
+  size_t min_;
+  size_t max_;
+  size_t high_water_;
+  double drain_rate_{0.0}; // Ticks per pass
+};
+
+} // namespace tick_capture
@@ -0,0 +1,218 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <vector>
+
+namespace tick_capture {
+
+// Single-producer/single-consumer ring of variable-length byte records, for
+// raw exchange payloads that do not fit a fixed-size slot.
+//
+// Each record is an 8-byte header followed by its payload, padded to 8
+// bytes. A record is always contiguous in memory: when one does not fit
+// before the end of the buffer, the producer fills the tail with a padding
+// record that the consumer skips, and writes the record at the start.
+//
+// The producer reserves space, writes into it in place (e.g. straight from
+// recv) and commits the bytes actually used. The consumer peeks the next
+// record and releases it once done, so neither side copies.
+class ByteRingBuffer {
+  struct RecordHeader {
+    uint32_t length; // Payload bytes, excluding header and alignment
+    uint32_t flags;
+  };
+  static constexpr uint32_t kPadding = 1;
+  static constexpr size_t kAlign = 8;
+  static_assert(sizeof(RecordHeader) == kAlign);
+
+  // Ensure positions are on different cache lines. Positions count bytes
+  // since creation and are masked to index the buffer.
+  struct alignas(64) AlignedIndex {
+    std::atomic<uint64_t> value{0};
+  };
+
+  AlignedIndex write_pos_;
+  AlignedIndex read_pos_;
+
+  alignas(64) std::vector<std::byte> buffer_;
+  const uint64_t mask_;
+
+  // Producer-side reservation, valid between reserve() and commit()
+  uint64_t reserved_pos_{0};
+  size_t reserved_length_{0};
+
+  // Statistics for monitoring
+  std::atomic<size_t> total_pushed_{0};
+  std::atomic<size_t> total_popped_{0};
+  std::atomic<size_t> push_failures_{0};
+  std::atomic<size_t> padding_bytes_{0};
+
+public:
+  // Capacity in bytes, rounded up to a power of two
+  explicit ByteRingBuffer(size_t capacity)
+      : buffer_(next_power_of_2(std::max<size_t>(capacity, 64))),
+        mask_(buffer_.size() - 1) {}
+
+  // Non-copyable
+  ByteRingBuffer(const ByteRingBuffer &) = delete;
+  ByteRingBuffer &operator=(const ByteRingBuffer &) = delete;
+
+  // Producer: reserve contiguous space for a payload of up to max_length
+  // bytes. Returns an empty span if the ring is too full.
+  std::span<std::byte> reserve(size_t max_length) noexcept {
+    const size_t needed = record_size(max_length);
+    if (needed > buffer_.size() / 2) {
+      push_failures_++;
+      return {};
+    }
+
+    auto write = write_pos_.value.load(std::memory_order_relaxed);
+    const auto read = read_pos_.value.load(std::memory_order_acquire);
+    const size_t free = buffer_.size() - (write - read);
+    const size_t offset = write & mask_;
+    const size_t contiguous = buffer_.size() - offset;
+
+    if (contiguous < needed) {
+      // Pad out the tail so the record starts at the beginning
+      if (free < contiguous + needed) {
+        push_failures_++;
+        return {};
+      }
+      write_header(offset, contiguous - sizeof(RecordHeader), kPadding);
+      write += contiguous;
+      write_pos_.value.store(write, std::memory_order_release);
+      padding_bytes_ += contiguous;
+    } else if (free < needed) {
+      push_failures_++;
+      return {};
+    }
+
+    reserved_pos_ = write;
+    reserved_length_ = max_length;
+    return {buffer_.data() + (write & mask_) + sizeof(RecordHeader),
+            max_length};
+  }
+
+  // Producer: publish the reservation holding `length` bytes (at most the
+  // reserved length)
+  void commit(size_t length) noexcept {
+    if (length > reserved_length_)
+      length = reserved_length_;
+    write_header(reserved_pos_ & mask_, static_cast<uint32_t>(length), 0);
+    write_pos_.value.store(reserved_pos_ + record_size(length),
+                           std::memory_order_release);
+    reserved_length_ = 0;
+    total_pushed_++;
+  }
+
+  // Producer: copy a whole record in
+  bool try_push(const void *data, size_t length) noexcept {
+    auto space = reserve(length);
+    if (space.data() == nullptr)
+      return false;
+    std::memcpy(space.data(), data, length);
+    commit(length);
+    return true;
+  }
+
+  // Consumer: the next record's payload, or an empty span if there is none.
+  // The span stays valid until release().
+  std::span<const std::byte> peek() noexcept {
+    auto read = read_pos_.value.load(std::memory_order_relaxed);
+
+    while (read != write_pos_.value.load(std::memory_order_acquire)) {
+      const auto header = read_header(read & mask_);
+      if (!(header.flags & kPadding)) {
+        return {buffer_.data() + (read & mask_) + sizeof(RecordHeader),
+                header.length};
+      }
+      // Skip the padding at the end of the buffer
+      read += record_size(header.length);
+      read_pos_.value.store(read, std::memory_order_release);
+    }
+    return {};
+  }
+
+  // Consumer: drop the record returned by the last peek()
+  void release() noexcept {
+    const auto read = read_pos_.value.load(std::memory_order_relaxed);
+    const auto header = read_header(read & mask_);
+    read_pos_.value.store(read + record_size(header.length),
+                          std::memory_order_release);
+    total_popped_++;
+  }
+
+  // Consumer: hand up to max_records payloads to fn, releasing each after
+  template <typename F> size_t consume(F &&fn, size_t max_records) {
+    size_t records = 0;
+    while (records < max_records) {
+      const auto record = peek();
+      if (record.data() == nullptr)
+        break;
+      fn(record);
+      release();
+      ++records;
+    }
+    return records;
+  }
+
+  bool empty() const noexcept {
+    return read_pos_.value.load(std::memory_order_acquire) ==
+           write_pos_.value.load(std::memory_order_acquire);
+  }
+
+  // Bytes in use, including headers and padding
+  size_t size() const noexcept {
+    const auto read = read_pos_.value.load(std::memory_order_acquire);
+    const auto write = write_pos_.value.load(std::memory_order_acquire);
+    return static_cast<size_t>(write - read);
+  }
+
+  size_t capacity() const noexcept { return buffer_.size(); }
+
+  // Largest payload a single record can carry
+  size_t max_record_length() const noexcept {
+    return buffer_.size() / 2 - sizeof(RecordHeader);
+  }
+
+  // Statistics
+  size_t total_pushed() const noexcept { return total_pushed_; }
+  size_t total_popped() const noexcept { return total_popped_; }
+  size_t push_failures() const noexcept { return push_failures_; }
+  size_t padding_bytes() const noexcept { return padding_bytes_; }
+
+private:
+  static size_t record_size(size_t length) noexcept {
+    return (sizeof(RecordHeader) + length + kAlign - 1) & ~(kAlign - 1);
+  }
+
+  void write_header(size_t offset, uint32_t length, uint32_t flags) noexcept {
+    const RecordHeader header{length, flags};
+    std::memcpy(buffer_.data() + offset, &header, sizeof(header));
+  }
+
+  RecordHeader read_header(size_t offset) const noexcept {
+    RecordHeader header;
+    std::memcpy(&header, buffer_.data() + offset, sizeof(header));
+    return header;
+  }
+
+  // Helper function to get next power of 2
+  static size_t next_power_of_2(size_t v) {
+    v--;
+    v |= v >> 1;
+    v |= v >> 2;
+    v |= v >> 4;
+    v |= v >> 8;
+    v |= v >> 16;
+    v |= v >> 32;
+    v++;
+    return v;
+  }
+};
+
+} // namespace tick_capture
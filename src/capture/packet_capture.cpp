@@ -1,14 +1,45 @@
 #include "packet_capture.hpp"
+#include "../metrics/thread_stats.hpp"
+#include <cstring>
 #include <fmt/format.h>
+#include <poll.h>
 
 namespace tick_capture {
 
-PacketCapture::PacketCapture(const CaptureConfig &config)
+PacketCapture::PacketCapture(const CaptureConfig &config, int socket_fd)
     : config_(config), socket_(io_context_),
       recv_buffer_(config.udp_buffer_size), // Configurable UDP buffer size
       buffer_(config.ring_buffer_size)      // Configurable ring buffer size
 {
-  setup_socket();
+  if (socket_fd >= 0) {
+    // Already bound and joined; packets kept queuing in the kernel buffer
+    socket_.assign(boost::asio::ip::udp::v4(), socket_fd);
+  } else {
+    setup_socket();
+  }
+
+  // Non-blocking reads with poll() let stop() interrupt the capture loop
+  socket_.non_blocking(true);
+
+  if (!config.symbol_master_path.empty()) {
+    symbols_ = std::make_unique<SymbolMaster>(
+        SymbolMaster::load(config.symbol_master_path, config.max_symbol_id));
+  }
+
+  decoder_ = make_decoder(config.wire_format, symbols_.get());
+  if (decoder_) {
+    // Room for a few of the largest datagrams at least
+    raw_ = std::make_unique<ByteRingBuffer>(std::max(
+        config.decode_ring_size, 4 * (recv_buffer_.size() + sizeof(uint64_t))));
+  }
+  batch_.resize(decoder_ ? decoder_->max_messages(recv_buffer_.size())
+                         : recv_buffer_.size() / sizeof(MarketMessage));
+
+  if (symbols_ || config.price_band_fraction > 0) {
+    bands_ = std::make_unique<PriceBands>(
+        config.max_symbol_id, config.price_band_fraction,
+        config.price_band_rebase, symbols_.get());
+  }
 }
 
 PacketCapture::~PacketCapture() { stop(); }
@@ -47,7 +78,17 @@ void PacketCapture::start() {
   if (running_)
     return;
   running_ = true;
-  capture_thread_ = std::thread([this] { capture_loop(); });
+  capture_thread_ = std::thread([this] {
+    set_thread_name("capture");
+    capture_loop();
+  });
+  if (raw_) {
+    decoding_ = true;
+    decode_thread_ = std::thread([this] {
+      set_thread_name("decode");
+      decode_loop();
+    });
+  }
 }
 
 void PacketCapture::stop() {
@@ -55,13 +96,29 @@ void PacketCapture::stop() {
     return;
   running_ = false;
 
-  // Close socket to interrupt any blocking reads
+  // The decode thread empties raw_ into the ring before it exits
+  if (capture_thread_.joinable()) {
+    capture_thread_.join();
+  }
+  decoding_ = false;
+  if (decode_thread_.joinable()) {
+    decode_thread_.join();
+  }
+
   boost::system::error_code ec;
   socket_.close(ec);
+}
 
+int PacketCapture::release_socket() {
+  running_ = false;
   if (capture_thread_.joinable()) {
     capture_thread_.join();
   }
+  decoding_ = false;
+  if (decode_thread_.joinable()) {
+    decode_thread_.join();
+  }
+  return socket_.release();
 }
 
 void PacketCapture::capture_loop() {
@@ -71,18 +128,37 @@ void PacketCapture::capture_loop() {
   fmt::print("Starting capture loop. Message size: {} bytes\n", msg_size);
 
   while (running_) {
+    heartbeat_.beat();
     try {
+      if (raw_) {
+        if (!receive_raw()) {
+          // Wait for data, waking periodically to check running_
+          pollfd pfd{socket_.native_handle(), POLLIN, 0};
+          ::poll(&pfd, 1, 100); // 100ms timeout
+        }
+        continue;
+      }
+
       // Receive data
       boost::system::error_code ec;
       size_t bytes_received = socket_.receive_from(
           boost::asio::buffer(recv_buffer_), sender_endpoint, 0, ec);
 
+      if (ec == boost::asio::error::would_block ||
+          ec == boost::asio::error::try_again) {
+        // Wait for data, waking periodically to check running_
+        pollfd pfd{socket_.native_handle(), POLLIN, 0};
+        ::poll(&pfd, 1, 100); // 100ms timeout
+        continue;
+      }
+
       if (ec) {
         if (ec != boost::asio::error::would_block) {
           fmt::print(stderr, "Error receiving data: {}\n", ec.message());
         }
         continue;
       }
+      const uint64_t recv_tsc = tracer_ ? CycleClock::now() : 0;
 
       // Only log receive issues or incomplete messages
       if (bytes_received < msg_size || bytes_received % msg_size != 0) {
@@ -94,28 +170,9 @@ void PacketCapture::capture_loop() {
 
       size_t messages_in_packet = bytes_received / msg_size;
 
-      // Process each message
-      for (size_t i = 0; i < messages_in_packet; i++) {
-        const auto *msg = reinterpret_cast<const MarketMessage *>(
-            recv_buffer_.data() + (i * msg_size));
-
-        if (validate_message(*msg)) {
-          if (!buffer_.try_push(*msg)) {
-            const auto dropped = ++messages_dropped_;
-            if (dropped % 1000 == 0) {
-              fmt::print(stderr, "Ring buffer full, dropped {} messages\n",
-                         dropped);
-            }
-          } else {
-            const auto received = ++messages_received_;
-            if (messages_received_ % 10000 == 0) {
-              fmt::print("Successfully received {} messages\n", received);
-            }
-          }
-        } else {
-          ++messages_invalid_;
-        }
-      }
+      // Process the packet's messages as one batch
+      push_batch(reinterpret_cast<const MarketMessage *>(recv_buffer_.data()),
+                 messages_in_packet, recv_tsc);
 
     } catch (const std::exception &e) {
       if (running_) {
@@ -125,14 +182,114 @@ void PacketCapture::capture_loop() {
   }
 }
 
+bool PacketCapture::receive_raw() {
+  auto space = raw_->reserve(sizeof(uint64_t) + recv_buffer_.size());
+  if (space.empty()) {
+    // The decoder is behind; datagrams queue in the socket buffer meanwhile
+    std::this_thread::sleep_for(std::chrono::microseconds(10));
+    return true;
+  }
+
+  boost::asio::ip::udp::endpoint sender_endpoint;
+  boost::system::error_code ec;
+  const size_t bytes_received = socket_.receive_from(
+      boost::asio::buffer(space.data() + sizeof(uint64_t),
+                          space.size() - sizeof(uint64_t)),
+      sender_endpoint, 0, ec);
+  if (ec == boost::asio::error::would_block ||
+      ec == boost::asio::error::try_again) {
+    return false; // The reservation is simply taken again
+  }
+  if (ec) {
+    fmt::print(stderr, "Error receiving data: {}\n", ec.message());
+    return true;
+  }
+
+  const uint64_t recv_tsc = tracer_ ? CycleClock::now() : 0;
+  std::memcpy(space.data(), &recv_tsc, sizeof(recv_tsc));
+  raw_->commit(sizeof(uint64_t) + bytes_received);
+  return true;
+}
+
+void PacketCapture::decode_loop() {
+  // Runs on until the capture thread has exited and every datagram is
+  // decoded
+  while (true) {
+    decode_heartbeat_.beat();
+    const bool stopping = !decoding_;
+    const size_t decoded =
+        raw_->consume(
+            [this](std::span<const std::byte> record) {
+              uint64_t recv_tsc;
+              std::memcpy(&recv_tsc, record.data(), sizeof(recv_tsc));
+              const size_t count =
+                  decoder_->decode(record.subspan(sizeof(uint64_t)), batch_);
+              push_batch(batch_.data(), count, recv_tsc);
+            },
+            64);
+    if (decoded == 0) {
+      if (stopping)
+        break;
+      std::this_thread::sleep_for(std::chrono::microseconds(10));
+    }
+  }
+}
+
+void PacketCapture::set_tracer(Tracer *tracer) {
+  tracer_ = tracer;
+  trace_ring_ = tracer ? &tracer->add_thread("capture") : nullptr;
+}
+
+void PacketCapture::push_batch(const MarketMessage *messages, size_t count,
+                               uint64_t recv_tsc) {
+  // Copy valid messages into batch_ (in place when decoded into it)
+  size_t valid = 0;
+  for (size_t i = 0; i < count; ++i) {
+    batch_[valid] = messages[i];
+    valid += validate_message(messages[i]);
+  }
+  messages_invalid_ += count - valid;
+
+  // Flag out-of-band prices in the same pass over the batch
+  if (bands_) {
+    messages_suspect_ += bands_->classify(std::span(batch_.data(), valid));
+  }
+
+  if (tracer_) {
+    tracer_->tag(std::span(batch_.data(), valid), *trace_ring_, recv_tsc);
+  }
+
+  const size_t pushed = buffer_.push_bulk(batch_.data(), valid);
+  if (tracer_) {
+    Tracer::record(std::span(batch_.data(), pushed), *trace_ring_,
+                   TraceStage::RingPush);
+  }
+  const auto received = messages_received_ += pushed;
+  if (pushed < valid) {
+    const auto dropped = messages_dropped_ += valid - pushed;
+    if (dropped / 1000 != (dropped - (valid - pushed)) / 1000) {
+      fmt::print(stderr, "Ring buffer full, dropped {} messages\n", dropped);
+    }
+  }
+  if (received / 10000 != (received - pushed) / 10000) {
+    fmt::print("Successfully received {} messages\n", received);
+  }
+}
+
 bool PacketCapture::validate_message(const MarketMessage &msg) {
   if (msg.sequence_number == 0 || msg.symbol_id == 0 ||
-      msg.symbol_id > 10000 || // Reasonable max symbol ID
+      msg.symbol_id > config_.max_symbol_id ||
       msg.type != MessageType::Trade || msg.trade.price <= 0 ||
       msg.trade.price > 1000000 || msg.trade.size == 0) {
     return false;
   }
-  return true;
+
+  // Listed symbols only; price bands flag rather than reject
+  return !symbols_ || symbols_->find(msg.symbol_id) != nullptr;
+}
+
+Decoder::Stats PacketCapture::get_decoder_stats() const {
+  return decoder_ ? decoder_->get_stats() : Decoder::Stats{};
 }
 
 CaptureStats PacketCapture::get_stats() const {
@@ -140,6 +297,7 @@ CaptureStats PacketCapture::get_stats() const {
   stats.messages_received = messages_received_.load();
   stats.messages_dropped = messages_dropped_.load();
   stats.messages_invalid = messages_invalid_.load();
+  stats.messages_suspect = messages_suspect_.load();
   stats.messages_processed = stats.messages_received - stats.messages_dropped;
   return stats;
 }
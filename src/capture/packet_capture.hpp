@@ -1,5 +1,11 @@
 #pragma once
 #include "../../include/tick_capture/types.hpp"
+#include "../decode/decoder.hpp"
+#include "../metrics/tracer.hpp"
+#include "../metrics/watchdog.hpp"
+#include "../refdata/symbol_master.hpp"
+#include "byte_ring_buffer.hpp"
+#include "price_bands.hpp"
 #include "ring_buffer.hpp"
 #include <atomic>
 #include <boost/asio.hpp>
@@ -10,7 +16,9 @@ namespace tick_capture {
 
 class PacketCapture {
 public:
-  explicit PacketCapture(const CaptureConfig &config);
+  // With a valid socket_fd the capture adopts an already bound socket
+  // (e.g. one handed over by a predecessor process) instead of opening one
+  explicit PacketCapture(const CaptureConfig &config, int socket_fd = -1);
   ~PacketCapture();
 
   // Non-copyable
@@ -21,20 +29,49 @@ public:
   void start();
   void stop();
 
+  // Stop capturing and give up ownership of the socket, which stays open
+  // and joined to the multicast group. Returns its file descriptor.
+  int release_socket();
+
   // Get statistics
   CaptureStats get_stats() const;
 
+  // Decoder statistics (all zero for the native wire format)
+  Decoder::Stats get_decoder_stats() const;
+
+  // Symbol master used for validation (null if none is configured)
+  const SymbolMaster *symbol_master() const { return symbols_.get(); }
+
+  // Sample ticks into a tracer; call before start()
+  void set_tracer(Tracer *tracer);
+
+  // Progress of the capture thread, for a Watchdog
+  const Heartbeat &heartbeat() const { return heartbeat_; }
+  // Progress of the decode thread, null for the native wire format
+  const Heartbeat *decode_heartbeat() const {
+    return raw_ ? &decode_heartbeat_ : nullptr;
+  }
+
   // Access the packet buffer
   RingBuffer<MarketMessage> &get_buffer() { return buffer_; }
 
 private:
   void setup_socket();
   void capture_loop();
+  // Receive one datagram into raw_; false if none was waiting
+  bool receive_raw();
+  void decode_loop();
+  void push_batch(const MarketMessage *messages, size_t count,
+                  uint64_t recv_tsc);
   bool validate_message(const MarketMessage &msg);
 
   CaptureConfig config_;
   std::atomic<bool> running_{false};
   std::thread capture_thread_;
+  Heartbeat heartbeat_;
+  std::atomic<bool> decoding_{false}; // Until the capture thread exits
+  std::thread decode_thread_;
+  Heartbeat decode_heartbeat_;
 
   // Network resources
   boost::asio::io_context io_context_;
@@ -45,6 +82,26 @@ private:
   std::atomic<uint64_t> messages_received_{0};
   std::atomic<uint64_t> messages_dropped_{0};
   std::atomic<uint64_t> messages_invalid_{0};
+  std::atomic<uint64_t> messages_suspect_{0};
+
+  // Reference data, shared with the decoder
+  std::unique_ptr<SymbolMaster> symbols_;
+
+  // Venue wire format decoding, null for native MarketMessages. The
+  // capture thread receives datagrams into raw_, each prefixed with its
+  // receive timestamp, and the decode thread decodes them in place.
+  std::unique_ptr<Decoder> decoder_;
+  std::unique_ptr<ByteRingBuffer> raw_;
+
+  // Stage tracing, null unless enabled
+  Tracer *tracer_{nullptr};
+  TraceRing *trace_ring_{nullptr};
+
+  // Per-symbol price bands, null when none are configured
+  std::unique_ptr<PriceBands> bands_;
+
+  // One packet's messages between decoding/validation and the ring
+  std::vector<MarketMessage> batch_;
 
   // Buffers
   std::vector<char> recv_buffer_;
@@ -0,0 +1,61 @@
+#include "price_bands.hpp"
+#include <cmath>
+#include <cstddef>
+#include <limits>
+
+namespace tick_capture {
+
+PriceBands::PriceBands(uint32_t max_symbol_id, double band_fraction,
+                       uint32_t rebase_after, const SymbolMaster *symbols)
+    : bands_(static_cast<size_t>(max_symbol_id) + 1, Band{}),
+      band_fraction_(band_fraction > 0
+                         ? band_fraction
+                         : std::numeric_limits<double>::infinity()),
+      rebase_after_(rebase_after) {
+  // Copy static bands in so classification never touches the master
+  if (symbols) {
+    for (uint32_t id = 1; id <= max_symbol_id; ++id) {
+      if (const auto *info = symbols->find(id)) {
+        bands_[id].static_low = info->price_low;
+        bands_[id].static_high = info->price_high;
+      }
+    }
+  }
+}
+
+size_t PriceBands::classify(std::span<MarketMessage> batch) noexcept {
+  size_t flagged = 0;
+
+  for (auto &msg : batch) {
+    auto &band = bands_[msg.symbol_id];
+    const double price = msg.trade.price;
+
+    const bool outside_static =
+        band.static_high > band.static_low &&
+        (price < band.static_low || price > band.static_high);
+    const bool outside_dynamic =
+        band.reference > 0 &&
+        std::fabs(price - band.reference) > band.reference * band_fraction_;
+
+    if (outside_static || outside_dynamic) {
+      // The flags are covered; a bad wire checksum stays bad
+      constexpr size_t kFlags = offsetof(MarketMessage, trade.flags);
+      msg.toggle_checksum(kFlags, 1);
+      msg.trade.flags |= kTradeSuspect;
+      msg.toggle_checksum(kFlags, 1);
+      ++flagged;
+
+      // A run of suspect prints inside the static band is a real move
+      if (!outside_static && ++band.suspect_run >= rebase_after_) {
+        band.reference = price;
+        band.suspect_run = 0;
+      }
+    } else {
+      band.reference = price;
+      band.suspect_run = 0;
+    }
+  }
+  return flagged;
+}
+
+} // namespace tick_capture
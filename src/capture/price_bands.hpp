@@ -0,0 +1,52 @@
+#pragma once
+#include "../../include/tick_capture/types.hpp"
+#include "../refdata/symbol_master.hpp"
+#include <span>
+#include <vector>
+
+namespace tick_capture {
+
+// Per-symbol price bands applied to each batch of validated trades. A trade
+// outside its band keeps flowing but is flagged kTradeSuspect, so consumers
+// can filter without a second pass.
+//
+// Two bands are checked: the static band from the symbol master, and a
+// dynamic band of +/- band_fraction around the symbol's last accepted
+// price. The dynamic reference moves with every accepted trade. After
+// rebase_after consecutive suspect trades inside the static band, the
+// latest price becomes the new reference, so a genuine gap stops being
+// flagged.
+//
+// State is one 32-byte entry per symbol id in a flat array, indexed
+// directly. Only the capture thread touches it.
+class PriceBands {
+public:
+  PriceBands(uint32_t max_symbol_id, double band_fraction,
+             uint32_t rebase_after, const SymbolMaster *symbols);
+
+  // Flag suspect trades in place, folding the change into their checksums
+  // so a corrupt tick's stays wrong; returns how many were flagged. Symbol
+  // ids must already be validated against max_symbol_id.
+  size_t classify(std::span<MarketMessage> batch) noexcept;
+
+  // Last accepted price of a symbol (0 before its first trade)
+  double reference(uint32_t symbol_id) const {
+    return symbol_id < bands_.size() ? bands_[symbol_id].reference : 0.0;
+  }
+
+private:
+  struct Band {
+    double reference;
+    double static_low; // static_high <= static_low: no static band
+    double static_high;
+    uint32_t suspect_run;
+    uint32_t padding;
+  };
+  static_assert(sizeof(Band) == 32);
+
+  std::vector<Band> bands_;
+  double band_fraction_; // Infinite when the dynamic band is disabled
+  uint32_t rebase_after_;
+};
+
+} // namespace tick_capture
@@ -1,4 +1,5 @@
 #pragma once
+#include <algorithm>
 #include <atomic>
 #include <optional>
 #include <type_traits>
@@ -28,6 +29,7 @@ template <typename T> class RingBuffer {
   std::atomic<size_t> total_pushed_{0};
   std::atomic<size_t> total_popped_{0};
   std::atomic<size_t> push_failures_{0};
+  std::atomic<size_t> high_water_{0}; // Written by the producer only
 
 public:
   explicit RingBuffer(size_t size)
@@ -38,7 +40,8 @@ public:
     const auto next_write = (current_write + 1) & mask_;
 
     // Check if buffer is full
-    if (next_write == read_idx_.value.load(std::memory_order_acquire)) {
+    const auto read = read_idx_.value.load(std::memory_order_acquire);
+    if (next_write == read) {
       push_failures_++;
       return false;
     }
@@ -47,9 +50,32 @@ public:
     buffer_[current_write] = item;
     write_idx_.value.store(next_write, std::memory_order_release);
     total_pushed_++;
+    note_occupancy(((current_write - read) & mask_) + 1);
     return true;
   }
 
+  // Push as many of items as fit, publishing them with one index update.
+  // Returns the number pushed.
+  size_t push_bulk(const T *items, size_t count) noexcept {
+    const auto current_write = write_idx_.value.load(std::memory_order_relaxed);
+    const auto read = read_idx_.value.load(std::memory_order_acquire);
+    const size_t used = (current_write - read) & mask_;
+    const size_t pushed = std::min(count, buffer_.size() - 1 - used);
+
+    for (size_t i = 0; i < pushed; ++i) {
+      buffer_[(current_write + i) & mask_] = items[i];
+    }
+    write_idx_.value.store((current_write + pushed) & mask_,
+                           std::memory_order_release);
+
+    total_pushed_ += pushed;
+    note_occupancy(used + pushed);
+    if (pushed < count) {
+      push_failures_ += count - pushed;
+    }
+    return pushed;
+  }
+
   std::optional<T> try_pop() noexcept {
     const auto current_read = read_idx_.value.load(std::memory_order_relaxed);
 
@@ -114,7 +140,19 @@ public:
   size_t total_popped() const noexcept { return total_popped_; }
   size_t push_failures() const noexcept { return push_failures_; }
 
+  // Most entries held at once since the last call, which starts a new
+  // window. A push racing the reset may be counted in either window.
+  size_t take_high_water() noexcept {
+    return high_water_.exchange(0, std::memory_order_relaxed);
+  }
+
 private:
+  void note_occupancy(size_t used) noexcept {
+    if (used > high_water_.load(std::memory_order_relaxed)) {
+      high_water_.store(used, std::memory_order_relaxed);
+    }
+  }
+
   // Helper function to get next power of 2
   static size_t next_power_of_2(size_t v) {
     v--;
@@ -0,0 +1,180 @@
+#include "shm_ring.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <fmt/format.h>
+#include <new>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+namespace tick_capture {
+
+namespace {
+
+constexpr uint64_t kMagic = 0x5449434b52494e47; // "TICKRING"
+
+size_t round_up_pow2(size_t v) {
+  size_t p = 1;
+  while (p < v)
+    p <<= 1;
+  return p;
+}
+
+} // namespace
+
+ShmRing::ShmRing(std::string name, void *base, size_t bytes, bool owner)
+    : name_(std::move(name)), base_(base), bytes_(bytes), owner_(owner) {}
+
+ShmRing ShmRing::create(const std::string &name, size_t capacity) {
+  capacity = round_up_pow2(std::max<size_t>(capacity, 2));
+  const size_t bytes = sizeof(Header) + capacity * sizeof(MarketMessage);
+
+  const int fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd < 0) {
+    throw std::runtime_error(fmt::format(
+        "Failed to create shared memory {}: {}", name, std::strerror(errno)));
+  }
+  if (::ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+    const int err = errno;
+    ::close(fd);
+    ::shm_unlink(name.c_str());
+    throw std::runtime_error(fmt::format("Failed to size shared memory {}: {}",
+                                         name, std::strerror(err)));
+  }
+
+  void *base =
+      ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (base == MAP_FAILED) {
+    const int err = errno;
+    ::shm_unlink(name.c_str());
+    throw std::runtime_error(fmt::format("Failed to map shared memory {}: {}",
+                                         name, std::strerror(err)));
+  }
+
+  auto *header = new (base) Header{};
+  header->capacity = capacity;
+  header->write_idx.store(0, std::memory_order_relaxed);
+  header->read_idx.store(0, std::memory_order_relaxed);
+  header->closed.store(0, std::memory_order_relaxed);
+  // Publish the magic last so a reader never sees a half-built header
+  std::atomic_thread_fence(std::memory_order_release);
+  header->magic = kMagic;
+
+  return ShmRing(name, base, bytes, true);
+}
+
+ShmRing ShmRing::open(const std::string &name) {
+  const int fd = ::shm_open(name.c_str(), O_RDWR, 0600);
+  if (fd < 0) {
+    throw std::runtime_error(fmt::format("Failed to open shared memory {}: {}",
+                                         name, std::strerror(errno)));
+  }
+
+  struct stat st {};
+  if (::fstat(fd, &st) != 0 ||
+      static_cast<size_t>(st.st_size) < sizeof(Header)) {
+    ::close(fd);
+    throw std::runtime_error(
+        fmt::format("Shared memory {} is too small", name));
+  }
+
+  const auto bytes = static_cast<size_t>(st.st_size);
+  void *base =
+      ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (base == MAP_FAILED) {
+    throw std::runtime_error(fmt::format("Failed to map shared memory {}: {}",
+                                         name, std::strerror(errno)));
+  }
+
+  const auto *header = static_cast<const Header *>(base);
+  if (header->magic != kMagic ||
+      sizeof(Header) + header->capacity * sizeof(MarketMessage) > bytes) {
+    ::munmap(base, bytes);
+    throw std::runtime_error(
+        fmt::format("Shared memory {} is not a tick ring", name));
+  }
+
+  return ShmRing(name, base, bytes, false);
+}
+
+ShmRing::~ShmRing() {
+  if (base_) {
+    ::munmap(base_, bytes_);
+  }
+  if (owner_) {
+    unlink();
+  }
+}
+
+ShmRing::ShmRing(ShmRing &&other) noexcept
+    : name_(std::move(other.name_)), base_(std::exchange(other.base_, nullptr)),
+      bytes_(std::exchange(other.bytes_, 0)),
+      owner_(std::exchange(other.owner_, false)) {}
+
+ShmRing &ShmRing::operator=(ShmRing &&other) noexcept {
+  if (this != &other) {
+    if (base_) {
+      ::munmap(base_, bytes_);
+    }
+    if (owner_) {
+      unlink();
+    }
+    name_ = std::move(other.name_);
+    base_ = std::exchange(other.base_, nullptr);
+    bytes_ = std::exchange(other.bytes_, 0);
+    owner_ = std::exchange(other.owner_, false);
+  }
+  return *this;
+}
+
+bool ShmRing::try_push(const MarketMessage &msg) noexcept {
+  auto *h = header();
+  const auto write = h->write_idx.load(std::memory_order_relaxed);
+  if (write - h->read_idx.load(std::memory_order_acquire) >= h->capacity) {
+    return false;
+  }
+  slots()[write & (h->capacity - 1)] = msg;
+  h->write_idx.store(write + 1, std::memory_order_release);
+  return true;
+}
+
+bool ShmRing::try_pop(MarketMessage &msg) noexcept {
+  auto *h = header();
+  const auto read = h->read_idx.load(std::memory_order_relaxed);
+  if (read == h->write_idx.load(std::memory_order_acquire)) {
+    return false;
+  }
+  msg = slots()[read & (h->capacity - 1)];
+  h->read_idx.store(read + 1, std::memory_order_release);
+  return true;
+}
+
+void ShmRing::close() noexcept {
+  header()->closed.store(1, std::memory_order_release);
+}
+
+bool ShmRing::closed() const noexcept {
+  return header()->closed.load(std::memory_order_acquire) != 0;
+}
+
+size_t ShmRing::size() const noexcept {
+  const auto *h = header();
+  return h->write_idx.load(std::memory_order_acquire) -
+         h->read_idx.load(std::memory_order_acquire);
+}
+
+size_t ShmRing::capacity() const noexcept { return header()->capacity; }
+
+void ShmRing::unlink() noexcept {
+  if (!name_.empty()) {
+    ::shm_unlink(name_.c_str());
+  }
+  owner_ = false;
+}
+
+} // namespace tick_capture
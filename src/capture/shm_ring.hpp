@@ -0,0 +1,67 @@
+#pragma once
+#include "../../include/tick_capture/types.hpp"
+#include <atomic>
+#include <string>
+
+namespace tick_capture {
+
+// Single-producer/single-consumer ring of MarketMessages in POSIX shared
+// memory, so ticks can be handed from one process to another. The creating
+// process owns the name and unlinks it on destruction; the other side opens
+// it by name.
+class ShmRing {
+public:
+  // Create a new segment with at least `capacity` slots
+  static ShmRing create(const std::string &name, size_t capacity);
+
+  // Map an existing segment created by another process
+  static ShmRing open(const std::string &name);
+
+  ~ShmRing();
+
+  // Non-copyable, movable
+  ShmRing(const ShmRing &) = delete;
+  ShmRing &operator=(const ShmRing &) = delete;
+  ShmRing(ShmRing &&other) noexcept;
+  ShmRing &operator=(ShmRing &&other) noexcept;
+
+  bool try_push(const MarketMessage &msg) noexcept;
+  bool try_pop(MarketMessage &msg) noexcept;
+
+  // Producer marks the ring complete; nothing is pushed afterwards
+  void close() noexcept;
+  bool closed() const noexcept;
+
+  size_t size() const noexcept;
+  size_t capacity() const noexcept;
+  const std::string &name() const { return name_; }
+
+  // Remove the name so the segment is freed once every mapping is gone
+  void unlink() noexcept;
+
+private:
+  struct Header {
+    uint64_t magic;
+    uint64_t capacity;
+    alignas(64) std::atomic<uint64_t> write_idx;
+    alignas(64) std::atomic<uint64_t> read_idx;
+    alignas(64) std::atomic<uint32_t> closed;
+  };
+  static_assert(std::atomic<uint64_t>::is_always_lock_free,
+                "Shared-memory indices must be lock-free");
+
+  ShmRing(std::string name, void *base, size_t bytes, bool owner);
+
+  MarketMessage *slots() const {
+    return reinterpret_cast<MarketMessage *>(
+        static_cast<char *>(base_) + sizeof(Header));
+  }
+  Header *header() const { return static_cast<Header *>(base_); }
+
+  std::string name_;
+  void *base_{nullptr};
+  size_t bytes_{0};
+  bool owner_{false};
+};
+
+} // namespace tick_capture
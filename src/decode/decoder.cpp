@@ -0,0 +1,28 @@
+#include "decoder.hpp"
+#include "itch_decoder.hpp"
+
+namespace tick_capture {
+
+Decoder::Stats Decoder::get_stats() const {
+  Stats stats;
+  stats.packets = packets_.load(std::memory_order_relaxed);
+  stats.messages = messages_.load(std::memory_order_relaxed);
+  stats.emitted = emitted_.load(std::memory_order_relaxed);
+  stats.ignored = ignored_.load(std::memory_order_relaxed);
+  stats.malformed = malformed_.load(std::memory_order_relaxed);
+  stats.sequence_gaps = sequence_gaps_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+std::unique_ptr<Decoder> make_decoder(WireFormat format,
+                                      const SymbolMaster *symbols) {
+  switch (format) {
+  case WireFormat::MoldUdp64Itch:
+    return std::make_unique<ItchDecoder>(symbols);
+  case WireFormat::Native:
+    break;
+  }
+  return nullptr;
+}
+
+} // namespace tick_capture
@@ -0,0 +1,50 @@
+#pragma once
+#include "../../include/tick_capture/types.hpp"
+#include "../refdata/symbol_master.hpp"
+#include <atomic>
+#include <memory>
+#include <span>
+
+namespace tick_capture {
+
+// Turns one venue datagram into normalised MarketMessages. Decoders run on
+// the capture's decode thread, so decode() must not allocate or block.
+class Decoder {
+public:
+  struct Stats {
+    uint64_t packets{0};
+    uint64_t messages{0}; // Venue messages seen
+    uint64_t emitted{0};  // MarketMessages produced
+    uint64_t ignored{0};  // Message types with no normalised form
+    uint64_t malformed{0};
+    uint64_t sequence_gaps{0}; // Venue messages missed between packets
+  };
+
+  virtual ~Decoder() = default;
+
+  // Decode a datagram into out; returns the number of messages written.
+  // out must hold at least max_messages(packet.size()) entries.
+  virtual size_t decode(std::span<const std::byte> packet,
+                        std::span<MarketMessage> out) = 0;
+
+  // Upper bound on messages produced from a datagram of this many bytes
+  virtual size_t max_messages(size_t packet_bytes) const = 0;
+
+  Stats get_stats() const;
+
+protected:
+  // Updated by the decode thread only
+  std::atomic<uint64_t> packets_{0};
+  std::atomic<uint64_t> messages_{0};
+  std::atomic<uint64_t> emitted_{0};
+  std::atomic<uint64_t> ignored_{0};
+  std::atomic<uint64_t> malformed_{0};
+  std::atomic<uint64_t> sequence_gaps_{0};
+};
+
+// Decoder for a wire format, or nullptr for WireFormat::Native. With a
+// symbol master, decoders that see venue tickers map them to master ids.
+std::unique_ptr<Decoder> make_decoder(WireFormat format,
+                                      const SymbolMaster *symbols = nullptr);
+
+} // namespace tick_capture
@@ -0,0 +1,162 @@
+#include "itch_decoder.hpp"
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+namespace tick_capture {
+
+namespace {
+
+template <typename Schema, typename Context>
+void fill_trade(const std::byte *msg, const Context &ctx, uint32_t shares,
+                uint8_t flags, MarketMessage &out) {
+  const uint16_t locate = Schema::StockLocate::read(msg);
+  out = MarketMessage{};
+  out.timestamp = ctx.midnight_ns + Schema::Timestamp::read(msg);
+  out.symbol_id = ctx.locate_ids ? ctx.locate_ids[locate] : locate;
+  out.type = MessageType::Trade;
+  out.trade.price = Schema::Price::read(msg) / 10000.0;
+  out.trade.size = shares;
+  out.trade.flags = flags;
+}
+
+} // namespace
+
+// One handler per message type byte, so dispatch is a single indexed call
+const std::array<ItchDecoder::Handler, 256> ItchDecoder::handlers_ = [] {
+  std::array<Handler, 256> table{};
+
+  table.fill([](const std::byte *, size_t, Context &ctx,
+                MarketMessage &) -> size_t {
+    ++ctx.ignored;
+    return 0;
+  });
+
+  table[Trade::type] = [](const std::byte *msg, size_t length, Context &ctx,
+                          MarketMessage &out) -> size_t {
+    if (length < Trade::length) {
+      ++ctx.malformed;
+      return 0;
+    }
+    // Side is the resting order's: a resting sell was lifted by a buyer
+    const uint8_t flags =
+        Trade::Side::read(msg) == 'S' ? kTradeBuyerInitiated : 0;
+    fill_trade<Trade>(msg, ctx, Trade::Shares::read(msg), flags, out);
+    return 1;
+  };
+
+  table[CrossTrade::type] = [](const std::byte *msg, size_t length,
+                               Context &ctx, MarketMessage &out) -> size_t {
+    if (length < CrossTrade::length) {
+      ++ctx.malformed;
+      return 0;
+    }
+    const auto shares = static_cast<uint32_t>(
+        std::min<uint64_t>(CrossTrade::Shares::read(msg),
+                           std::numeric_limits<uint32_t>::max()));
+    fill_trade<CrossTrade>(msg, ctx, shares, kTradeCross, out);
+    return 1;
+  };
+
+  table[StockDirectory::type] = [](const std::byte *msg, size_t length,
+                                   Context &ctx, MarketMessage &) -> size_t {
+    if (length < StockDirectory::length) {
+      ++ctx.malformed;
+    } else if (ctx.locate_ids) {
+      ctx.locate_ids[StockDirectory::StockLocate::read(msg)] =
+          ctx.symbols->intern(StockDirectory::Stock::read(msg));
+    } else {
+      ++ctx.ignored;
+    }
+    return 0;
+  };
+
+  return table;
+}();
+
+ItchDecoder::ItchDecoder(const SymbolMaster *symbols, uint64_t midnight_ns)
+    : symbols_(symbols), midnight_ns_(midnight_ns) {
+  if (symbols_) {
+    locate_ids_.assign(size_t{1} << 16, 0); // Locate codes are 16-bit
+  }
+}
+
+uint64_t ItchDecoder::utc_midnight_ns() {
+  using namespace std::chrono;
+  const auto midnight = floor<days>(system_clock::now());
+  return duration_cast<nanoseconds>(midnight.time_since_epoch()).count();
+}
+
+size_t ItchDecoder::max_messages(size_t packet_bytes) const {
+  // Every emitted message takes a 2-byte length and a full trade body
+  return packet_bytes / (2 + CrossTrade::length) + 1;
+}
+
+size_t ItchDecoder::decode(std::span<const std::byte> packet,
+                           std::span<MarketMessage> out) {
+  packets_.fetch_add(1, std::memory_order_relaxed);
+  if (packet.size() < MoldHeader::length) {
+    malformed_.fetch_add(1, std::memory_order_relaxed);
+    return 0;
+  }
+
+  const std::byte *p = packet.data();
+  const uint64_t sequence = MoldHeader::Sequence::read(p);
+  uint16_t count = MoldHeader::Count::read(p);
+  if (count == 0xFFFF) {
+    count = 0; // End of session
+  }
+
+  // Messages below the expected sequence were already seen (retransmits)
+  uint64_t skip = 0;
+  if (expected_sequence_ != 0) {
+    if (sequence > expected_sequence_) {
+      sequence_gaps_.fetch_add(sequence - expected_sequence_,
+                               std::memory_order_relaxed);
+    } else {
+      skip = expected_sequence_ - sequence;
+    }
+  }
+
+  Context ctx{midnight_ns_, symbols_,
+              locate_ids_.empty() ? nullptr : locate_ids_.data()};
+  const std::byte *end = p + packet.size();
+  p += MoldHeader::length;
+  size_t emitted = 0;
+  uint16_t seen = 0;
+
+  for (; seen < count && emitted < out.size(); ++seen) {
+    if (end - p < 2) {
+      ++ctx.malformed;
+      break;
+    }
+    const size_t length = load_be<uint16_t>(p);
+    p += 2;
+    if (length == 0 || static_cast<size_t>(end - p) < length) {
+      ++ctx.malformed;
+      break;
+    }
+
+    if (seen >= skip) {
+      const auto type = static_cast<uint8_t>(p[0]);
+      auto &msg = out[emitted];
+      const size_t written = handlers_[type](p, length, ctx, msg);
+      // Unconditional: a slot nothing was written to is reused next time
+      msg.sequence_number = next_sequence_;
+      msg.update_checksum();
+      next_sequence_ += written;
+      emitted += written;
+    }
+    p += length;
+  }
+
+  expected_sequence_ = std::max(expected_sequence_, sequence + seen);
+
+  messages_.fetch_add(seen, std::memory_order_relaxed);
+  emitted_.fetch_add(emitted, std::memory_order_relaxed);
+  ignored_.fetch_add(ctx.ignored, std::memory_order_relaxed);
+  malformed_.fetch_add(ctx.malformed, std::memory_order_relaxed);
+  return emitted;
+}
+
+} // namespace tick_capture
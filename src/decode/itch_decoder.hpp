@@ -0,0 +1,77 @@
+#pragma once
+#include "decoder.hpp"
+#include "schema.hpp"
+#include <array>
+#include <vector>
+
+namespace tick_capture {
+
+// Nasdaq TotalView-ITCH 5.0 carried in MoldUDP64 packets. Executions that
+// print to the tape ('P' non-cross trade and 'Q' cross trade) become Trade
+// messages keyed by stock locate code; other message types are counted and
+// skipped. With a symbol master, 'R' stock directory messages map each
+// locate code to the master id of its ticker, and trades carry that id
+// instead (0, and so rejected, until the directory entry is seen). Emitted
+// messages get dense sequence numbers of their own, and
+// MoldUDP64 sequence gaps are counted in the stats instead.
+class ItchDecoder : public Decoder {
+public:
+  struct MoldHeader : MessageSchema<'\0', 20> {
+    using Sequence = Field<uint64_t, 10>;
+    using Count = Field<uint16_t, 18>;
+  };
+
+  struct StockDirectory : MessageSchema<'R', 39> {
+    using StockLocate = Field<uint16_t, 1>;
+    using Stock = Text<11, 8>;
+  };
+
+  struct Trade : MessageSchema<'P', 44> {
+    using StockLocate = Field<uint16_t, 1>;
+    using Timestamp = Field<uint64_t, 5, 6>; // ns since midnight
+    using Side = Field<uint8_t, 19>; // Of the resting order
+    using Shares = Field<uint32_t, 20>;
+    using Price = Field<uint32_t, 32>; // 4 implied decimals
+  };
+
+  struct CrossTrade : MessageSchema<'Q', 40> {
+    using StockLocate = Field<uint16_t, 1>;
+    using Timestamp = Field<uint64_t, 5, 6>;
+    using Shares = Field<uint64_t, 11>;
+    using Price = Field<uint32_t, 27>;
+  };
+
+  // ITCH timestamps count from midnight; midnight_ns places them on the
+  // epoch timeline (default: the most recent UTC midnight)
+  explicit ItchDecoder(const SymbolMaster *symbols = nullptr,
+                       uint64_t midnight_ns = utc_midnight_ns());
+
+  size_t decode(std::span<const std::byte> packet,
+                std::span<MarketMessage> out) override;
+  size_t max_messages(size_t packet_bytes) const override;
+
+  static uint64_t utc_midnight_ns();
+
+private:
+  // Per-packet state shared with the message handlers
+  struct Context {
+    uint64_t midnight_ns;
+    const SymbolMaster *symbols;
+    uint32_t *locate_ids; // Locate code -> symbol id, null without a master
+    uint64_t ignored{0};
+    uint64_t malformed{0};
+  };
+
+  // Returns the number of messages written to out (0 or 1)
+  using Handler = size_t (*)(const std::byte *msg, size_t length,
+                             Context &ctx, MarketMessage &out);
+  static const std::array<Handler, 256> handlers_;
+
+  const SymbolMaster *symbols_;
+  std::vector<uint32_t> locate_ids_;
+  uint64_t midnight_ns_;
+  uint64_t expected_sequence_{0}; // Next MoldUDP64 sequence number
+  uint64_t next_sequence_{1};     // Next emitted sequence number
+};
+
+} // namespace tick_capture
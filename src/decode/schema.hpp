@@ -0,0 +1,70 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+
+namespace tick_capture {
+
+// Read a big-endian unsigned integer of Width bytes (Width <= sizeof(T)),
+// e.g. the 6-byte timestamps of ITCH. Compiles to a load and a byte swap.
+template <typename T, size_t Width = sizeof(T)>
+inline T load_be(const std::byte *p) noexcept {
+  static_assert(std::is_unsigned_v<T> && Width <= sizeof(T) && Width > 0);
+  if constexpr (Width == 1) {
+    return static_cast<T>(p[0]);
+  } else if constexpr (Width == sizeof(T)) {
+    T value;
+    std::memcpy(&value, p, sizeof(T));
+    if constexpr (sizeof(T) == 2)
+      return __builtin_bswap16(value);
+    else if constexpr (sizeof(T) == 4)
+      return __builtin_bswap32(value);
+    else
+      return __builtin_bswap64(value);
+  } else {
+    // Odd widths: load into the low bytes of a 64-bit value
+    uint64_t value = 0;
+    std::memcpy(reinterpret_cast<std::byte *>(&value) + (8 - Width), p,
+                Width);
+    return static_cast<T>(__builtin_bswap64(value));
+  }
+}
+
+// Compile-time layout of one fixed-length venue message. Fields are
+// declared against the schema, so a field that does not fit the message
+// is a compile error rather than an out-of-bounds read:
+//
+//   struct Trade : MessageSchema<'P', 44> {
+//     using Price = Field<uint32_t, 32>;
+//   };
+//   uint32_t price = Trade::Price::read(msg);
+template <char Type, size_t Length> struct MessageSchema {
+  static constexpr uint8_t type = static_cast<uint8_t>(Type);
+  static constexpr size_t length = Length;
+
+  template <typename T, size_t Offset, size_t Width = sizeof(T)>
+  struct Field {
+    static_assert(Offset + Width <= Length, "Field lies outside the message");
+
+    static T read(const std::byte *msg) noexcept {
+      return load_be<T, Width>(msg + Offset);
+    }
+  };
+
+  // Space-padded alphanumeric field, returned without the padding
+  template <size_t Offset, size_t Width> struct Text {
+    static_assert(Offset + Width <= Length, "Field lies outside the message");
+
+    static std::string_view read(const std::byte *msg) noexcept {
+      const auto *text = reinterpret_cast<const char *>(msg + Offset);
+      size_t size = Width;
+      while (size > 0 && text[size - 1] == ' ')
+        --size;
+      return {text, size};
+    }
+  };
+};
+
+} // namespace tick_capture
@@ -0,0 +1,188 @@
+#include "event_loop.hpp"
+#include "../metrics/thread_stats.hpp"
+#include <cerrno>
+#include <cstring>
+#include <fmt/format.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <vector>
+#include <zmq.h>
+
+namespace tick_capture {
+
+EventLoop::EventLoop(const std::string &name,
+                     std::chrono::nanoseconds resolution)
+    : name_(name), wheel_(resolution) {
+  wake_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (wake_fd_ < 0) {
+    throw std::runtime_error(
+        fmt::format("Failed to create eventfd: {}", std::strerror(errno)));
+  }
+}
+
+EventLoop::~EventLoop() {
+  stop();
+  ::close(wake_fd_);
+}
+
+void EventLoop::start() {
+  if (running_)
+    return;
+  running_ = true;
+  thread_ = std::thread([this] {
+    set_thread_name(name_.c_str());
+    loop_thread_id_ = std::this_thread::get_id();
+    run();
+    loop_thread_id_ = std::thread::id();
+  });
+}
+
+void EventLoop::stop() {
+  if (!running_)
+    return;
+  running_ = false;
+  wake();
+
+  if (thread_.joinable())
+    thread_.join();
+}
+
+EventLoop::Handle EventLoop::schedule(Clock::duration delay,
+                                      Callback callback) {
+  return add(Clock::now() + delay, std::move(callback),
+             Clock::duration::zero());
+}
+
+EventLoop::Handle EventLoop::schedule_every(Clock::duration period,
+                                            Callback callback) {
+  return add(Clock::now() + period, std::move(callback), period);
+}
+
+bool EventLoop::reschedule(Handle handle, Clock::duration delay) {
+  const auto deadline = Clock::now() + delay;
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!wheel_.reschedule(handle, deadline))
+    return false;
+  if (deadline < sleeping_until_)
+    wake();
+  return true;
+}
+
+void EventLoop::cancel(Handle handle) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  wheel_.cancel(handle);
+  if (!in_loop()) {
+    done_cv_.wait(lock, [&] { return !(firing_ == handle); });
+  }
+}
+
+void EventLoop::watch(void *socket, Callback handler) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    watches_[socket] = std::move(handler);
+  }
+  wake(); // Poll the new socket too
+}
+
+void EventLoop::unwatch(void *socket) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  watches_.erase(socket);
+  if (!in_loop()) {
+    done_cv_.wait(lock, [&] { return handling_ != socket; });
+  }
+}
+
+bool EventLoop::in_loop() const {
+  return loop_thread_id_.load() == std::this_thread::get_id();
+}
+
+EventLoop::Handle EventLoop::add(Clock::time_point deadline,
+                                 Callback callback, Clock::duration period) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const auto handle = wheel_.schedule(
+      deadline,
+      [this, callback = std::move(callback)] { fire(callback); }, period);
+  if (deadline < sleeping_until_)
+    wake();
+  return handle;
+}
+
+void EventLoop::fire(const Callback &callback) {
+  firing_ = wheel_.firing();
+  loop_lock_->unlock();
+  try {
+    callback();
+  } catch (const std::exception &e) {
+    fmt::print(stderr, "{} timer failed: {}\n", name_, e.what());
+  }
+  loop_lock_->lock();
+  firing_ = {};
+  done_cv_.notify_all();
+}
+
+void EventLoop::wake() {
+  const uint64_t one = 1;
+  [[maybe_unused]] const ssize_t n = ::write(wake_fd_, &one, sizeof(one));
+}
+
+void EventLoop::run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  loop_lock_ = &lock;
+  std::vector<zmq_pollitem_t> items;
+  std::vector<void *> sockets;
+
+  while (running_) {
+    wheel_.advance(Clock::now());
+
+    items.assign(1, {nullptr, wake_fd_, ZMQ_POLLIN, 0});
+    sockets.clear();
+    for (const auto &[socket, handler] : watches_) {
+      items.push_back({socket, 0, ZMQ_POLLIN, 0});
+      sockets.push_back(socket);
+    }
+
+    // Sleep until the next timer, rounded up to whole milliseconds
+    const auto next = wheel_.next_deadline();
+    long timeout = -1;
+    if (next != Clock::time_point::max()) {
+      const auto wait = std::chrono::ceil<std::chrono::milliseconds>(
+          next - Clock::now());
+      timeout = std::max<long>(wait.count(), 0);
+    }
+    sleeping_until_ = next;
+    lock.unlock();
+    const int ready =
+        zmq_poll(items.data(), static_cast<int>(items.size()), timeout);
+    lock.lock();
+    sleeping_until_ = Clock::time_point::min();
+
+    if (ready <= 0)
+      continue;
+    if (items[0].revents & ZMQ_POLLIN) {
+      uint64_t count;
+      [[maybe_unused]] const ssize_t n =
+          ::read(wake_fd_, &count, sizeof(count));
+    }
+    for (size_t i = 0; i < sockets.size(); ++i) {
+      const auto it = watches_.find(sockets[i]);
+      if (!(items[i + 1].revents & ZMQ_POLLIN) || it == watches_.end())
+        continue;
+
+      // A copy, as the handler may unwatch its own socket
+      const Callback handler = it->second;
+      handling_ = sockets[i];
+      lock.unlock();
+      try {
+        handler();
+      } catch (const std::exception &e) {
+        fmt::print(stderr, "{} handler failed: {}\n", name_, e.what());
+      }
+      lock.lock();
+      handling_ = nullptr;
+      done_cv_.notify_all();
+    }
+  }
+  loop_lock_ = nullptr;
+}
+
+} // namespace tick_capture
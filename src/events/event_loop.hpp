@@ -0,0 +1,85 @@
+#pragma once
+#include "timer_wheel.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace tick_capture {
+
+// One thread running a node's housekeeping: timers from a TimerWheel and
+// handlers for ZMQ sockets with messages waiting. It sleeps in zmq_poll
+// until the next timer is due or a socket becomes readable, so idle timers
+// and sockets cost nothing, and other threads wake it through an eventfd
+// when they add an earlier timer.
+//
+// Timers and watches can be added and removed from any thread. Callbacks
+// run on the loop thread, one at a time and without the loop's lock held,
+// so they may use the loop themselves; they should return quickly, as
+// every other timer waits for them. cancel() and unwatch() called from
+// another thread wait for a callback that is running, so its captures can
+// be destroyed once they return.
+class EventLoop {
+public:
+  using Clock = TimerWheel::Clock;
+  using Callback = TimerWheel::Callback;
+  using Handle = TimerWheel::Handle;
+
+  explicit EventLoop(
+      const std::string &name = "events",
+      std::chrono::nanoseconds resolution = std::chrono::milliseconds(1));
+  ~EventLoop();
+
+  // Non-copyable
+  EventLoop(const EventLoop &) = delete;
+  EventLoop &operator=(const EventLoop &) = delete;
+
+  // Timers added while stopped run once started
+  void start();
+  void stop();
+
+  Handle schedule(Clock::duration delay, Callback callback);
+  // First runs one period from now
+  Handle schedule_every(Clock::duration period, Callback callback);
+  // Move a pending timer to delay from now; false if it has gone
+  bool reschedule(Handle handle, Clock::duration delay);
+  void cancel(Handle handle);
+
+  // Call handler whenever the ZMQ socket has a message waiting. The handler
+  // should receive with ZMQ_DONTWAIT until the socket is empty.
+  void watch(void *socket, Callback handler);
+  void unwatch(void *socket);
+
+  // True on the loop thread
+  bool in_loop() const;
+
+private:
+  void run();
+  Handle add(Clock::time_point deadline, Callback callback,
+             Clock::duration period);
+  // Runs a timer's callback with the loop unlocked
+  void fire(const Callback &callback);
+  void wake();
+
+  std::string name_;
+  TimerWheel wheel_;
+  std::map<void *, Callback> watches_;
+  int wake_fd_;
+
+  std::mutex mutex_;
+  std::unique_lock<std::mutex> *loop_lock_{nullptr}; // Held by run()
+  std::condition_variable done_cv_; // A callback returned
+  Handle firing_;                   // Timer whose callback is running
+  void *handling_{nullptr};         // Socket whose handler is running
+  // When run() will next wake unasked; min() while it is awake
+  Clock::time_point sleeping_until_{Clock::time_point::min()};
+
+  std::atomic<bool> running_{false};
+  std::thread thread_;
+  std::atomic<std::thread::id> loop_thread_id_{};
+};
+
+} // namespace tick_capture
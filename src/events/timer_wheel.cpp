@@ -0,0 +1,268 @@
+#include "timer_wheel.hpp"
+#include <algorithm>
+#include <bit>
+
+namespace tick_capture {
+
+TimerWheel::TimerWheel(std::chrono::nanoseconds resolution,
+                       Clock::time_point origin)
+    : resolution_(std::max(resolution, std::chrono::nanoseconds(1))),
+      origin_(origin) {
+  heads_.fill(kNone);
+}
+
+TimerWheel::Handle TimerWheel::schedule(Clock::time_point deadline,
+                                        Callback callback,
+                                        Clock::duration period) {
+  const uint32_t index = allocate();
+  Node &node = nodes_[index];
+  node.callback = std::move(callback);
+  node.expiry = std::max(to_tick(deadline), now_ + 1);
+  node.period = 0;
+  if (period > Clock::duration::zero()) {
+    const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        period + resolution_ - std::chrono::nanoseconds(1));
+    node.period = std::max<uint64_t>(ns / resolution_, 1);
+  }
+  link(index);
+  return {index, node.generation};
+}
+
+bool TimerWheel::reschedule(Handle handle, Clock::time_point deadline) {
+  Node *node = find(handle);
+  if (!node)
+    return false;
+  if (node->list != kNone)
+    unlink(handle.index);
+  node->expiry = std::max(to_tick(deadline), now_ + 1);
+  link(handle.index);
+  return true;
+}
+
+bool TimerWheel::cancel(Handle handle) {
+  Node *node = find(handle);
+  if (!node)
+    return false;
+  if (node->list != kNone)
+    unlink(handle.index);
+  release(handle.index);
+  return true;
+}
+
+bool TimerWheel::pending(Handle handle) const {
+  return find(handle) != nullptr;
+}
+
+size_t TimerWheel::advance(Clock::time_point now) {
+  if (now < origin_)
+    return 0;
+  target_ = static_cast<uint64_t>((now - origin_) / resolution_);
+
+  size_t fired = 0;
+  for (uint64_t tick = next_event(); tick <= target_; tick = next_event()) {
+    now_ = tick;
+
+    // Settle timers from the top down before running this tick's
+    if (heads_[kOverflow] != kNone &&
+        (now_ & ((uint64_t(1) << (kSlotBits * kLevels)) - 1)) == 0) {
+      cascade(kOverflow);
+    }
+    for (size_t level = kLevels - 1; level > 0; --level) {
+      const unsigned shift = kSlotBits * static_cast<unsigned>(level);
+      const uint64_t slot = (now_ >> shift) & (kSlots - 1);
+      if ((now_ & ((uint64_t(1) << shift) - 1)) == 0 &&
+          (occupied_[level] >> slot & 1)) {
+        cascade(static_cast<uint32_t>(level * kSlots + slot));
+      }
+    }
+    fired += expire();
+  }
+
+  // Nothing is filed before target, so skipping the idle ticks is safe
+  now_ = std::max(now_, target_);
+  return fired;
+}
+
+TimerWheel::Clock::time_point TimerWheel::next_deadline() const {
+  const uint64_t tick = next_event();
+  return tick == UINT64_MAX ? Clock::time_point::max() : to_time(tick);
+}
+
+uint64_t TimerWheel::to_tick(Clock::time_point t) const {
+  if (t <= origin_)
+    return 0;
+  const auto ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(t - origin_) +
+      resolution_ - std::chrono::nanoseconds(1);
+  return static_cast<uint64_t>(ns / resolution_);
+}
+
+TimerWheel::Clock::time_point TimerWheel::to_time(uint64_t tick) const {
+  return origin_ + std::chrono::duration_cast<Clock::duration>(
+                       resolution_ * static_cast<int64_t>(tick));
+}
+
+TimerWheel::Node *TimerWheel::find(Handle handle) {
+  if (handle.index >= nodes_.size())
+    return nullptr;
+  Node &node = nodes_[handle.index];
+  return node.active && node.generation == handle.generation ? &node
+                                                             : nullptr;
+}
+
+const TimerWheel::Node *TimerWheel::find(Handle handle) const {
+  return const_cast<TimerWheel *>(this)->find(handle);
+}
+
+uint32_t TimerWheel::allocate() {
+  uint32_t index;
+  if (!free_.empty()) {
+    index = free_.back();
+    free_.pop_back();
+  } else {
+    index = static_cast<uint32_t>(nodes_.size());
+    nodes_.emplace_back();
+  }
+  nodes_[index].active = true;
+  size_++;
+  return index;
+}
+
+void TimerWheel::release(uint32_t index) {
+  Node &node = nodes_[index];
+  node.callback = nullptr;
+  node.active = false;
+  node.generation++; // Stale handles no longer match
+  free_.push_back(index);
+  size_--;
+}
+
+void TimerWheel::link(uint32_t index) {
+  const uint64_t expiry = nodes_[index].expiry;
+  const uint64_t differs = expiry ^ now_;
+  const size_t level =
+      differs < kSlots ? 0 : (std::bit_width(differs) - 1) / kSlotBits;
+  if (level >= kLevels) {
+    push(kOverflow, index);
+    return;
+  }
+
+  const unsigned shift = kSlotBits * static_cast<unsigned>(level);
+  const uint64_t slot = (expiry >> shift) & (kSlots - 1);
+  push(static_cast<uint32_t>(level * kSlots + slot), index);
+  occupied_[level] |= uint64_t(1) << slot;
+}
+
+void TimerWheel::unlink(uint32_t index) {
+  Node &node = nodes_[index];
+  if (node.prev != kNone) {
+    nodes_[node.prev].next = node.next;
+  } else {
+    heads_[node.list] = node.next;
+  }
+  if (node.next != kNone) {
+    nodes_[node.next].prev = node.prev;
+  }
+
+  if (node.list < kOverflow && heads_[node.list] == kNone) {
+    occupied_[node.list / kSlots] &= ~(uint64_t(1) << (node.list % kSlots));
+  }
+  node.prev = node.next = node.list = kNone;
+}
+
+void TimerWheel::push(uint32_t list, uint32_t index) {
+  Node &node = nodes_[index];
+  node.list = list;
+  node.prev = kNone;
+  node.next = heads_[list];
+  if (node.next != kNone) {
+    nodes_[node.next].prev = index;
+  }
+  heads_[list] = index;
+}
+
+uint64_t TimerWheel::next_event() const {
+  uint64_t next = UINT64_MAX;
+  for (size_t level = 0; level < kLevels; ++level) {
+    const unsigned shift = kSlotBits * static_cast<unsigned>(level);
+    const uint64_t digit = (now_ >> shift) & (kSlots - 1);
+    // Filed slots are all past the wheel's current one
+    const uint64_t ahead = occupied_[level] & ~((uint64_t(2) << digit) - 1);
+    if (ahead == 0)
+      continue;
+    const uint64_t base = now_ >> (shift + kSlotBits) << (shift + kSlotBits);
+    next = std::min(
+        next, base + (static_cast<uint64_t>(std::countr_zero(ahead)) << shift));
+  }
+  if (heads_[kOverflow] != kNone) {
+    const unsigned span = kSlotBits * kLevels;
+    next = std::min(next, ((now_ >> span) + 1) << span);
+  }
+  return next;
+}
+
+void TimerWheel::cascade(uint32_t list) {
+  uint32_t index = heads_[list];
+  heads_[list] = kNone;
+  if (list < kOverflow) {
+    occupied_[list / kSlots] &= ~(uint64_t(1) << (list % kSlots));
+  }
+
+  while (index != kNone) {
+    const uint32_t next = nodes_[index].next;
+    link(index);
+    index = next;
+  }
+}
+
+size_t TimerWheel::expire() {
+  const uint32_t slot = static_cast<uint32_t>(now_ & (kSlots - 1));
+  if (!(occupied_[0] >> slot & 1))
+    return 0;
+
+  // Callbacks may unlink any timer, so the slot is emptied first and the
+  // due timers taken one at a time from a list of their own
+  heads_[kExpiring] = heads_[slot];
+  heads_[slot] = kNone;
+  occupied_[0] &= ~(uint64_t(1) << slot);
+  for (uint32_t i = heads_[kExpiring]; i != kNone; i = nodes_[i].next) {
+    nodes_[i].list = kExpiring;
+  }
+
+  size_t fired = 0;
+  while (heads_[kExpiring] != kNone) {
+    const uint32_t index = heads_[kExpiring];
+    unlink(index);
+    const Handle handle{index, nodes_[index].generation};
+    Callback callback = std::move(nodes_[index].callback);
+
+    firing_ = handle;
+    callback();
+    firing_ = {};
+    fired++;
+
+    // The callback may have grown nodes_, or cancelled or rescheduled
+    // its own timer
+    Node *node = find(handle);
+    if (!node)
+      continue;
+    node->callback = std::move(callback);
+    if (node->list != kNone)
+      continue;
+    if (node->period > 0) {
+      // Periods missed while advance() was not called are skipped, keeping
+      // the timer's phase
+      node->expiry = now_ + node->period;
+      if (node->expiry <= target_) {
+        node->expiry += (target_ - node->expiry) / node->period * node->period +
+                        node->period;
+      }
+      link(index);
+    } else {
+      release(index);
+    }
+  }
+  return fired;
+}
+
+} // namespace tick_capture
@@ -0,0 +1,126 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace tick_capture {
+
+// Hierarchical timer wheel: kLevels wheels of kSlots slots each, slot i of
+// level k holding the timers due in the i-th 64^k ticks of the current
+// 64^(k+1) ticks. A timer is filed by the highest 6-bit digit in which its
+// expiry tick differs from the current tick, and moves down a level when
+// the wheel reaches its slot there. Timers beyond 64^4 ticks wait in an
+// overflow list.
+//
+// Scheduling, rescheduling and cancelling are O(1): each timer is a node
+// in a doubly linked slot list, addressed by a generation-checked handle.
+// A bitmap per level marks occupied slots, so advance() jumps straight to
+// the next occupied slot instead of visiting every tick, and
+// next_deadline() tells an event loop how long it may sleep. An idle wheel
+// costs nothing however fine its resolution.
+//
+// Not thread-safe. Callbacks run inside advance() and may schedule,
+// reschedule or cancel any timer, including their own; they must not
+// throw.
+class TimerWheel {
+public:
+  using Clock = std::chrono::steady_clock;
+  using Callback = std::function<void()>;
+
+  struct Handle {
+    uint32_t index{UINT32_MAX};
+    uint32_t generation{0};
+
+    explicit operator bool() const { return index != UINT32_MAX; }
+    bool operator==(const Handle &) const = default;
+  };
+
+  static constexpr size_t kLevels = 4;
+  static constexpr size_t kSlots = 64;
+
+  explicit TimerWheel(
+      std::chrono::nanoseconds resolution = std::chrono::milliseconds(1),
+      Clock::time_point origin = Clock::now());
+
+  // Non-copyable
+  TimerWheel(const TimerWheel &) = delete;
+  TimerWheel &operator=(const TimerWheel &) = delete;
+
+  // Run callback once, at the first advance() at or after deadline. With a
+  // period it runs again every period after deadline until cancelled,
+  // skipping periods that passed before advance() was called.
+  Handle schedule(Clock::time_point deadline, Callback callback,
+                  Clock::duration period = Clock::duration::zero());
+
+  // Move a pending timer to a new deadline; false if it has fired (and
+  // was not periodic) or was cancelled
+  bool reschedule(Handle handle, Clock::time_point deadline);
+
+  // False if the timer had already fired or been cancelled
+  bool cancel(Handle handle);
+
+  bool pending(Handle handle) const;
+  size_t size() const { return size_; }
+
+  // Run every timer due by now, in expiry order between slots; returns
+  // how many ran
+  size_t advance(Clock::time_point now);
+
+  // When advance() next has work: a timer's expiry, or the wheel reaching
+  // the slot of a later one. Clock::time_point::max() if no timers.
+  Clock::time_point next_deadline() const;
+
+  // The timer whose callback is running, if any
+  Handle firing() const { return firing_; }
+
+private:
+  static constexpr uint32_t kNone = UINT32_MAX;
+  static constexpr uint32_t kOverflow = kLevels * kSlots;
+  static constexpr uint32_t kExpiring = kOverflow + 1;
+  static constexpr uint32_t kLists = kExpiring + 1;
+  static constexpr unsigned kSlotBits = 6;
+
+  struct Node {
+    Callback callback;
+    uint64_t expiry{0}; // Tick
+    uint64_t period{0}; // Ticks, 0 for one-shot
+    uint32_t prev{kNone};
+    uint32_t next{kNone};
+    uint32_t list{kNone}; // Slot list the node is on, kNone if on none
+    uint32_t generation{0};
+    bool active{false}; // Allocated to a timer
+  };
+
+  uint64_t to_tick(Clock::time_point t) const; // Rounded up
+  Clock::time_point to_time(uint64_t tick) const;
+
+  Node *find(Handle handle);
+  const Node *find(Handle handle) const;
+  uint32_t allocate();
+  void release(uint32_t index);
+
+  void link(uint32_t index); // Files by expiry against now_
+  void unlink(uint32_t index);
+  void push(uint32_t list, uint32_t index);
+
+  // First tick after now_ with work, UINT64_MAX if none
+  uint64_t next_event() const;
+  void cascade(uint32_t list);
+  size_t expire();
+
+  std::chrono::nanoseconds resolution_;
+  Clock::time_point origin_;
+  uint64_t now_{0};    // Last tick advanced to
+  uint64_t target_{0}; // Tick the running advance() goes to
+
+  std::vector<Node> nodes_;
+  std::vector<uint32_t> free_;
+  std::array<uint32_t, kLists> heads_;
+  std::array<uint64_t, kLevels> occupied_{}; // Bit per non-empty slot
+  size_t size_{0};
+  Handle firing_;
+};
+
+} // namespace tick_capture
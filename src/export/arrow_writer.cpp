@@ -0,0 +1,437 @@
+#include "arrow_writer.hpp"
+#include <algorithm>
+#include <bit>
+#include <fmt/format.h>
+#include <string_view>
+
+namespace tick_capture {
+
+static_assert(std::endian::native == std::endian::little,
+              "Arrow IPC buffers are written in host (little-endian) order");
+
+namespace {
+
+// Minimal FlatBuffers builder covering what Arrow IPC metadata needs:
+// tables of scalars and offsets, strings, vectors of offsets and vectors of
+// structs. Like the reference implementation it builds back to front, so
+// children are created before the tables that point at them.
+class FlatBuilder {
+public:
+  using Ref = uint32_t; // Offset of an object from the end of the buffer
+
+  size_t size() const { return bytes_.size(); }
+
+  template <typename T> void push(T value) {
+    prealign(sizeof(T), sizeof(T));
+    prepend(&value, sizeof(T));
+  }
+
+  void push_ref(Ref target) {
+    prealign(sizeof(uint32_t), sizeof(uint32_t));
+    push<uint32_t>(
+        static_cast<uint32_t>(size() + sizeof(uint32_t) - target));
+  }
+
+  Ref create_string(std::string_view str) {
+    prealign(str.size() + 1, sizeof(uint32_t));
+    const char nul = 0;
+    prepend(&nul, 1);
+    prepend(str.data(), str.size());
+    push<uint32_t>(static_cast<uint32_t>(str.size()));
+    return static_cast<Ref>(size());
+  }
+
+  Ref create_vector(const std::vector<Ref> &refs) {
+    prealign(refs.size() * sizeof(uint32_t), sizeof(uint32_t));
+    for (auto it = refs.rbegin(); it != refs.rend(); ++it) {
+      push_ref(*it);
+    }
+    push<uint32_t>(static_cast<uint32_t>(refs.size()));
+    return static_cast<Ref>(size());
+  }
+
+  // Vector of 8-byte aligned structs whose size is a multiple of 8
+  template <typename T> Ref create_struct_vector(const std::vector<T> &items) {
+    static_assert(sizeof(T) % 8 == 0);
+    prealign(items.size() * sizeof(T), 8);
+    prepend(items.data(), items.size() * sizeof(T));
+    push<uint32_t>(static_cast<uint32_t>(items.size()));
+    return static_cast<Ref>(size());
+  }
+
+  void start_table() {
+    table_start_ = size();
+    fields_.clear();
+  }
+
+  template <typename T> void add_scalar(uint16_t id, T value) {
+    push(value);
+    fields_.push_back({id, static_cast<Ref>(size())});
+  }
+
+  void add_ref(uint16_t id, Ref target) {
+    push_ref(target);
+    fields_.push_back({id, static_cast<Ref>(size())});
+  }
+
+  Ref end_table() {
+    push<int32_t>(0); // Offset to the vtable, patched below
+    const auto table = static_cast<Ref>(size());
+
+    uint16_t num_fields = 0;
+    for (const auto &field : fields_) {
+      num_fields = std::max<uint16_t>(num_fields, field.id + 1);
+    }
+    std::vector<uint16_t> vtable(2 + num_fields, 0);
+    vtable[0] = static_cast<uint16_t>(vtable.size() * sizeof(uint16_t));
+    vtable[1] = static_cast<uint16_t>(table - table_start_);
+    for (const auto &field : fields_) {
+      vtable[2 + field.id] = static_cast<uint16_t>(table - field.ref);
+    }
+    for (auto it = vtable.rbegin(); it != vtable.rend(); ++it) {
+      push(*it);
+    }
+
+    // The vtable sits directly in front of the table
+    const auto vtable_offset = static_cast<int32_t>(size() - table);
+    std::memcpy(bytes_.data() + size() - table, &vtable_offset,
+                sizeof(vtable_offset));
+    return table;
+  }
+
+  std::vector<uint8_t> finish(Ref root) {
+    prealign(sizeof(uint32_t), min_align_);
+    push_ref(root);
+    return std::move(bytes_);
+  }
+
+private:
+  struct FieldRef {
+    uint16_t id;
+    Ref ref;
+  };
+
+  // Pad so that `len` bytes prepended next end up aligned to `alignment`
+  void prealign(size_t len, size_t alignment) {
+    min_align_ = std::max(min_align_, alignment);
+    const size_t pad = (alignment - (size() + len) % alignment) % alignment;
+    bytes_.insert(bytes_.begin(), pad, 0);
+  }
+
+  void prepend(const void *data, size_t len) {
+    const auto *p = static_cast<const uint8_t *>(data);
+    bytes_.insert(bytes_.begin(), p, p + len);
+  }
+
+  std::vector<uint8_t> bytes_;
+  std::vector<FieldRef> fields_;
+  size_t table_start_{0};
+  size_t min_align_{1};
+};
+
+// Arrow format constants (Schema.fbs, Message.fbs)
+constexpr int16_t kMetadataV5 = 4;
+constexpr uint8_t kHeaderSchema = 1;
+constexpr uint8_t kHeaderRecordBatch = 3;
+constexpr uint8_t kTypeInt = 2;
+constexpr uint8_t kTypeFloatingPoint = 3;
+constexpr uint8_t kTypeTimestamp = 10;
+constexpr int16_t kPrecisionDouble = 2;
+constexpr int16_t kTimeUnitNanosecond = 3;
+
+constexpr char kMagic[8] = {'A', 'R', 'R', 'O', 'W', '1', 0, 0};
+constexpr uint32_t kContinuation = 0xFFFFFFFF;
+constexpr size_t kBufferAlignment = 64;
+constexpr size_t kNumColumns = 7;
+
+struct FieldNode {
+  int64_t length;
+  int64_t null_count;
+};
+
+struct BufferSpec {
+  int64_t offset;
+  int64_t length;
+};
+
+struct BlockSpec {
+  int64_t offset;
+  int32_t metadata_length;
+  int32_t padding;
+  int64_t body_length;
+};
+
+size_t aligned(size_t n, size_t alignment) {
+  return (n + alignment - 1) / alignment * alignment;
+}
+
+FlatBuilder::Ref build_int_type(FlatBuilder &fb, int32_t bit_width) {
+  fb.start_table();
+  fb.add_scalar<int32_t>(0, bit_width);
+  fb.add_scalar<uint8_t>(1, 0); // Unsigned
+  return fb.end_table();
+}
+
+FlatBuilder::Ref build_field(FlatBuilder &fb, std::string_view name,
+                             uint8_t type_type, FlatBuilder::Ref type) {
+  const auto name_ref = fb.create_string(name);
+  const auto children = fb.create_vector({});
+  fb.start_table();
+  fb.add_ref(0, name_ref);
+  fb.add_scalar<uint8_t>(1, 0); // Not nullable
+  fb.add_scalar<uint8_t>(2, type_type);
+  fb.add_ref(3, type);
+  fb.add_ref(5, children);
+  return fb.end_table();
+}
+
+FlatBuilder::Ref build_schema(FlatBuilder &fb) {
+  std::vector<FlatBuilder::Ref> fields;
+  fields.push_back(build_field(fb, "sequence_number", kTypeInt,
+                               build_int_type(fb, 64)));
+
+  const auto tz = fb.create_string("UTC");
+  fb.start_table();
+  fb.add_scalar<int16_t>(0, kTimeUnitNanosecond);
+  fb.add_ref(1, tz);
+  fields.push_back(
+      build_field(fb, "timestamp", kTypeTimestamp, fb.end_table()));
+
+  fields.push_back(
+      build_field(fb, "symbol_id", kTypeInt, build_int_type(fb, 32)));
+  fields.push_back(build_field(fb, "type", kTypeInt, build_int_type(fb, 8)));
+
+  fb.start_table();
+  fb.add_scalar<int16_t>(0, kPrecisionDouble);
+  fields.push_back(
+      build_field(fb, "price", kTypeFloatingPoint, fb.end_table()));
+
+  fields.push_back(build_field(fb, "size", kTypeInt, build_int_type(fb, 32)));
+  fields.push_back(build_field(fb, "flags", kTypeInt, build_int_type(fb, 8)));
+
+  const auto field_vector = fb.create_vector(fields);
+  fb.start_table();
+  fb.add_scalar<int16_t>(0, 0); // Little endian
+  fb.add_ref(1, field_vector);
+  return fb.end_table();
+}
+
+// Wrap a header table in an IPC Message and finish the buffer
+std::vector<uint8_t> finish_message(FlatBuilder &fb, uint8_t header_type,
+                                    FlatBuilder::Ref header,
+                                    int64_t body_length) {
+  fb.start_table();
+  fb.add_scalar<int16_t>(0, kMetadataV5);
+  fb.add_scalar<uint8_t>(1, header_type);
+  fb.add_ref(2, header);
+  fb.add_scalar<int64_t>(3, body_length);
+  return fb.finish(fb.end_table());
+}
+
+} // namespace
+
+ArrowTickWriter::ArrowTickWriter(const std::filesystem::path &path,
+                                 const Options &options)
+    : options_(options), file_(path, std::ios::binary | std::ios::trunc) {
+  if (!file_.is_open()) {
+    throw std::runtime_error(
+        fmt::format("Failed to open file: {}", path.string()));
+  }
+  if (options_.batch_rows == 0) {
+    throw std::runtime_error("batch_rows must be greater than zero");
+  }
+
+  sequence_numbers_.reserve(options_.batch_rows);
+  timestamps_.reserve(options_.batch_rows);
+  symbol_ids_.reserve(options_.batch_rows);
+  types_.reserve(options_.batch_rows);
+  prices_.reserve(options_.batch_rows);
+  sizes_.reserve(options_.batch_rows);
+  flags_.reserve(options_.batch_rows);
+
+  if (options_.format == Format::File) {
+    file_.write(kMagic, sizeof(kMagic));
+    position_ += sizeof(kMagic);
+  }
+  write_schema();
+}
+
+ArrowTickWriter::~ArrowTickWriter() {
+  try {
+    close();
+  } catch (const std::exception &e) {
+    fmt::print(stderr, "Error closing Arrow file: {}\n", e.what());
+  }
+}
+
+void ArrowTickWriter::write(const MarketMessage &msg, double price) {
+  sequence_numbers_.push_back(msg.sequence_number);
+  timestamps_.push_back(static_cast<int64_t>(msg.timestamp));
+  symbol_ids_.push_back(msg.symbol_id);
+  types_.push_back(static_cast<uint8_t>(msg.type));
+  prices_.push_back(price);
+  sizes_.push_back(msg.trade.size);
+  flags_.push_back(msg.trade.flags);
+
+  if (sequence_numbers_.size() == options_.batch_rows) {
+    flush_batch();
+  }
+}
+
+void ArrowTickWriter::write(std::span<const MarketMessage> messages) {
+  for (const auto &msg : messages) {
+    write(msg);
+  }
+}
+
+void ArrowTickWriter::close() {
+  if (closed_)
+    return;
+  closed_ = true;
+
+  flush_batch();
+
+  // End-of-stream marker
+  const uint32_t eos[2] = {kContinuation, 0};
+  file_.write(reinterpret_cast<const char *>(eos), sizeof(eos));
+  position_ += sizeof(eos);
+
+  if (options_.format == Format::File) {
+    std::vector<BlockSpec> blocks;
+    blocks.reserve(batches_.size());
+    for (const auto &batch : batches_) {
+      blocks.push_back(
+          {batch.offset, batch.metadata_length, 0, batch.body_length});
+    }
+
+    FlatBuilder fb;
+    const auto schema = build_schema(fb);
+    const auto dictionaries = fb.create_struct_vector(std::vector<BlockSpec>{});
+    const auto record_batches = fb.create_struct_vector(blocks);
+    fb.start_table();
+    fb.add_scalar<int16_t>(0, kMetadataV5);
+    fb.add_ref(1, schema);
+    fb.add_ref(2, dictionaries);
+    fb.add_ref(3, record_batches);
+    const auto footer = fb.finish(fb.end_table());
+
+    const auto footer_length = static_cast<int32_t>(footer.size());
+    file_.write(reinterpret_cast<const char *>(footer.data()), footer.size());
+    file_.write(reinterpret_cast<const char *>(&footer_length),
+                sizeof(footer_length));
+    file_.write(kMagic, 6);
+  }
+
+  file_.flush();
+  if (!file_) {
+    throw std::runtime_error("Failed to write Arrow file");
+  }
+  file_.close();
+}
+
+void ArrowTickWriter::write_schema() {
+  FlatBuilder fb;
+  const auto schema = build_schema(fb);
+  write_message(finish_message(fb, kHeaderSchema, schema, 0), 0);
+}
+
+void ArrowTickWriter::flush_batch() {
+  const size_t rows = sequence_numbers_.size();
+  if (rows == 0)
+    return;
+
+  // Column data in schema order; each column has an empty validity buffer
+  // (no nulls) followed by its values
+  const std::pair<const void *, size_t> columns[kNumColumns] = {
+      {sequence_numbers_.data(), rows * sizeof(uint64_t)},
+      {timestamps_.data(), rows * sizeof(int64_t)},
+      {symbol_ids_.data(), rows * sizeof(uint32_t)},
+      {types_.data(), rows * sizeof(uint8_t)},
+      {prices_.data(), rows * sizeof(double)},
+      {sizes_.data(), rows * sizeof(uint32_t)},
+      {flags_.data(), rows * sizeof(uint8_t)},
+  };
+
+  std::vector<BufferSpec> buffers;
+  int64_t body_length = 0;
+  for (const auto &[data, bytes] : columns) {
+    buffers.push_back({body_length, 0});
+    buffers.push_back({body_length, static_cast<int64_t>(bytes)});
+    body_length += static_cast<int64_t>(aligned(bytes, kBufferAlignment));
+  }
+
+  FlatBuilder fb;
+  const std::vector<FieldNode> nodes(
+      kNumColumns, FieldNode{static_cast<int64_t>(rows), 0});
+  const auto node_vector = fb.create_struct_vector(nodes);
+  const auto buffer_vector = fb.create_struct_vector(buffers);
+  fb.start_table();
+  fb.add_scalar<int64_t>(0, static_cast<int64_t>(rows));
+  fb.add_ref(1, node_vector);
+  fb.add_ref(2, buffer_vector);
+  const auto metadata =
+      finish_message(fb, kHeaderRecordBatch, fb.end_table(), body_length);
+
+  batches_.push_back(write_message(metadata, body_length));
+
+  // Column buffers go straight from the batch vectors to the file
+  for (const auto &[data, bytes] : columns) {
+    file_.write(static_cast<const char *>(data),
+                static_cast<std::streamsize>(bytes));
+    write_padding(aligned(bytes, kBufferAlignment) - bytes);
+  }
+  position_ += body_length;
+  rows_written_ += rows;
+
+  sequence_numbers_.clear();
+  timestamps_.clear();
+  symbol_ids_.clear();
+  types_.clear();
+  prices_.clear();
+  sizes_.clear();
+  flags_.clear();
+}
+
+ArrowTickWriter::Block
+ArrowTickWriter::write_message(const std::vector<uint8_t> &metadata,
+                               int64_t body_length) {
+  // Continuation marker and length prefix, with the metadata padded so the
+  // body that follows stays 8-byte aligned
+  const auto padded = static_cast<int32_t>(aligned(metadata.size(), 8));
+  Block block{position_, static_cast<int32_t>(8 + padded), body_length};
+
+  const uint32_t prefix[2] = {kContinuation, static_cast<uint32_t>(padded)};
+  file_.write(reinterpret_cast<const char *>(prefix), sizeof(prefix));
+  file_.write(reinterpret_cast<const char *>(metadata.data()),
+              static_cast<std::streamsize>(metadata.size()));
+  write_padding(padded - metadata.size());
+  position_ += block.metadata_length;
+  return block;
+}
+
+void ArrowTickWriter::write_padding(size_t bytes) {
+  static constexpr char zeros[kBufferAlignment] = {};
+  file_.write(zeros, static_cast<std::streamsize>(bytes));
+}
+
+uint64_t ArrowTickWriter::export_range(TickReader &reader,
+                                       const std::filesystem::path &path,
+                                       const Options &options) {
+  ArrowTickWriter writer(path, options);
+  while (const MarketMessage *msg = reader.next()) {
+    writer.write(*msg, reader.price(*msg));
+  }
+  writer.close();
+  return writer.rows_written();
+}
+
+uint64_t ArrowTickWriter::export_session(
+    const std::filesystem::path &session_dir,
+    const std::filesystem::path &path, const Options &options) {
+  TickReader::Options reader_options;
+  reader_options.sessions = {session_dir.string()};
+  TickReader reader(reader_options);
+  return export_range(reader, path, options);
+}
+
+} // namespace tick_capture
@@ -0,0 +1,89 @@
+#pragma once
+#include "../../include/tick_capture/types.hpp"
+#include "../storage/tick_reader.hpp"
+#include <filesystem>
+#include <fstream>
+#include <span>
+#include <vector>
+
+namespace tick_capture {
+
+// Writes ticks as Apache Arrow IPC with one column per MarketMessage field:
+// sequence_number (uint64), timestamp (timestamp[ns, UTC]), symbol_id
+// (uint32), type (uint8), price (float64), size (uint32), flags (uint8).
+//
+// File format is Arrow IPC file / Feather v2, which readers can mmap and
+// use without parsing the buffers. Stream format is the Arrow IPC stream,
+// for piping into tools that consume record batches incrementally. Rows
+// are buffered per column and written one record batch at a time, so
+// memory stays bounded by batch_rows regardless of the export size.
+class ArrowTickWriter {
+public:
+  enum class Format { File, Stream };
+
+  struct Options {
+    Format format{Format::File};
+    size_t batch_rows{1 << 16}; // Rows per record batch
+  };
+
+  ArrowTickWriter(const std::filesystem::path &path, const Options &options);
+  ~ArrowTickWriter();
+
+  // Non-copyable
+  ArrowTickWriter(const ArrowTickWriter &) = delete;
+  ArrowTickWriter &operator=(const ArrowTickWriter &) = delete;
+
+  // Messages with double prices
+  void write(const MarketMessage &msg) { write(msg, msg.trade.price); }
+  void write(std::span<const MarketMessage> messages);
+
+  // A message with its price already decoded (e.g. TickReader::price)
+  void write(const MarketMessage &msg, double price);
+
+  // Flush the last batch and write the end-of-stream marker and footer
+  void close();
+
+  uint64_t rows_written() const { return rows_written_; }
+  size_t batches_written() const { return batches_.size(); }
+
+  // Export everything a reader yields, in merged order
+  static uint64_t export_range(TickReader &reader,
+                               const std::filesystem::path &path,
+                               const Options &options);
+
+  // Export one capture directory, ordered by (timestamp, sequence)
+  static uint64_t export_session(const std::filesystem::path &session_dir,
+                                 const std::filesystem::path &path,
+                                 const Options &options);
+
+private:
+  struct Block {
+    int64_t offset;
+    int32_t metadata_length;
+    int64_t body_length;
+  };
+
+  void write_schema();
+  void flush_batch();
+  Block write_message(const std::vector<uint8_t> &metadata,
+                      int64_t body_length);
+  void write_padding(size_t bytes);
+
+  Options options_;
+  std::ofstream file_;
+  int64_t position_{0};
+  bool closed_{false};
+  uint64_t rows_written_{0};
+  std::vector<Block> batches_;
+
+  // Column buffers for the batch being built
+  std::vector<uint64_t> sequence_numbers_;
+  std::vector<int64_t> timestamps_;
+  std::vector<uint32_t> symbol_ids_;
+  std::vector<uint8_t> types_;
+  std::vector<double> prices_;
+  std::vector<uint32_t> sizes_;
+  std::vector<uint8_t> flags_;
+};
+
+} // namespace tick_capture
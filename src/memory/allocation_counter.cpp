@@ -0,0 +1,100 @@
+#include "allocation_counter.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <unistd.h>
+
+namespace tick_capture {
+
+namespace {
+
+// One counter per thread, claimed on its first allocation from a fixed
+// table so counting never allocates, and freed again when the thread exits
+// so a later thread given the same kernel tid starts from zero. Threads
+// past the table share the last slot, reported under tid 0.
+struct alignas(64) ThreadSlot {
+  std::atomic<pid_t> tid{0};
+  std::atomic<bool> claimed{false};
+  std::atomic<uint64_t> allocations{0};
+};
+
+constexpr size_t kMaxThreads = 512;
+std::array<ThreadSlot, kMaxThreads> slots;
+std::atomic<size_t> slots_used{0}; // High-water mark of claimed slots
+
+thread_local ThreadSlot *thread_slot = nullptr;
+
+ThreadSlot &overflow_slot() noexcept { return slots[kMaxThreads - 1]; }
+
+struct SlotRelease {
+  ~SlotRelease() {
+    if (thread_slot && thread_slot != &overflow_slot()) {
+      thread_slot->tid.store(0, std::memory_order_relaxed);
+      thread_slot->claimed.store(false, std::memory_order_release);
+    }
+    // Allocations by later thread-exit code are not worth a slot
+    thread_slot = &overflow_slot();
+  }
+};
+thread_local SlotRelease slot_release;
+
+ThreadSlot &claim_slot() noexcept {
+  size_t used = slots_used.load(std::memory_order_acquire);
+  while (true) {
+    for (size_t i = 0; i < used; ++i) {
+      bool expected = false;
+      if (slots[i].claimed.compare_exchange_strong(
+              expected, true, std::memory_order_acquire)) {
+        slots[i].allocations.store(0, std::memory_order_relaxed);
+        slots[i].tid.store(::gettid(), std::memory_order_relaxed);
+        return slots[i];
+      }
+    }
+    if (used >= kMaxThreads - 1) {
+      return overflow_slot();
+    }
+    // Every slot so far is taken; open one more and race for it
+    slots_used.compare_exchange_weak(used, used + 1,
+                                     std::memory_order_acq_rel);
+    used = slots_used.load(std::memory_order_acquire);
+  }
+}
+
+} // namespace
+
+void note_allocation() noexcept {
+  if (!thread_slot) {
+    thread_slot = &claim_slot();
+    (void)&slot_release; // Constructed here, so it runs at thread exit
+  }
+  thread_slot->allocations.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool allocation_counting_enabled() noexcept {
+  return slots_used.load(std::memory_order_relaxed) > 0;
+}
+
+uint64_t thread_allocations() noexcept {
+  return thread_slot ? thread_slot->allocations.load(std::memory_order_relaxed)
+                     : 0;
+}
+
+std::vector<std::pair<pid_t, uint64_t>> allocations_by_thread() {
+  const size_t used = slots_used.load(std::memory_order_acquire);
+  std::vector<std::pair<pid_t, uint64_t>> counts;
+  counts.reserve(used + 1);
+  for (size_t i = 0; i < used; ++i) {
+    if (!slots[i].claimed.load(std::memory_order_acquire)) {
+      continue; // Its thread has exited
+    }
+    counts.emplace_back(slots[i].tid.load(std::memory_order_relaxed),
+                        slots[i].allocations.load(std::memory_order_relaxed));
+  }
+  if (const auto shared = overflow_slot().allocations.load(
+          std::memory_order_relaxed)) {
+    counts.emplace_back(0, shared);
+  }
+  return counts;
+}
+
+} // namespace tick_capture
@@ -0,0 +1,27 @@
+#pragma once
+#include <cstdint>
+#include <sys/types.h>
+#include <utility>
+#include <vector>
+
+namespace tick_capture {
+
+// Heap allocations made by each thread. The counts come from a replacement
+// global operator new, which a program opts into by compiling
+// allocation_hook.cpp into its executable; the library never replaces it
+// itself. Without the hook every count stays zero.
+
+// Called by the hook for every allocation. Must not allocate.
+void note_allocation() noexcept;
+
+// True once the hook has counted anything
+bool allocation_counting_enabled() noexcept;
+
+// Allocations made so far by the calling thread
+uint64_t thread_allocations() noexcept;
+
+// Allocations made so far by every thread that has allocated, by kernel
+// thread id
+std::vector<std::pair<pid_t, uint64_t>> allocations_by_thread();
+
+} // namespace tick_capture
@@ -0,0 +1,64 @@
+// Replacement global operator new/delete that count allocations per thread
+// (see allocation_counter.hpp). Compile into an executable to enable
+// counting; it is deliberately not part of the tick_capture library.
+#include "allocation_counter.hpp"
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+void *counted_alloc(std::size_t size, std::size_t alignment) {
+  tick_capture::note_allocation();
+  if (size == 0) {
+    size = 1;
+  }
+  void *p = alignment > alignof(std::max_align_t)
+                ? std::aligned_alloc(alignment,
+                                     (size + alignment - 1) & ~(alignment - 1))
+                : std::malloc(size);
+  return p;
+}
+
+} // namespace
+
+void *operator new(std::size_t size) {
+  if (void *p = counted_alloc(size, 0)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size) { return ::operator new(size); }
+
+void *operator new(std::size_t size, std::align_val_t alignment) {
+  if (void *p = counted_alloc(size, static_cast<std::size_t>(alignment))) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment) {
+  return ::operator new(size, alignment);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+  return counted_alloc(size, 0);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+  return counted_alloc(size, 0);
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+void operator delete(void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept {
+  std::free(p);
+}
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept {
+  std::free(p);
+}
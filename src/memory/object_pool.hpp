@@ -0,0 +1,94 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <memory_resource>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace tick_capture {
+
+// Fixed-size slots for objects of type T, carved from a memory resource in
+// chunks and recycled through a free list, so creating and destroying
+// objects in steady state never reaches the heap. Objects still alive when
+// the pool is destroyed are not destroyed. Not thread-safe.
+template <typename T> class ObjectPool {
+  union Slot {
+    Slot *next; // While free
+    alignas(T) std::byte storage[sizeof(T)];
+  };
+
+public:
+  explicit ObjectPool(
+      std::pmr::memory_resource *resource = std::pmr::get_default_resource(),
+      size_t chunk_objects = 64)
+      : resource_(resource), chunk_objects_(std::max<size_t>(chunk_objects, 1)),
+        chunks_(resource) {}
+
+  ~ObjectPool() {
+    for (Slot *chunk : chunks_) {
+      resource_->deallocate(chunk, sizeof(Slot) * chunk_objects_,
+                            alignof(Slot));
+    }
+  }
+
+  // Non-copyable
+  ObjectPool(const ObjectPool &) = delete;
+  ObjectPool &operator=(const ObjectPool &) = delete;
+
+  template <typename... Args> T *create(Args &&...args) {
+    if (!free_) {
+      add_chunk();
+    }
+    Slot *slot = free_;
+    free_ = slot->next;
+    try {
+      T *object = ::new (slot->storage) T(std::forward<Args>(args)...);
+      ++live_;
+      return object;
+    } catch (...) {
+      slot->next = free_;
+      free_ = slot;
+      throw;
+    }
+  }
+
+  void destroy(T *object) noexcept {
+    if (!object)
+      return;
+    object->~T();
+    auto *slot = reinterpret_cast<Slot *>(object);
+    slot->next = free_;
+    free_ = slot;
+    --live_;
+  }
+
+  // Reserve room for at least n live objects up front
+  void reserve(size_t n) {
+    while (capacity() < n) {
+      add_chunk();
+    }
+  }
+
+  size_t live() const noexcept { return live_; }
+  size_t capacity() const noexcept { return chunks_.size() * chunk_objects_; }
+
+private:
+  void add_chunk() {
+    auto *chunk = static_cast<Slot *>(
+        resource_->allocate(sizeof(Slot) * chunk_objects_, alignof(Slot)));
+    chunks_.push_back(chunk);
+    for (size_t i = chunk_objects_; i-- > 0;) {
+      chunk[i].next = free_;
+      free_ = &chunk[i];
+    }
+  }
+
+  std::pmr::memory_resource *resource_;
+  size_t chunk_objects_;
+  std::pmr::vector<Slot *> chunks_;
+  Slot *free_{nullptr};
+  size_t live_{0};
+};
+
+} // namespace tick_capture
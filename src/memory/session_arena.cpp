@@ -0,0 +1,56 @@
+#include "session_arena.hpp"
+#include <algorithm>
+#include <memory>
+
+namespace tick_capture {
+
+SessionArena::SessionArena(size_t initial_block_size,
+                           std::pmr::memory_resource *upstream)
+    : upstream_(upstream),
+      next_block_size_(std::max(initial_block_size, sizeof(Block) * 2)) {
+  add_block(0);
+}
+
+SessionArena::~SessionArena() {
+  while (head_) {
+    Block *next = head_->next;
+    upstream_->deallocate(head_, head_->size, alignof(std::max_align_t));
+    head_ = next;
+  }
+}
+
+void *SessionArena::do_allocate(size_t bytes, size_t alignment) {
+  void *p = cursor_;
+  size_t space = static_cast<size_t>(end_ - cursor_);
+  if (!std::align(alignment, bytes, p, space)) {
+    add_block(bytes + alignment);
+    p = cursor_;
+    space = static_cast<size_t>(end_ - cursor_);
+    std::align(alignment, bytes, p, space);
+  }
+  cursor_ = static_cast<std::byte *>(p) + bytes;
+  bytes_allocated_ += bytes;
+  return p;
+}
+
+void SessionArena::add_block(size_t min_bytes) {
+  // Keep doubling so a long session needs few blocks
+  size_t size = next_block_size_;
+  while (size < min_bytes + sizeof(Block)) {
+    size *= 2;
+  }
+  next_block_size_ = size * 2;
+
+  auto *block = static_cast<Block *>(
+      upstream_->allocate(size, alignof(std::max_align_t)));
+  block->next = head_;
+  block->size = size;
+  head_ = block;
+
+  cursor_ = reinterpret_cast<std::byte *>(block + 1);
+  end_ = reinterpret_cast<std::byte *>(block) + size;
+  bytes_reserved_ += size;
+  ++blocks_;
+}
+
+} // namespace tick_capture
@@ -0,0 +1,52 @@
+#pragma once
+#include <cstddef>
+#include <memory_resource>
+
+namespace tick_capture {
+
+// Monotonic arena for objects that live as long as a capture session, such
+// as per-symbol file handles and their write buffers. Memory comes from the
+// upstream resource in blocks that double in size, and is only returned
+// when the arena is destroyed: deallocate is a no-op. Usable wherever a
+// std::pmr::memory_resource is. Not thread-safe.
+class SessionArena : public std::pmr::memory_resource {
+public:
+  explicit SessionArena(
+      size_t initial_block_size = 64 * 1024,
+      std::pmr::memory_resource *upstream = std::pmr::new_delete_resource());
+  ~SessionArena() override;
+
+  // Non-copyable
+  SessionArena(const SessionArena &) = delete;
+  SessionArena &operator=(const SessionArena &) = delete;
+
+  // Bytes handed out, and bytes obtained from upstream to hold them
+  size_t bytes_allocated() const noexcept { return bytes_allocated_; }
+  size_t bytes_reserved() const noexcept { return bytes_reserved_; }
+  size_t blocks() const noexcept { return blocks_; }
+
+private:
+  struct Block {
+    Block *next;
+    size_t size; // Including this header
+  };
+
+  void *do_allocate(size_t bytes, size_t alignment) override;
+  void do_deallocate(void *, size_t, size_t) override {}
+  bool do_is_equal(const memory_resource &other) const noexcept override {
+    return this == &other;
+  }
+
+  void add_block(size_t min_bytes);
+
+  std::pmr::memory_resource *upstream_;
+  Block *head_{nullptr};
+  std::byte *cursor_{nullptr};
+  std::byte *end_{nullptr};
+  size_t next_block_size_;
+  size_t bytes_allocated_{0};
+  size_t bytes_reserved_{0};
+  size_t blocks_{0};
+};
+
+} // namespace tick_capture
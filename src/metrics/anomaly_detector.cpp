@@ -0,0 +1,180 @@
+#include "anomaly_detector.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fmt/format.h>
+#include <limits>
+
+namespace tick_capture {
+
+namespace {
+
+// Deviation floor relative to price (1bp), so a symbol that has printed
+// one price throughout does not report its first tick move as a jump
+constexpr double kMinRelativeSigma = 1e-4;
+
+const char *kind_name(AnomalyDetector::Alert::Kind kind) {
+  switch (kind) {
+  case AnomalyDetector::Alert::Kind::Jump:
+    return "jump";
+  case AnomalyDetector::Alert::Kind::Stale:
+    return "stale";
+  case AnomalyDetector::Alert::Kind::Resumed:
+    return "resumed";
+  }
+  return "unknown";
+}
+
+} // namespace
+
+std::string AnomalyDetector::Alert::to_json() const {
+  return fmt::format(
+      R"({{"type":"alert","kind":"{}","symbol":{},"sequence":{},)"
+      R"("price":{},"expected":{},"sigma":{},"silent_ms":{}}})",
+      kind_name(kind), symbol_id, sequence_number, price, expected, sigma,
+      std::chrono::duration_cast<std::chrono::milliseconds>(silent_for)
+          .count());
+}
+
+AnomalyDetector::AnomalyDetector(const Config &config,
+                                 MetricsRegistry *metrics,
+                                 const std::string &metrics_prefix)
+    : mean_(config.max_symbol_id + 1, 0.0),
+      variance_(config.max_symbol_id + 1, 0.0),
+      last_seen_(config.max_symbol_id + 1, 0),
+      samples_(config.max_symbol_id + 1, 0),
+      stale_(config.max_symbol_id + 1, 0),
+      jump_sigma_sq_(config.jump_sigma > 0
+                         ? config.jump_sigma * config.jump_sigma
+                         : std::numeric_limits<double>::infinity()),
+      alpha_(config.ewma_alpha), warmup_(config.warmup),
+      stale_after_(static_cast<uint64_t>(config.stale_after.count())) {
+  if (alpha_ <= 0 || alpha_ > 1) {
+    throw std::runtime_error("ewma_alpha must be in (0, 1]");
+  }
+  if (metrics) {
+    jump_counter_ = &metrics->counter(metrics_prefix + "jumps");
+    stale_counter_ = &metrics->counter(metrics_prefix + "stale");
+    stale_symbols_gauge_ = &metrics->counter(metrics_prefix + "stale_symbols");
+  }
+}
+
+std::unique_ptr<AnomalyDetector>
+AnomalyDetector::create(const CaptureConfig &config, MetricsRegistry *metrics,
+                        const std::string &metrics_prefix) {
+  if (config.anomaly_jump_sigma <= 0 && config.stale_after.count() <= 0) {
+    return nullptr;
+  }
+  Config detector_config;
+  detector_config.max_symbol_id = config.max_symbol_id;
+  detector_config.jump_sigma = config.anomaly_jump_sigma;
+  detector_config.ewma_alpha = config.anomaly_ewma_alpha;
+  detector_config.stale_after = config.stale_after;
+  return std::make_unique<AnomalyDetector>(detector_config, metrics,
+                                           metrics_prefix);
+}
+
+void AnomalyDetector::observe(std::span<const MarketMessage> batch,
+                              uint64_t now_ns) {
+  for (const auto &msg : batch) {
+    const uint32_t id = msg.symbol_id;
+    last_seen_[id] = now_ns;
+
+    if (stale_[id]) [[unlikely]] {
+      stale_[id] = 0;
+      stale_symbols_.fetch_sub(1, std::memory_order_relaxed);
+      resumed_.fetch_add(1, std::memory_order_relaxed);
+      raise({Alert::Kind::Resumed, id, msg.sequence_number, msg.trade.price,
+             mean_[id], 0.0});
+    }
+
+    if (msg.type != MessageType::Trade) {
+      continue;
+    }
+    if (msg.trade.flags & kTradeSuspect) [[unlikely]] {
+      suspect_skipped_.fetch_add(1, std::memory_order_relaxed);
+      continue;
+    }
+    const double price = msg.trade.price;
+    if (samples_[id] == 0) {
+      mean_[id] = price;
+      samples_[id] = 1;
+      continue;
+    }
+
+    // Compare squares to keep the square root off the per-tick path
+    const double deviation = price - mean_[id];
+    const double floor = mean_[id] * kMinRelativeSigma;
+    const double variance = std::max(variance_[id], floor * floor);
+    if (samples_[id] >= warmup_ &&
+        deviation * deviation > jump_sigma_sq_ * variance) [[unlikely]] {
+      jumps_.fetch_add(1, std::memory_order_relaxed);
+      if (jump_counter_) {
+        jump_counter_->add();
+      }
+      raise({Alert::Kind::Jump, id, msg.sequence_number, price, mean_[id],
+             std::sqrt(variance)});
+    }
+
+    // Incremental EWMA of the mean and variance
+    mean_[id] += alpha_ * deviation;
+    variance_[id] =
+        (1.0 - alpha_) * (variance_[id] + alpha_ * deviation * deviation);
+    samples_[id] += samples_[id] < warmup_;
+  }
+}
+
+void AnomalyDetector::check_stale(uint64_t now_ns) {
+  if (stale_after_ == 0 || now_ns < next_stale_check_) {
+    return;
+  }
+  next_stale_check_ = now_ns + stale_after_ / 4;
+
+  for (uint32_t id = 1; id < last_seen_.size(); ++id) {
+    const uint64_t seen = last_seen_[id];
+    if (seen == 0 || stale_[id] || now_ns - seen <= stale_after_) {
+      continue;
+    }
+    stale_[id] = 1;
+    stale_symbols_.fetch_add(1, std::memory_order_relaxed);
+    stale_events_.fetch_add(1, std::memory_order_relaxed);
+    if (stale_counter_) {
+      stale_counter_->add();
+    }
+    Alert alert{Alert::Kind::Stale, id, 0, mean_[id], mean_[id], 0.0};
+    alert.silent_for = std::chrono::nanoseconds(now_ns - seen);
+    raise(alert);
+  }
+
+  if (stale_symbols_gauge_) {
+    stale_symbols_gauge_->set(stale_symbols_.load(std::memory_order_relaxed));
+  }
+}
+
+void AnomalyDetector::raise(const Alert &alert) {
+  std::lock_guard<std::mutex> lock(alerts_mutex_);
+  if (alerts_.size() >= kMaxPendingAlerts) {
+    alerts_dropped_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  alerts_.push_back(alert);
+}
+
+std::vector<AnomalyDetector::Alert> AnomalyDetector::take_alerts() {
+  std::lock_guard<std::mutex> lock(alerts_mutex_);
+  std::vector<Alert> taken;
+  taken.swap(alerts_);
+  return taken;
+}
+
+AnomalyDetector::Stats AnomalyDetector::get_stats() const {
+  Stats stats;
+  stats.jumps = jumps_.load(std::memory_order_relaxed);
+  stats.stale_events = stale_events_.load(std::memory_order_relaxed);
+  stats.resumed = resumed_.load(std::memory_order_relaxed);
+  stats.stale_symbols = stale_symbols_.load(std::memory_order_relaxed);
+  stats.alerts_dropped = alerts_dropped_.load(std::memory_order_relaxed);
+  stats.suspect_skipped = suspect_skipped_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+} // namespace tick_capture
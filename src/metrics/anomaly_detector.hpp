@@ -0,0 +1,121 @@
+#pragma once
+#include "../../include/tick_capture/types.hpp"
+#include "metrics_registry.hpp"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace tick_capture {
+
+// Streaming price-jump and stale-feed detector, fed each batch on the
+// processing path.
+//
+// Per symbol it tracks an EWMA of the trade price and of the squared
+// deviation from it. A trade more than jump_sigma deviations from the
+// average raises a jump alert, once the symbol has warmed up. A symbol
+// seen before but silent for longer than stale_after raises a stale alert,
+// and a resumed alert when it trades again. Trades the price bands flagged
+// suspect are already reported, so they are counted but left out of the
+// average and never raise a jump.
+//
+// State is a flat structure of arrays indexed by symbol id, so a tick costs
+// a few loads, a multiply-add and a compare. Only the processing thread
+// touches it. Alerts are queued for another thread to publish, and counted
+// in the metrics registry if one is given.
+class AnomalyDetector {
+public:
+  struct Config {
+    uint32_t max_symbol_id{kDefaultMaxSymbolId};
+    double jump_sigma{0.0}; // 0 disables jump detection
+    double ewma_alpha{0.05};
+    uint32_t warmup{20}; // Trades seen before jumps are reported
+    std::chrono::nanoseconds stale_after{0}; // 0 disables stale detection
+  };
+
+  struct Alert {
+    enum class Kind : uint8_t { Jump, Stale, Resumed };
+    Kind kind;
+    uint32_t symbol_id;
+    uint64_t sequence_number; // Triggering trade (jumps only)
+    double price;             // Triggering price (EWMA price if stale)
+    double expected;          // EWMA price
+    double sigma;             // EWMA deviation (jumps only)
+    std::chrono::nanoseconds silent_for{0};
+
+    std::string to_json() const;
+  };
+
+  struct Stats {
+    uint64_t jumps{0};
+    uint64_t stale_events{0};
+    uint64_t resumed{0};
+    uint64_t stale_symbols{0}; // Currently stale
+    uint64_t alerts_dropped{0};
+    uint64_t suspect_skipped{0}; // Suspect trades left out of the EWMA
+  };
+
+  // Counters are registered as <metrics_prefix>jumps, stale and
+  // stale_symbols
+  explicit AnomalyDetector(const Config &config,
+                           MetricsRegistry *metrics = nullptr,
+                           const std::string &metrics_prefix = "anomaly.");
+
+  // A detector for a capture config, or nullptr if both checks are off
+  static std::unique_ptr<AnomalyDetector>
+  create(const CaptureConfig &config, MetricsRegistry *metrics = nullptr,
+         const std::string &metrics_prefix = "anomaly.");
+
+  // Non-copyable
+  AnomalyDetector(const AnomalyDetector &) = delete;
+  AnomalyDetector &operator=(const AnomalyDetector &) = delete;
+
+  // Processing thread: account a batch that arrived at now_ns (steady
+  // clock). Symbol ids must already be validated against max_symbol_id.
+  void observe(std::span<const MarketMessage> batch, uint64_t now_ns);
+
+  // Processing thread: look for silent symbols. Cheap to call on every
+  // loop; the table is only scanned a few times per stale_after.
+  void check_stale(uint64_t now_ns);
+
+  // Any thread: alerts raised since the last call, oldest first
+  std::vector<Alert> take_alerts();
+
+  Stats get_stats() const;
+
+private:
+  void raise(const Alert &alert);
+
+  // Structure of arrays, indexed by symbol id
+  std::vector<double> mean_;
+  std::vector<double> variance_;
+  std::vector<uint64_t> last_seen_; // Steady ns, 0 = never traded
+  std::vector<uint32_t> samples_;
+  std::vector<uint8_t> stale_;
+
+  double jump_sigma_sq_;
+  double alpha_;
+  uint32_t warmup_;
+  uint64_t stale_after_;
+  uint64_t next_stale_check_{0};
+
+  // Pending alerts, bounded so a feed-wide outage cannot grow it unchecked
+  static constexpr size_t kMaxPendingAlerts = 4096;
+  std::mutex alerts_mutex_;
+  std::vector<Alert> alerts_;
+
+  std::atomic<uint64_t> jumps_{0};
+  std::atomic<uint64_t> stale_events_{0};
+  std::atomic<uint64_t> resumed_{0};
+  std::atomic<uint64_t> stale_symbols_{0};
+  std::atomic<uint64_t> alerts_dropped_{0};
+  std::atomic<uint64_t> suspect_skipped_{0};
+
+  MetricsRegistry::Counter *jump_counter_{nullptr};
+  MetricsRegistry::Counter *stale_counter_{nullptr};
+  MetricsRegistry::Counter *stale_symbols_gauge_{nullptr};
+};
+
+} // namespace tick_capture
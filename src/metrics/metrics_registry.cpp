@@ -0,0 +1,120 @@
+#include "metrics_registry.hpp"
+#include <algorithm>
+#include <fmt/format.h>
+
+namespace tick_capture {
+
+MetricsRegistry::Counter &MetricsRegistry::counter(const std::string &name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto &slot = counters_[name];
+  if (!slot) {
+    slot = std::make_unique<Counter>();
+  }
+  return *slot;
+}
+
+uint64_t MetricsRegistry::Histogram::percentile(double q) const noexcept {
+  const uint64_t total = count();
+  if (total == 0) {
+    return 0;
+  }
+  const auto rank = static_cast<uint64_t>(q * static_cast<double>(total));
+  uint64_t seen = 0;
+  for (size_t i = 0; i < kBuckets; ++i) {
+    seen += bucket(i);
+    if (seen > rank || seen == total) {
+      return i == 0 ? 0 : std::min(max(), (uint64_t{1} << (i - 1)) * 2 - 1);
+    }
+  }
+  return max();
+}
+
+MetricsRegistry::Histogram::Snapshot
+MetricsRegistry::Histogram::snapshot() const noexcept {
+  Snapshot snapshot;
+  for (size_t i = 0; i < kBuckets; ++i) {
+    snapshot.buckets[i] = bucket(i);
+  }
+  snapshot.count = count();
+  snapshot.sum = sum();
+  return snapshot;
+}
+
+MetricsRegistry::Histogram::Snapshot
+MetricsRegistry::Histogram::Snapshot::operator-(
+    const Snapshot &earlier) const noexcept {
+  Snapshot delta;
+  for (size_t i = 0; i < kBuckets; ++i) {
+    delta.buckets[i] = buckets[i] - earlier.buckets[i];
+  }
+  delta.count = count - earlier.count;
+  delta.sum = sum - earlier.sum;
+  return delta;
+}
+
+uint64_t
+MetricsRegistry::Histogram::Snapshot::percentile(double q) const noexcept {
+  // Bucket totals are read one by one, so use their sum as the count
+  uint64_t total = 0;
+  for (const auto n : buckets) {
+    total += n;
+  }
+  if (total == 0) {
+    return 0;
+  }
+  const auto rank = static_cast<uint64_t>(q * static_cast<double>(total));
+  uint64_t seen = 0;
+  for (size_t i = 0; i < kBuckets; ++i) {
+    seen += buckets[i];
+    if (seen > rank) {
+      return i == 0 ? 0 : (uint64_t{1} << (i - 1)) * 2 - 1;
+    }
+  }
+  return UINT64_MAX;
+}
+
+MetricsRegistry::Histogram &
+MetricsRegistry::histogram(const std::string &name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto &slot = histograms_[name];
+  if (!slot) {
+    slot = std::make_unique<Histogram>();
+  }
+  return *slot;
+}
+
+std::vector<std::pair<std::string, uint64_t>>
+MetricsRegistry::snapshot() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<std::pair<std::string, uint64_t>> values;
+  values.reserve(counters_.size());
+  for (const auto &[name, counter] : counters_) {
+    values.emplace_back(name, counter->value());
+  }
+  return values;
+}
+
+std::string MetricsRegistry::to_json() const {
+  std::string json = "{";
+  for (const auto &[name, value] : snapshot()) {
+    if (json.size() > 1) {
+      json += ',';
+    }
+    json += fmt::format(R"("{}":{})", name, value);
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto &[name, histogram] : histograms_) {
+    if (json.size() > 1) {
+      json += ',';
+    }
+    json += fmt::format(
+        R"("{}":{{"count":{},"sum":{},"max":{},"p50":{},"p99":{}}})", name,
+        histogram->count(), histogram->sum(), histogram->max(),
+        histogram->percentile(0.5), histogram->percentile(0.99));
+  }
+  json += '}';
+  return json;
+}
+
+} // namespace tick_capture
@@ -0,0 +1,117 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace tick_capture {
+
+// Named counters and histograms shared by every pipeline in a process.
+// Metrics are registered once during setup and then updated lock-free
+// through the returned reference, which stays valid for the registry's
+// lifetime.
+class MetricsRegistry {
+public:
+  class Counter {
+  public:
+    void add(uint64_t n = 1) noexcept {
+      value_.fetch_add(n, std::memory_order_relaxed);
+    }
+    // For gauges mirrored from another component's stats
+    void set(uint64_t v) noexcept {
+      value_.store(v, std::memory_order_relaxed);
+    }
+    uint64_t value() const noexcept {
+      return value_.load(std::memory_order_relaxed);
+    }
+
+  private:
+    std::atomic<uint64_t> value_{0};
+  };
+
+  // Distribution of non-negative values in power-of-two buckets: bucket i
+  // counts values in [2^(i-1), 2^i), bucket 0 counts zeros. Recording is
+  // a few relaxed atomic adds.
+  class Histogram {
+  public:
+    static constexpr size_t kBuckets = 65;
+
+    void record(uint64_t v) noexcept {
+      buckets_[std::bit_width(v)].fetch_add(1, std::memory_order_relaxed);
+      count_.fetch_add(1, std::memory_order_relaxed);
+      sum_.fetch_add(v, std::memory_order_relaxed);
+      uint64_t max = max_.load(std::memory_order_relaxed);
+      while (v > max && !max_.compare_exchange_weak(
+                            max, v, std::memory_order_relaxed)) {
+      }
+    }
+
+    uint64_t count() const noexcept {
+      return count_.load(std::memory_order_relaxed);
+    }
+    uint64_t sum() const noexcept {
+      return sum_.load(std::memory_order_relaxed);
+    }
+    uint64_t max() const noexcept {
+      return max_.load(std::memory_order_relaxed);
+    }
+    uint64_t bucket(size_t i) const noexcept {
+      return buckets_[i].load(std::memory_order_relaxed);
+    }
+
+    // Upper bound of the bucket holding quantile q (0..1), 0 if empty
+    uint64_t percentile(double q) const noexcept;
+
+    // Bucket counts at one instant. The difference of two snapshots is
+    // the distribution of values recorded in between.
+    struct Snapshot {
+      std::array<uint64_t, kBuckets> buckets{};
+      uint64_t count = 0;
+      uint64_t sum = 0;
+
+      Snapshot operator-(const Snapshot &earlier) const noexcept;
+      // As Histogram::percentile, without the clamp to the maximum
+      uint64_t percentile(double q) const noexcept;
+    };
+    Snapshot snapshot() const noexcept;
+
+  private:
+    std::array<std::atomic<uint64_t>, kBuckets> buckets_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> max_{0};
+  };
+
+  MetricsRegistry() = default;
+
+  // Non-copyable
+  MetricsRegistry(const MetricsRegistry &) = delete;
+  MetricsRegistry &operator=(const MetricsRegistry &) = delete;
+
+  // Get or create the counter with this name
+  Counter &counter(const std::string &name);
+
+  // Get or create the histogram with this name
+  Histogram &histogram(const std::string &name);
+
+  // Current counter values, sorted by name
+  std::vector<std::pair<std::string, uint64_t>> snapshot() const;
+
+  // Counters as a flat JSON object, e.g. {"feed.a.processed":42}, with a
+  // summary object per histogram, e.g.
+  // "feed.a.batch":{"count":9,"sum":80,"max":32,"p50":8,"p99":32}
+  std::string to_json() const;
+
+private:
+  mutable std::mutex mutex_;
+  std::map<std::string, std::unique_ptr<Counter>> counters_;
+  std::map<std::string, std::unique_ptr<Histogram>> histograms_;
+};
+
+} // namespace tick_capture
@@ -0,0 +1,143 @@
+#include "thread_stats.hpp"
+#include "../memory/allocation_counter.hpp"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <pthread.h>
+#include <sstream>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace tick_capture {
+
+namespace {
+
+// ioprio_set(2) has no glibc wrapper
+constexpr int kIoprioWhoProcess = 1;
+constexpr int kIoprioClassIdle = 3;
+constexpr int kIoprioClassShift = 13;
+
+// Value of a "Key:   value" line in a /proc status file, 0 if absent
+uint64_t status_field(const std::filesystem::path &path,
+                      const std::string &key) {
+  std::ifstream file(path);
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line.compare(0, key.size(), key) == 0 && line.size() > key.size() &&
+        line[key.size()] == ':') {
+      return std::stoull(line.substr(key.size() + 1));
+    }
+  }
+  return 0;
+}
+
+std::chrono::nanoseconds cpu_time(pid_t tid,
+                                  const std::filesystem::path &task) {
+  // The per-thread CPU clock pthread_getcpuclockid() would return, built
+  // from the kernel thread id as glibc does (CPUCLOCK_SCHED, per thread),
+  // so threads we hold no pthread_t for can be read at ns resolution
+  const clockid_t clock = ((~static_cast<clockid_t>(tid)) << 3) | 6;
+  timespec ts{};
+  if (::clock_gettime(clock, &ts) == 0) {
+    return std::chrono::seconds(ts.tv_sec) +
+           std::chrono::nanoseconds(ts.tv_nsec);
+  }
+
+  // stat: utime and stime are fields 14 and 15, after the parenthesised
+  // name, which may itself contain spaces
+  std::ifstream stat(task / "stat");
+  std::string content((std::istreambuf_iterator<char>(stat)),
+                      std::istreambuf_iterator<char>());
+  const auto close = content.rfind(')');
+  if (close == std::string::npos) {
+    return std::chrono::nanoseconds(0);
+  }
+  std::istringstream fields(content.substr(close + 2));
+  std::string skip;
+  for (int i = 3; i < 14; ++i) {
+    fields >> skip;
+  }
+  uint64_t utime = 0, stime = 0;
+  fields >> utime >> stime;
+  const auto ticks_per_second = static_cast<uint64_t>(::sysconf(_SC_CLK_TCK));
+  return std::chrono::nanoseconds((utime + stime) * 1000000000ULL /
+                                  ticks_per_second);
+}
+
+} // namespace
+
+void set_thread_name(const char *name) {
+  char truncated[16] = {};
+  std::snprintf(truncated, sizeof(truncated), "%s", name);
+  ::pthread_setname_np(::pthread_self(), truncated);
+}
+
+void lower_thread_priority() {
+  const pid_t tid = ::gettid();
+  ::setpriority(PRIO_PROCESS, static_cast<id_t>(tid), 19);
+  ::syscall(SYS_ioprio_set, kIoprioWhoProcess, tid,
+            kIoprioClassIdle << kIoprioClassShift);
+}
+
+std::vector<ThreadUsage> sample_threads() {
+  std::map<pid_t, uint64_t> allocations;
+  for (const auto &[tid, count] : allocations_by_thread()) {
+    allocations[tid] += count;
+  }
+
+  std::vector<ThreadUsage> threads;
+  std::error_code ec;
+  for (const auto &entry :
+       std::filesystem::directory_iterator("/proc/self/task", ec)) {
+    ThreadUsage usage;
+    try {
+      usage.tid = static_cast<pid_t>(std::stol(entry.path().filename()));
+    } catch (const std::exception &) {
+      continue;
+    }
+
+    // The thread may exit while we read; skip it if so
+    std::ifstream comm(entry.path() / "comm");
+    if (!std::getline(comm, usage.name)) {
+      continue;
+    }
+    usage.cpu_time = cpu_time(usage.tid, entry.path());
+    usage.voluntary_switches =
+        status_field(entry.path() / "status", "voluntary_ctxt_switches");
+    usage.involuntary_switches =
+        status_field(entry.path() / "status", "nonvoluntary_ctxt_switches");
+    if (const auto it = allocations.find(usage.tid); it != allocations.end()) {
+      usage.allocations = it->second;
+    }
+    threads.push_back(std::move(usage));
+  }
+  return threads;
+}
+
+size_t resident_set_bytes() {
+  return status_field("/proc/self/status", "VmRSS") * 1024; // Reported in kB
+}
+
+size_t peak_resident_set_bytes() {
+  return status_field("/proc/self/status", "VmHWM") * 1024;
+}
+
+size_t open_fd_count() {
+  std::error_code ec;
+  size_t count = 0;
+  for (std::filesystem::directory_iterator it("/proc/self/fd", ec), end;
+       !ec && it != end; it.increment(ec)) {
+    ++count;
+  }
+  // Less the descriptor held open to list the directory
+  return count > 0 ? count - 1 : 0;
+}
+
+uint64_t bytes_written() {
+  return status_field("/proc/self/io", "wchar");
+}
+
+} // namespace tick_capture
@@ -0,0 +1,45 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+namespace tick_capture {
+
+// Name the calling thread (at most 15 characters are kept). Names show in
+// top -H and /proc, and let per-thread accounting attribute CPU to stages.
+void set_thread_name(const char *name);
+
+// Give the calling thread the lowest CPU priority and idle I/O priority, for
+// background work that must not compete with capture. Best effort.
+void lower_thread_priority();
+
+// CPU and scheduling counters of one thread of this process
+struct ThreadUsage {
+  pid_t tid;
+  std::string name;
+  std::chrono::nanoseconds cpu_time{0};
+  uint64_t voluntary_switches{0};   // Blocked or yielded
+  uint64_t involuntary_switches{0}; // Preempted
+  uint64_t allocations{0}; // Heap allocations, if counting is enabled
+};
+
+// Every live thread of this process, listed from /proc/self/task. CPU time
+// is read from each thread's CPU clock in nanoseconds, falling back to
+// utime + stime in clock ticks. Allocation counts come from
+// allocation_counter.hpp.
+std::vector<ThreadUsage> sample_threads();
+
+// Current and peak resident set size of this process, in bytes
+size_t resident_set_bytes();
+size_t peak_resident_set_bytes();
+
+// Open file descriptors of this process
+size_t open_fd_count();
+
+// Bytes this process has passed to write() and friends since it started,
+// whether or not they have reached disk yet (0 if /proc/self/io is absent)
+uint64_t bytes_written();
+
+} // namespace tick_capture
@@ -0,0 +1,168 @@
+#include "tracer.hpp"
+#include <algorithm>
+#include <fmt/format.h>
+#include <fstream>
+#include <map>
+
+namespace tick_capture {
+
+namespace {
+
+const char *stage_name(TraceStage stage) {
+  switch (stage) {
+  case TraceStage::Recv:
+    return "recv";
+  case TraceStage::RingPush:
+    return "ring_push";
+  case TraceStage::Dequeue:
+    return "dequeue";
+  case TraceStage::Store:
+    return "store";
+  case TraceStage::Publish:
+    return "publish";
+  }
+  return "unknown";
+}
+
+size_t next_power_of_2(size_t v) {
+  size_t p = 1;
+  while (p < v) {
+    p <<= 1;
+  }
+  return p;
+}
+
+} // namespace
+
+TraceRing::TraceRing(std::string thread_name, size_t capacity)
+    : thread_name_(std::move(thread_name)),
+      events_(next_power_of_2(capacity)), mask_(events_.size() - 1) {}
+
+std::vector<TraceRing::Event> TraceRing::snapshot() const {
+  const uint64_t end = write_pos_.load(std::memory_order_acquire);
+  const uint64_t capacity = events_.size();
+  uint64_t begin = end > capacity ? end - capacity : 0;
+
+  std::vector<Event> events;
+  events.reserve(end - begin);
+  for (uint64_t pos = begin; pos < end; ++pos) {
+    events.push_back(events_[pos & mask_]);
+  }
+
+  // Drop the slots the owner may have rewritten while we copied
+  const uint64_t after = write_pos_.load(std::memory_order_acquire);
+  if (after > begin + capacity) {
+    const uint64_t overwritten = std::min<uint64_t>(
+        after - (begin + capacity), events.size());
+    events.erase(events.begin(),
+                 events.begin() + static_cast<ptrdiff_t>(overwritten));
+  }
+  return events;
+}
+
+Tracer::Tracer(uint32_t sample_every)
+    : sample_every_(std::max<uint32_t>(sample_every, 1)),
+      countdown_(sample_every_) {}
+
+TraceRing &Tracer::add_thread(const std::string &name) {
+  std::lock_guard<std::mutex> lock(rings_mutex_);
+  rings_.push_back(std::make_unique<TraceRing>(name, kRingCapacity));
+  return *rings_.back();
+}
+
+size_t Tracer::tag(std::span<MarketMessage> batch, TraceRing &ring,
+                   uint64_t recv_tsc) noexcept {
+  // Jump straight to each sampled position
+  size_t tagged = 0;
+  size_t pos = countdown_ - 1;
+  for (; pos < batch.size(); pos += sample_every_) {
+    auto &msg = batch[pos];
+    // reserved is one checksummed word; a bad checksum stays bad
+    msg.checksum ^= msg.reserved;
+    msg.reserved = next_id_++;
+    msg.checksum ^= msg.reserved;
+    if (next_id_ == 0) {
+      next_id_ = 1; // 0 means untagged
+    }
+    ring.record(msg, TraceStage::Recv, recv_tsc);
+    ++tagged;
+  }
+  countdown_ = static_cast<uint32_t>(pos - batch.size() + 1);
+
+  tagged_.fetch_add(tagged, std::memory_order_relaxed);
+  return tagged;
+}
+
+std::string Tracer::to_chrome_json() const {
+  struct Point {
+    TraceRing::Event event;
+    size_t tid;
+  };
+
+  // Gather every ring's events by trace id
+  std::map<uint32_t, std::vector<Point>> traces;
+  std::vector<std::string> thread_names;
+  uint64_t base = UINT64_MAX;
+  {
+    std::lock_guard<std::mutex> lock(rings_mutex_);
+    for (size_t tid = 0; tid < rings_.size(); ++tid) {
+      thread_names.push_back(rings_[tid]->thread_name());
+      for (const auto &event : rings_[tid]->snapshot()) {
+        traces[event.trace_id].push_back({event, tid + 1});
+        base = std::min(base, event.tsc);
+      }
+    }
+  }
+
+  const double us_per_tick = CycleClock::ns_per_tick() / 1000.0;
+  std::string json = R"({"displayTimeUnit":"ns","traceEvents":[)";
+  bool first = true;
+  const auto append = [&](const std::string &event) {
+    if (!first) {
+      json += ',';
+    }
+    first = false;
+    json += event;
+  };
+
+  for (size_t i = 0; i < thread_names.size(); ++i) {
+    append(fmt::format(R"({{"name":"thread_name","ph":"M","pid":1,"tid":{},)"
+                       R"("args":{{"name":"{}"}}}})",
+                       i + 1, thread_names[i]));
+  }
+
+  // One span per stage transition, on the thread that completed it
+  for (auto &[trace_id, points] : traces) {
+    std::sort(points.begin(), points.end(),
+              [](const Point &a, const Point &b) {
+                return a.event.tsc != b.event.tsc
+                           ? a.event.tsc < b.event.tsc
+                           : a.event.stage < b.event.stage;
+              });
+    for (size_t i = 1; i < points.size(); ++i) {
+      const auto &from = points[i - 1].event;
+      const auto &to = points[i].event;
+      append(fmt::format(
+          R"({{"name":"{}","cat":"tick","ph":"X","pid":1,"tid":{},)"
+          R"("ts":{:.3f},"dur":{:.3f},"args":{{"trace":{},"seq":{}}}}})",
+          stage_name(to.stage), points[i].tid,
+          static_cast<double>(from.tsc - base) * us_per_tick,
+          static_cast<double>(to.tsc - from.tsc) * us_per_tick, trace_id,
+          to.sequence_number));
+    }
+  }
+
+  json += "]}";
+  return json;
+}
+
+void Tracer::export_chrome(const std::filesystem::path &path) const {
+  std::ofstream file(path, std::ios::trunc);
+  file << to_chrome_json();
+  if (!file.flush()) {
+    throw std::runtime_error(
+        fmt::format("Failed to write trace {}", path.string()));
+  }
+}
+
+} // namespace tick_capture
@@ -0,0 +1,127 @@
+#pragma once
+#include "../../include/tick_capture/types.hpp"
+#include "watchdog.hpp"
+#include <atomic>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace tick_capture {
+
+// Pipeline stages a sampled tick is timed at
+enum class TraceStage : uint8_t {
+  Recv,      // Packet returned by recv
+  RingPush,  // Published to the capture ring
+  Dequeue,   // Taken off the ring by the processing thread
+  Store,     // Written and flushed by TickStorage
+  Publish,   // Handed to the live distribution bus
+};
+
+// Fixed-size ring of trace events written by one thread. Old events are
+// overwritten, so memory is bounded however long tracing runs.
+class TraceRing {
+public:
+  struct Event {
+    uint64_t tsc; // CycleClock ticks
+    uint64_t sequence_number;
+    uint32_t trace_id;
+    TraceStage stage;
+  };
+
+  TraceRing(std::string thread_name, size_t capacity);
+
+  // Owning thread only
+  void record(const MarketMessage &msg, TraceStage stage,
+              uint64_t tsc) noexcept {
+    const uint64_t pos = write_pos_.load(std::memory_order_relaxed);
+    events_[pos & mask_] = {tsc, msg.sequence_number, msg.reserved, stage};
+    write_pos_.store(pos + 1, std::memory_order_release);
+  }
+
+  // Events still in the ring, oldest first. Safe to call while the owner
+  // records; events overwritten during the copy are left out.
+  std::vector<Event> snapshot() const;
+
+  const std::string &thread_name() const { return thread_name_; }
+
+private:
+  std::string thread_name_;
+  std::vector<Event> events_;
+  uint64_t mask_;
+  std::atomic<uint64_t> write_pos_{0};
+};
+
+// 1-in-N sampled tracing of individual ticks through the pipeline.
+//
+// The capture thread tags every Nth valid tick with a trace id, carried in
+// MarketMessage::reserved, which senders leave 0. Each stage that handles a
+// tagged tick records a TSC timestamp into its own thread's TraceRing;
+// untagged ticks cost one compare at each stage. Trace ids are stripped
+// before a tick is stored or published. export_chrome() merges the rings
+// and writes one span per stage transition of each tick, in Chrome trace
+// event JSON, which chrome://tracing and Perfetto open directly.
+class Tracer {
+public:
+  static constexpr size_t kRingCapacity = 8192; // Events per thread
+
+  explicit Tracer(uint32_t sample_every);
+
+  // Non-copyable
+  Tracer(const Tracer &) = delete;
+  Tracer &operator=(const Tracer &) = delete;
+
+  // Ring for a pipeline thread, registered during setup. The reference
+  // stays valid for the tracer's lifetime.
+  TraceRing &add_thread(const std::string &name);
+
+  // Capture thread: tag every Nth tick of a batch of valid ticks and record
+  // its recv time. Returns the number tagged.
+  size_t tag(std::span<MarketMessage> batch, TraceRing &ring,
+             uint64_t recv_tsc) noexcept;
+
+  // Record a stage for every tagged tick in a batch, reading the clock
+  // only if there is one
+  static void record(std::span<const MarketMessage> batch, TraceRing &ring,
+                     TraceStage stage) noexcept {
+    uint64_t tsc = 0;
+    for (const auto &msg : batch) {
+      if (msg.reserved != 0) [[unlikely]] {
+        if (tsc == 0) {
+          tsc = CycleClock::now();
+        }
+        ring.record(msg, stage, tsc);
+      }
+    }
+  }
+
+  // Remove a tick's trace id, carrying it out of the checksum so a valid
+  // one stays valid and a bad one bad; false if it had none
+  static bool strip(MarketMessage &msg) noexcept {
+    if (msg.reserved == 0) [[likely]] {
+      return false;
+    }
+    msg.checksum ^= msg.reserved;
+    msg.reserved = 0;
+    return true;
+  }
+
+  // Write the events currently held as Chrome trace JSON
+  std::string to_chrome_json() const;
+  void export_chrome(const std::filesystem::path &path) const;
+
+  uint64_t tagged() const { return tagged_.load(std::memory_order_relaxed); }
+
+private:
+  uint32_t sample_every_;
+  uint32_t countdown_;
+  uint32_t next_id_{1};
+  std::atomic<uint64_t> tagged_{0};
+
+  mutable std::mutex rings_mutex_;
+  std::vector<std::unique_ptr<TraceRing>> rings_;
+};
+
+} // namespace tick_capture
@@ -0,0 +1,189 @@
+#include "watchdog.hpp"
+#include "thread_stats.hpp"
+#include <algorithm>
+#include <fmt/format.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace tick_capture {
+
+namespace {
+
+constexpr size_t kMaxPendingEvents = 1024;
+
+uint64_t steady_ns() {
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+}
+
+} // namespace
+
+uint64_t CycleClock::now() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return steady_ns();
+#endif
+}
+
+double CycleClock::ns_per_tick() {
+#if defined(__x86_64__) || defined(__i386__)
+  // Measure the TSC rate against the steady clock over a short sleep
+  static const double rate = [] {
+    const uint64_t ns_start = steady_ns();
+    const uint64_t tsc_start = __rdtsc();
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    const uint64_t ns_end = steady_ns();
+    const uint64_t tsc_end = __rdtsc();
+    return static_cast<double>(ns_end - ns_start) /
+           static_cast<double>(std::max<uint64_t>(tsc_end - tsc_start, 1));
+  }();
+  return rate;
+#else
+  return 1.0;
+#endif
+}
+
+std::string Watchdog::Event::to_json() const {
+  return fmt::format(
+      R"({{"type":"{}","stage":"{}","duration_us":{},"progress":{}}})",
+      stalled ? "stall" : "stall_recovered", stage,
+      std::chrono::duration_cast<std::chrono::microseconds>(duration).count(),
+      progress);
+}
+
+Watchdog::Watchdog(const Config &config, MetricsRegistry &metrics,
+                   const std::string &metrics_prefix)
+    : config_(config), metrics_(metrics), prefix_(metrics_prefix),
+      threshold_ticks_(static_cast<uint64_t>(
+          static_cast<double>(
+              std::chrono::nanoseconds(config.stall_threshold).count()) /
+          CycleClock::ns_per_tick())) {}
+
+Watchdog::~Watchdog() { stop(); }
+
+void Watchdog::watch(const std::string &stage, const Heartbeat &heartbeat) {
+  const auto name = prefix_ + stage;
+  std::lock_guard<std::mutex> lock(mutex_);
+  stages_.push_back({stage, &heartbeat, false, 0,
+                     &metrics_.counter(name + ".stalls"),
+                     &metrics_.counter(name + ".stalled"),
+                     &metrics_.histogram(name + ".stall_us")});
+}
+
+void Watchdog::start() {
+  if (running_)
+    return;
+  running_ = true;
+  thread_ = std::thread([this] {
+    set_thread_name("watchdog");
+    run();
+  });
+}
+
+void Watchdog::stop() {
+  {
+    std::lock_guard<std::mutex> lock(stop_mutex_);
+    if (!running_)
+      return;
+    running_ = false;
+  }
+  stop_cv_.notify_all();
+
+  if (thread_.joinable())
+    thread_.join();
+
+  // Stages are re-registered on the next start
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto &stage : stages_) {
+    stage.stalled_gauge->set(0);
+  }
+  stages_.clear();
+}
+
+void Watchdog::run() {
+  // Time before start() does not count towards a stall
+  const uint64_t armed_at = CycleClock::now();
+
+  while (running_) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (auto &stage : stages_) {
+        check(stage, armed_at);
+      }
+    }
+
+    std::unique_lock<std::mutex> lock(stop_mutex_);
+    stop_cv_.wait_for(lock, config_.check_interval,
+                      [this] { return !running_; });
+  }
+}
+
+void Watchdog::check(Stage &stage, uint64_t armed_at) {
+  // Read the beat before the clock, so a beat in between cannot look like
+  // one from the future
+  const uint64_t last = std::max(stage.heartbeat->last_activity(), armed_at);
+  const uint64_t now = CycleClock::now();
+  const auto to_ns = [](uint64_t ticks) {
+    return std::chrono::nanoseconds(static_cast<int64_t>(
+        static_cast<double>(ticks) * CycleClock::ns_per_tick()));
+  };
+
+  if (!stage.stalled) {
+    if (now > last && now - last > threshold_ticks_) {
+      stage.stalled = true;
+      stage.stalled_since = last;
+      stage.stalls->add();
+      stage.stalled_gauge->set(1);
+
+      const auto silent = to_ns(now - last);
+      fmt::print(stderr, "Watchdog: {} stalled, no progress for {} ms\n",
+                 stage.name,
+                 std::chrono::duration_cast<std::chrono::milliseconds>(silent)
+                     .count());
+      push_event({stage.name, true, silent, stage.heartbeat->progress()});
+    }
+  } else if (last != stage.stalled_since) {
+    stage.stalled = false;
+    stage.stalled_gauge->set(0);
+
+    const auto duration = to_ns(last - stage.stalled_since);
+    stage.stall_us->record(static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(duration)
+            .count()));
+    fmt::print(stderr, "Watchdog: {} recovered after {} ms\n", stage.name,
+               std::chrono::duration_cast<std::chrono::milliseconds>(duration)
+                   .count());
+    push_event({stage.name, false, duration, stage.heartbeat->progress()});
+  }
+}
+
+void Watchdog::push_event(Event event) {
+  // Called with mutex_ held
+  if (events_.size() < kMaxPendingEvents) {
+    events_.push_back(std::move(event));
+  }
+}
+
+std::vector<Watchdog::Event> Watchdog::take_events() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<Event> taken;
+  taken.swap(events_);
+  return taken;
+}
+
+std::vector<std::string> Watchdog::stalled_stages() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<std::string> stalled;
+  for (const auto &stage : stages_) {
+    if (stage.stalled) {
+      stalled.push_back(stage.name);
+    }
+  }
+  return stalled;
+}
+
+} // namespace tick_capture
@@ -0,0 +1,123 @@
+#pragma once
+#include "metrics_registry.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace tick_capture {
+
+// Cheap timestamps for hot loops: the TSC on x86, the steady clock elsewhere.
+// Tick deltas convert to nanoseconds with a rate calibrated once per process.
+struct CycleClock {
+  static uint64_t now() noexcept;
+  static double ns_per_tick();
+};
+
+// Progress of one pipeline thread. The owning thread beats once per loop
+// iteration, with the number of items it completed; the stores are relaxed
+// and the slot has its own cache line, so a beat costs a TSC read and two
+// uncontended stores. A thread that is idle but looping keeps beating; one
+// blocked inside a call (a full disk, a stuck write) stops.
+class alignas(64) Heartbeat {
+public:
+  Heartbeat() : last_activity_(CycleClock::now()) {}
+
+  // Owning thread only
+  void beat(uint64_t items = 0) noexcept {
+    progress_.store(progress_.load(std::memory_order_relaxed) + items,
+                    std::memory_order_relaxed);
+    last_activity_.store(CycleClock::now(), std::memory_order_relaxed);
+  }
+
+  uint64_t progress() const noexcept {
+    return progress_.load(std::memory_order_relaxed);
+  }
+  uint64_t last_activity() const noexcept { // CycleClock ticks
+    return last_activity_.load(std::memory_order_relaxed);
+  }
+
+private:
+  std::atomic<uint64_t> progress_{0};
+  std::atomic<uint64_t> last_activity_;
+};
+
+// Watches the heartbeats of a pipeline's threads from a thread of its own.
+// A stage that has not beaten for stall_threshold is reported stalled; when
+// it beats again, the time between its last beat before the stall and its
+// first after is recorded in a histogram.
+//
+// Metrics per stage: <prefix><stage>.stalls (count), .stalled (1 while
+// stalled) and .stall_us (histogram). Events are queued for the caller to
+// publish, e.g. to the coordinator.
+class Watchdog {
+public:
+  struct Config {
+    std::chrono::milliseconds stall_threshold{1000};
+    std::chrono::milliseconds check_interval{10};
+  };
+
+  struct Event {
+    std::string stage;
+    bool stalled;                      // false: the stage recovered
+    std::chrono::nanoseconds duration; // Silent so far, or stall length
+    uint64_t progress;                 // Items completed by the stage
+
+    std::string to_json() const;
+  };
+
+  Watchdog(const Config &config, MetricsRegistry &metrics,
+           const std::string &metrics_prefix = "watchdog.");
+  ~Watchdog();
+
+  // Non-copyable
+  Watchdog(const Watchdog &) = delete;
+  Watchdog &operator=(const Watchdog &) = delete;
+
+  // Register a stage before start(); the heartbeat must outlive the
+  // watchdog or the next stop()
+  void watch(const std::string &stage, const Heartbeat &heartbeat);
+
+  void start();
+  void stop();
+
+  // Events since the last call, oldest first
+  std::vector<Event> take_events();
+
+  // Stages currently stalled
+  std::vector<std::string> stalled_stages() const;
+
+private:
+  struct Stage {
+    std::string name;
+    const Heartbeat *heartbeat;
+    bool stalled{false};
+    uint64_t stalled_since{0}; // Last beat before the stall
+    MetricsRegistry::Counter *stalls;
+    MetricsRegistry::Counter *stalled_gauge;
+    MetricsRegistry::Histogram *stall_us;
+  };
+
+  void run();
+  void check(Stage &stage, uint64_t armed_at);
+  void push_event(Event event);
+
+  Config config_;
+  MetricsRegistry &metrics_;
+  std::string prefix_;
+  uint64_t threshold_ticks_;
+
+  mutable std::mutex mutex_; // Guards stages_ and events_
+  std::vector<Stage> stages_;
+  std::vector<Event> events_;
+
+  std::atomic<bool> running_{false};
+  std::thread thread_;
+  std::mutex stop_mutex_;
+  std::condition_variable stop_cv_;
+};
+
+} // namespace tick_capture
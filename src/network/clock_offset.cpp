@@ -0,0 +1,39 @@
+#include "clock_offset.hpp"
+#include <cmath>
+
+namespace tick_capture {
+
+bool ClockOffsetFilter::add(int64_t t1, int64_t t2, int64_t t3, int64_t t4) {
+  estimate_.samples++;
+  const int64_t delay = (t4 - t1) - (t3 - t2);
+  if (delay < 0) {
+    return false;
+  }
+  // Halve each leg first so nanosecond timestamps cannot overflow
+  const int64_t offset = (t2 - t1) / 2 + (t3 - t4) / 2;
+
+  window_[next_] = {offset, delay};
+  next_ = (next_ + 1) % kWindow;
+  if (count_ < kWindow)
+    count_++;
+
+  const Sample *best = &window_[0];
+  for (size_t i = 1; i < count_; ++i) {
+    if (window_[i].delay < best->delay)
+      best = &window_[i];
+  }
+  double spread = 0;
+  for (size_t i = 0; i < count_; ++i) {
+    const double d = static_cast<double>(window_[i].offset - best->offset);
+    spread += d * d;
+  }
+
+  estimate_.offset = std::chrono::nanoseconds(best->offset);
+  estimate_.round_trip = std::chrono::nanoseconds(best->delay);
+  estimate_.jitter = std::chrono::nanoseconds(static_cast<int64_t>(
+      std::sqrt(spread / static_cast<double>(count_))));
+  estimate_.updated = std::chrono::system_clock::now();
+  return true;
+}
+
+} // namespace tick_capture
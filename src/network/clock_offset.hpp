@@ -0,0 +1,61 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace tick_capture {
+
+// A peer's wall clock relative to ours, from NTP-style exchanges: we send
+// at t1 (our clock), the peer receives at t2 and replies at t3 (its clock),
+// and we receive at t4. Then
+//
+//   offset = ((t2 - t1) + (t3 - t4)) / 2   peer clock minus ours
+//   delay  = (t4 - t1) - (t3 - t2)         round trip, less the peer's time
+//
+// and the offset is exact if both legs took as long. Queueing makes legs
+// uneven, and the error is at most delay / 2.
+struct ClockEstimate {
+  std::chrono::nanoseconds offset{0};
+  std::chrono::nanoseconds round_trip{0};
+  std::chrono::nanoseconds jitter{0}; // RMS spread of the offsets in window
+  uint64_t samples{0};                // Exchanges seen, including rejected
+  std::chrono::system_clock::time_point updated{};
+
+  // A time read from the peer's clock, on ours
+  std::chrono::system_clock::time_point
+  to_local(std::chrono::system_clock::time_point remote) const {
+    return remote - std::chrono::duration_cast<
+                        std::chrono::system_clock::duration>(offset);
+  }
+};
+
+// NTP's clock filter: keeps the last kWindow exchanges with one peer and
+// takes the offset of the one with the shortest round trip, as it had the
+// least room for queueing. A burst of delay therefore cannot move the
+// estimate until it has lasted a whole window.
+class ClockOffsetFilter {
+public:
+  static constexpr size_t kWindow = 8;
+
+  // Timestamps in nanoseconds since the epoch. Returns false, keeping the
+  // estimate, for an exchange with a negative round trip (a clock stepped
+  // during it).
+  bool add(int64_t t1, int64_t t2, int64_t t3, int64_t t4);
+
+  bool valid() const { return count_ > 0; }
+  const ClockEstimate &estimate() const { return estimate_; }
+
+private:
+  struct Sample {
+    int64_t offset;
+    int64_t delay;
+  };
+
+  std::array<Sample, kWindow> window_{};
+  size_t count_{0}; // Samples in window_
+  size_t next_{0};
+  ClockEstimate estimate_;
+};
+
+} // namespace tick_capture
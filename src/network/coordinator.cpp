@@ -1,10 +1,67 @@
 #include "coordinator.hpp"
+#include <algorithm>
+#include <charconv>
 #include <fmt/format.h>
+#include <unistd.h>
 
 namespace tick_capture {
 
+namespace {
+
+int64_t wall_clock_ns() {
+  using namespace std::chrono;
+  return duration_cast<nanoseconds>(system_clock::now().time_since_epoch())
+      .count();
+}
+
+// Value of a top-level "key": in a flat JSON message, without quotes
+std::string_view json_field(std::string_view msg, std::string_view key) {
+  const auto pattern = fmt::format("\"{}\":", key);
+  auto pos = msg.find(pattern);
+  if (pos == std::string_view::npos)
+    return {};
+  pos += pattern.size();
+  if (pos < msg.size() && msg[pos] == '"') {
+    const auto end = msg.find('"', ++pos);
+    return end == std::string_view::npos ? std::string_view{}
+                                         : msg.substr(pos, end - pos);
+  }
+  const auto end = msg.find_first_of(",}", pos);
+  return end == std::string_view::npos ? std::string_view{}
+                                       : msg.substr(pos, end - pos);
+}
+
+bool json_int(std::string_view msg, std::string_view key, int64_t &value) {
+  const auto field = json_field(msg, key);
+  const auto result =
+      std::from_chars(field.data(), field.data() + field.size(), value);
+  return !field.empty() && result.ec == std::errc{};
+}
+
+// Clock pongs go to one node, so they lead with its topic and the
+// publisher sends them there alone; everything else is a JSON object that
+// every peer subscribes to by its opening brace
+std::string pong_topic(std::string_view node) {
+  return fmt::format("pong:{}\n", node);
+}
+
+} // namespace
+
 Coordinator::Coordinator(const std::string &bind_address,
-                         const std::vector<std::string> &peer_addresses) {
+                         const std::vector<std::string> &peer_addresses,
+                         const std::string &node_id, EventLoop *events)
+    : node_id_(node_id), address_(bind_address), events_(events),
+      receive_buffer_(1024 * 1024) {
+  if (!events_) {
+    own_events_ = std::make_unique<EventLoop>("coordinator");
+    events_ = own_events_.get();
+  }
+  if (node_id_.empty()) {
+    char host[256] = {};
+    ::gethostname(host, sizeof(host) - 1);
+    node_id_ = fmt::format("{}/{}", host, bind_address);
+  }
+
   // Initialize ZMQ context
   context_ = zmq_ctx_new();
   if (!context_) {
@@ -33,8 +90,10 @@ Coordinator::Coordinator(const std::string &bind_address,
     throw std::runtime_error("Failed to create subscriber socket");
   }
 
-  // Subscribe to all messages
-  zmq_setsockopt(subscriber_, ZMQ_SUBSCRIBE, "", 0);
+  // Subscribe to broadcasts and to pongs answering our heartbeats
+  const std::string pongs = pong_topic(node_id_);
+  zmq_setsockopt(subscriber_, ZMQ_SUBSCRIBE, "{", 1);
+  zmq_setsockopt(subscriber_, ZMQ_SUBSCRIBE, pongs.data(), pongs.size());
 
   // Connect to peers
   for (const auto &addr : peer_addresses) {
@@ -61,8 +120,12 @@ void Coordinator::start() {
     return;
   running_ = true;
 
-  heartbeat_thread_ = std::thread([this] { run_heartbeat(); });
-  message_thread_ = std::thread([this] { handle_messages(); });
+  if (own_events_) {
+    own_events_->start();
+  }
+  events_->watch(subscriber_, [this] { receive_messages(); });
+  heartbeat_timer_ = events_->schedule_every(heartbeat_interval_,
+                                             [this] { send_heartbeat(); });
 }
 
 void Coordinator::stop() {
@@ -70,70 +133,109 @@ void Coordinator::stop() {
     return;
   running_ = false;
 
-  if (heartbeat_thread_.joinable())
-    heartbeat_thread_.join();
-  if (message_thread_.joinable())
-    message_thread_.join();
+  events_->cancel(heartbeat_timer_);
+  events_->unwatch(subscriber_);
+  // Health timers take nodes_mutex_, so they are cancelled without it
+  std::vector<EventLoop::Handle> timers;
+  {
+    std::lock_guard<std::mutex> lock(nodes_mutex_);
+    for (const auto &[node, timer] : health_timers_) {
+      timers.push_back(timer);
+    }
+    health_timers_.clear();
+  }
+  for (const auto &timer : timers) {
+    events_->cancel(timer);
+  }
+  if (own_events_) {
+    own_events_->stop();
+  }
+}
+
+void Coordinator::send_heartbeat() {
+  // The timestamp is t1 of the clock exchange peers answer with
+  std::lock_guard<std::mutex> lock(publisher_mutex_);
+  const std::string heartbeat = fmt::format(
+      R"({{"type":"heartbeat","node":"{}","address":"{}",)"
+      R"("timestamp":{}}})",
+      node_id_, address_, wall_clock_ns());
+  zmq_send(publisher_, heartbeat.data(), heartbeat.size(), 0);
 }
 
-void Coordinator::run_heartbeat() {
-  using namespace std::chrono;
-  auto next_heartbeat = system_clock::now();
-
-  while (running_) {
-    // Create heartbeat message
-    std::string heartbeat =
-        fmt::format(R"({{"type":"heartbeat","timestamp":{}}})",
-                    system_clock::now().time_since_epoch().count());
-
-    // Send heartbeat
-    zmq_send(publisher_, heartbeat.data(), heartbeat.size(), 0);
-
-    // Schedule next heartbeat
-    next_heartbeat += heartbeat_interval_;
-    std::this_thread::sleep_until(next_heartbeat);
-  }
-}
-
-void Coordinator::handle_messages() {
-  zmq_pollitem_t items[] = {{subscriber_, 0, ZMQ_POLLIN, 0}};
-
-  // Buffer for receiving messages
-  std::vector<char> buffer(1024 * 1024); // 1MB buffer
-
-  while (running_) {
-    if (zmq_poll(items, 1, 100) > 0) { // 100ms timeout
-      if (items[0].revents & ZMQ_POLLIN) {
-        // Receive message
-        int size = zmq_recv(subscriber_, buffer.data(), buffer.size(), 0);
-        if (size > 0) {
-          // Process message
-          std::string_view msg(buffer.data(), size);
-
-          try {
-            if (msg.find("\"type\":\"status\"") != std::string_view::npos) {
-              std::lock_guard<std::mutex> lock(nodes_mutex_);
-              auto &node = nodes_["node1"]; // TODO: extract real address
-              node.last_heartbeat = std::chrono::system_clock::now();
-            }
-          } catch (const std::exception &e) {
-            fmt::print(stderr, "Error parsing message: {}\n", e.what());
-          }
-        }
+void Coordinator::receive_messages() {
+  // Bounded, so a chatty peer cannot hold up the loop's timers
+  for (int i = 0; i < kMaxMessagesPerWake; ++i) {
+    const int size = zmq_recv(subscriber_, receive_buffer_.data(),
+                              receive_buffer_.size(), ZMQ_DONTWAIT);
+    if (size < 0)
+      return;
+    // Read the clock before parsing, as t2 or t4 of an exchange
+    const int64_t received_ns = wall_clock_ns();
+    if (size > static_cast<int>(receive_buffer_.size())) {
+      fmt::print(stderr, "Dropped truncated message of {} bytes\n", size);
+    } else if (size > 0) {
+      try {
+        handle_message(std::string_view(receive_buffer_.data(), size),
+                       received_ns);
+      } catch (const std::exception &e) {
+        fmt::print(stderr, "Error parsing message: {}\n", e.what());
       }
     }
-
-    check_node_health();
   }
 }
 
-void Coordinator::check_node_health() {
-  using namespace std::chrono;
-  const auto now = system_clock::now();
+void Coordinator::handle_message(std::string_view msg, int64_t received_ns) {
+  if (msg.front() != '{') {
+    msg.remove_prefix(std::min(msg.find('\n'), msg.size() - 1) + 1);
+  }
+  const auto node = json_field(msg, "node");
+  if (node.empty() || node == node_id_) {
+    return; // Untagged, or our own looped back
+  }
+  const auto type = json_field(msg, "type");
 
-  std::lock_guard<std::mutex> lock(nodes_mutex_);
-  for (auto &[addr, node] : nodes_) {
-    node.is_healthy = (now - node.last_heartbeat) <= health_check_interval_;
+  if (type == "clock_pong") {
+    int64_t t1, t2, t3;
+    if (json_field(msg, "to") != node_id_ || !json_int(msg, "t1", t1) ||
+        !json_int(msg, "t2", t2) || !json_int(msg, "t3", t3)) {
+      return; // Answer to another node's heartbeat
+    }
+    std::lock_guard<std::mutex> lock(nodes_mutex_);
+    auto &filter = clocks_[std::string(node)];
+    if (filter.add(t1, t2, t3, received_ns)) {
+      nodes_[std::string(node)].clock = filter.estimate();
+    }
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(nodes_mutex_);
+    const std::string id(node);
+    auto &info = nodes_[id];
+    info.last_heartbeat = std::chrono::system_clock::now();
+    info.is_healthy = true;
+    if (type == "heartbeat") {
+      info.address = std::string(json_field(msg, "address"));
+    }
+
+    // Push the node's health deadline back, or arm one after it expired
+    auto &timer = health_timers_[id];
+    if (!events_->reschedule(timer, health_check_interval_)) {
+      timer = events_->schedule(health_check_interval_, [this, id] {
+        std::lock_guard<std::mutex> lock(nodes_mutex_);
+        nodes_[id].is_healthy = false;
+      });
+    }
+  }
+
+  int64_t t1;
+  if (type == "heartbeat" && json_int(msg, "timestamp", t1)) {
+    std::lock_guard<std::mutex> lock(publisher_mutex_);
+    const std::string pong = fmt::format(
+        R"({}{{"type":"clock_pong","node":"{}","to":"{}","t1":{},"t2":{},)"
+        R"("t3":{}}})",
+        pong_topic(node), node_id_, node, t1, received_ns, wall_clock_ns());
+    zmq_send(publisher_, pong.data(), pong.size(), 0);
   }
 }
 
@@ -143,8 +245,43 @@ Coordinator::get_node_status() const {
   return nodes_;
 }
 
+std::optional<ClockEstimate>
+Coordinator::clock_estimate(const std::string &node) const {
+  std::lock_guard<std::mutex> lock(nodes_mutex_);
+  const auto it = nodes_.find(node);
+  if (it == nodes_.end())
+    return std::nullopt;
+  return it->second.clock;
+}
+
+std::string Coordinator::clocks_json() const {
+  std::lock_guard<std::mutex> lock(nodes_mutex_);
+  std::string json = "{";
+  for (const auto &[node, info] : nodes_) {
+    if (!info.clock)
+      continue;
+    if (json.size() > 1)
+      json += ',';
+    json += fmt::format(
+        R"("{}":{{"offset_ns":{},"round_trip_ns":{},"jitter_ns":{}}})",
+        node, info.clock->offset.count(), info.clock->round_trip.count(),
+        info.clock->jitter.count());
+  }
+  json += '}';
+  return json;
+}
+
 void Coordinator::publish_status(const std::string &status) {
-  zmq_send(publisher_, status.data(), status.size(), 0);
+  auto tagged = status;
+  if (!tagged.empty() && tagged.front() == '{') {
+    tagged.insert(1, fmt::format(R"("node":"{}",)", node_id_));
+  }
+  send(tagged);
+}
+
+void Coordinator::send(const std::string &msg) {
+  std::lock_guard<std::mutex> lock(publisher_mutex_);
+  zmq_send(publisher_, msg.data(), msg.size(), 0);
 }
 
 } // namespace tick_capture
@@ -1,15 +1,35 @@
 #pragma once
 #include "../../include/tick_capture/types.hpp"
+#include "../events/event_loop.hpp"
+#include "clock_offset.hpp"
 #include <atomic>
 #include <chrono>
+#include <memory>
 #include <mutex>
-#include <thread>
+#include <optional>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 #include <zmq.h>
 
 namespace tick_capture {
 
+// Links a node to its peers: heartbeats and status go out on a PUB socket
+// bound to bind_address, and the peers' arrive on a SUB socket connected to
+// each of theirs. Every message carries the sender's node id.
+//
+// Heartbeats, incoming messages and health checks all run on an event loop,
+// the node's if one is given. Each peer has a health timer that its
+// messages push back, and that marks it unhealthy when it fires, so
+// tracking many quiet peers costs nothing until one goes silent.
+//
+// Each heartbeat also starts an NTP-style clock exchange: a peer answers it
+// with a clock_pong holding when it received the heartbeat and when it
+// replied, both by its own clock, sent under a topic only the heartbeat's
+// sender subscribes to, so the publisher drops it for every other peer.
+// The sender filters the exchanges into an estimate of that peer's clock
+// offset and round trip. Times reported by a peer can then be put on the
+// local clock before comparing latencies or ordering events across nodes.
 class Coordinator {
 public:
   struct NodeInfo {
@@ -17,10 +37,15 @@ public:
     CaptureStats stats;
     std::chrono::system_clock::time_point last_heartbeat;
     bool is_healthy{true};
+    std::optional<ClockEstimate> clock; // Once the peer has answered
   };
 
+  // node_id defaults to "<hostname>/<bind_address>", which is unique for
+  // several nodes on one host as long as their bind addresses differ.
+  // Without an event loop the coordinator runs one of its own.
   Coordinator(const std::string &bind_address,
-              const std::vector<std::string> &peer_addresses);
+              const std::vector<std::string> &peer_addresses,
+              const std::string &node_id = "", EventLoop *events = nullptr);
   ~Coordinator();
 
   // Non-copyable
@@ -34,24 +59,44 @@ public:
   // Get aggregated stats from all nodes
   std::unordered_map<std::string, NodeInfo> get_node_status() const;
 
-  // Publish node status
+  // Clock estimate of a peer, if it has answered a heartbeat
+  std::optional<ClockEstimate> clock_estimate(const std::string &node) const;
+
+  // Peers' clock estimates as a JSON object keyed by node id, e.g.
+  // {"b":{"offset_ns":-1200,"round_trip_ns":90000,"jitter_ns":300}}
+  std::string clocks_json() const;
+
+  // Publish node status, a JSON object, tagged with our node id
   void publish_status(const std::string &status);
 
+  const std::string &node_id() const { return node_id_; }
+
 private:
-  void run_heartbeat();
-  void handle_messages();
-  void check_node_health();
+  static constexpr int kMaxMessagesPerWake = 64;
 
+  void send_heartbeat();
+  void receive_messages();
+  void handle_message(std::string_view msg, int64_t received_ns);
+  void send(const std::string &msg);
+
+  std::string node_id_;
+  std::string address_;
   void *context_;
   void *publisher_;  // For broadcasting configs/commands
   void *subscriber_; // For receiving node status/heartbeats
+  std::mutex publisher_mutex_; // The loop and callers both send
+
+  EventLoop *events_;
+  std::unique_ptr<EventLoop> own_events_; // Without a node's loop
+  EventLoop::Handle heartbeat_timer_;
+  std::vector<char> receive_buffer_;
 
   std::unordered_map<std::string, NodeInfo> nodes_;
-  mutable std::mutex nodes_mutex_;
+  std::unordered_map<std::string, ClockOffsetFilter> clocks_;
+  std::unordered_map<std::string, EventLoop::Handle> health_timers_;
+  mutable std::mutex nodes_mutex_; // Guards the maps above
 
   std::atomic<bool> running_{false};
-  std::thread heartbeat_thread_;
-  std::thread message_thread_;
 
   // Configuration
   std::chrono::seconds heartbeat_interval_{1};
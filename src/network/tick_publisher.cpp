@@ -0,0 +1,314 @@
+#include "tick_publisher.hpp"
+#include "../metrics/thread_stats.hpp"
+#include "../metrics/tracer.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fmt/format.h>
+
+namespace tick_capture {
+
+TickPublisher::TickPublisher(const Config &config)
+    : config_(config), queue_(config.queue_size) {
+  context_ = zmq_ctx_new();
+  if (!context_) {
+    throw std::runtime_error("Failed to create ZMQ context");
+  }
+
+  router_ = zmq_socket(context_, ZMQ_ROUTER);
+  if (!router_) {
+    zmq_ctx_destroy(context_);
+    throw std::runtime_error("Failed to create publisher socket");
+  }
+
+  // Make a full subscriber queue visible (EAGAIN) so it can be conflated
+  // rather than have libzmq silently drop its messages
+  const int mandatory = 1;
+  const int linger = 0;
+  zmq_setsockopt(router_, ZMQ_ROUTER_MANDATORY, &mandatory, sizeof(mandatory));
+  zmq_setsockopt(router_, ZMQ_SNDHWM, &config_.send_hwm,
+                 sizeof(config_.send_hwm));
+  zmq_setsockopt(router_, ZMQ_LINGER, &linger, sizeof(linger));
+
+  if (zmq_bind(router_, config_.bind_address.c_str()) != 0) {
+    zmq_close(router_);
+    zmq_ctx_destroy(context_);
+    throw std::runtime_error(
+        fmt::format("Failed to bind tick publisher: {}", zmq_strerror(errno)));
+  }
+
+  batch_.reserve(config_.max_batch);
+}
+
+TickPublisher::~TickPublisher() {
+  stop();
+
+  if (router_)
+    zmq_close(router_);
+  if (context_)
+    zmq_ctx_destroy(context_);
+}
+
+void TickPublisher::start() {
+  if (running_)
+    return;
+  running_ = true;
+  publish_thread_ = std::thread([this] {
+    set_thread_name("publisher");
+    run();
+  });
+}
+
+void TickPublisher::stop() {
+  if (!running_)
+    return;
+  running_ = false;
+
+  if (publish_thread_.joinable())
+    publish_thread_.join();
+}
+
+size_t TickPublisher::publish(std::span<const MarketMessage> messages) {
+  size_t accepted = 0;
+  for (MarketMessage msg : messages) {
+    Tracer::strip(msg);
+    if (!queue_.try_push(msg)) {
+      break;
+    }
+    ++accepted;
+  }
+  if (accepted < messages.size()) {
+    queue_drops_.fetch_add(messages.size() - accepted,
+                           std::memory_order_relaxed);
+  }
+  return accepted;
+}
+
+std::string TickPublisher::topic(uint32_t symbol_id) {
+  const char bytes[4] = {static_cast<char>(symbol_id >> 24),
+                         static_cast<char>(symbol_id >> 16),
+                         static_cast<char>(symbol_id >> 8),
+                         static_cast<char>(symbol_id)};
+  return std::string(bytes, sizeof(bytes));
+}
+
+void TickPublisher::run() {
+  zmq_pollitem_t items[] = {{router_, 0, ZMQ_POLLIN, 0}};
+
+  while (running_) {
+    // Only new ticks are worth not sleeping for: a lagging subscriber that
+    // stopped reading is retried once per wait instead of in a busy loop
+    if (zmq_poll(items, 1, queue_.empty() ? 1 : 0) > 0 &&
+        (items[0].revents & ZMQ_POLLIN)) {
+      handle_control();
+    }
+
+    batch_.clear();
+    if (queue_.pop_bulk(std::back_inserter(batch_), config_.max_batch) > 0) {
+      fan_out(batch_);
+      ticks_published_.fetch_add(batch_.size(), std::memory_order_relaxed);
+    }
+
+    uint64_t lagging = 0;
+    for (auto it = subscribers_.begin(); it != subscribers_.end();) {
+      if (it->lagging && !flush_conflated(*it)) {
+        it = subscribers_.erase(it);
+        continue;
+      }
+      lagging += it->lagging ? 1 : 0;
+      ++it;
+    }
+    lagging_count_ = lagging;
+    subscriber_count_ = subscribers_.size();
+  }
+}
+
+void TickPublisher::handle_control() {
+  zmq_msg_t identity;
+  zmq_msg_init(&identity);
+
+  while (zmq_msg_recv(&identity, router_, ZMQ_DONTWAIT) >= 0) {
+    zmq_msg_t body;
+    zmq_msg_init(&body);
+    bool more = zmq_msg_more(&identity);
+    while (more && zmq_msg_recv(&body, router_, 0) >= 0) {
+      more = zmq_msg_more(&body);
+    }
+
+    const std::string id(static_cast<const char *>(zmq_msg_data(&identity)),
+                         zmq_msg_size(&identity));
+    const std::string command(static_cast<const char *>(zmq_msg_data(&body)),
+                              zmq_msg_size(&body));
+    zmq_msg_close(&body);
+
+    if (command.empty()) {
+      continue;
+    }
+
+    auto &subscriber = find_or_add(id);
+    const std::string prefix = command.substr(1);
+    auto &prefixes = subscriber.prefixes;
+    if (command[0] == 'S') {
+      if (std::find(prefixes.begin(), prefixes.end(), prefix) ==
+          prefixes.end()) {
+        prefixes.push_back(prefix);
+      }
+    } else if (command[0] == 'U') {
+      prefixes.erase(std::remove(prefixes.begin(), prefixes.end(), prefix),
+                     prefixes.end());
+    } else {
+      fmt::print(stderr, "Unknown publisher command: {}\n", command[0]);
+      continue;
+    }
+    rebuild_filter(subscriber);
+  }
+  zmq_msg_close(&identity);
+}
+
+TickPublisher::Subscriber &
+TickPublisher::find_or_add(const std::string &identity) {
+  for (auto &subscriber : subscribers_) {
+    if (subscriber.identity == identity) {
+      return subscriber;
+    }
+  }
+  Subscriber subscriber;
+  subscriber.identity = identity;
+  subscriber.wanted.assign(config_.max_symbol_id + 1, 0);
+  subscriber.outgoing.reserve(config_.max_batch);
+  subscribers_.push_back(std::move(subscriber));
+  return subscribers_.back();
+}
+
+void TickPublisher::rebuild_filter(Subscriber &subscriber) const {
+  std::fill(subscriber.wanted.begin(), subscriber.wanted.end(), 0);
+
+  // A prefix of n topic bytes selects a contiguous block of symbol ids
+  for (const auto &prefix : subscriber.prefixes) {
+    if (prefix.size() > 4) {
+      continue;
+    }
+    uint64_t first = 0;
+    for (unsigned char byte : prefix) {
+      first = (first << 8) | byte;
+    }
+    const unsigned shift = 8 * (4 - static_cast<unsigned>(prefix.size()));
+    first <<= shift;
+    const uint64_t last =
+        std::min<uint64_t>(first + (uint64_t{1} << shift) - 1,
+                           config_.max_symbol_id);
+    for (uint64_t id = first; id <= last; ++id) {
+      subscriber.wanted[id] = 1;
+    }
+  }
+}
+
+void TickPublisher::fan_out(std::span<const MarketMessage> messages) {
+  for (auto it = subscribers_.begin(); it != subscribers_.end();) {
+    auto &subscriber = *it;
+    subscriber.outgoing.clear();
+    for (const auto &msg : messages) {
+      if (msg.symbol_id < subscriber.wanted.size() &&
+          subscriber.wanted[msg.symbol_id]) {
+        subscriber.outgoing.push_back(msg);
+      }
+    }
+
+    bool gone = false;
+    if (!subscriber.outgoing.empty()) {
+      if (subscriber.lagging) {
+        for (const auto &msg : subscriber.outgoing) {
+          conflate(subscriber, msg);
+        }
+      } else {
+        switch (send(subscriber.identity, 'L', subscriber.outgoing)) {
+        case SendResult::Sent:
+          break;
+        case SendResult::WouldBlock:
+          // Queue is full: keep only the latest value per symbol from here
+          // until the subscriber has caught up
+          subscriber.lagging = true;
+          for (const auto &msg : subscriber.outgoing) {
+            conflate(subscriber, msg);
+          }
+          break;
+        case SendResult::Gone:
+          gone = true;
+          break;
+        }
+      }
+    }
+
+    if (gone) {
+      it = subscribers_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void TickPublisher::conflate(Subscriber &subscriber, const MarketMessage &msg) {
+  if (subscriber.latest.empty()) {
+    subscriber.latest.resize(config_.max_symbol_id + 1);
+    subscriber.dirty.assign(config_.max_symbol_id + 1, 0);
+  }
+  subscriber.latest[msg.symbol_id] = msg;
+  if (!subscriber.dirty[msg.symbol_id]) {
+    subscriber.dirty[msg.symbol_id] = 1;
+    subscriber.dirty_symbols.push_back(msg.symbol_id);
+  }
+  ticks_conflated_.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool TickPublisher::flush_conflated(Subscriber &subscriber) {
+  auto &snapshot = subscriber.outgoing;
+  snapshot.clear();
+  for (auto symbol_id : subscriber.dirty_symbols) {
+    snapshot.push_back(subscriber.latest[symbol_id]);
+  }
+
+  if (!snapshot.empty()) {
+    switch (send(subscriber.identity, 'C', snapshot)) {
+    case SendResult::Sent:
+      break;
+    case SendResult::WouldBlock:
+      return true;
+    case SendResult::Gone:
+      return false;
+    }
+  }
+
+  for (auto symbol_id : subscriber.dirty_symbols) {
+    subscriber.dirty[symbol_id] = 0;
+  }
+  subscriber.dirty_symbols.clear();
+  subscriber.lagging = false;
+  return true;
+}
+
+TickPublisher::SendResult
+TickPublisher::send(const std::string &identity, char kind,
+                    std::span<const MarketMessage> messages) {
+  if (zmq_send(router_, identity.data(), identity.size(),
+               ZMQ_SNDMORE | ZMQ_DONTWAIT) < 0) {
+    return errno == EAGAIN ? SendResult::WouldBlock : SendResult::Gone;
+  }
+
+  // Once the first frame is accepted the rest of the message is too
+  zmq_send(router_, &kind, 1, ZMQ_SNDMORE | ZMQ_DONTWAIT);
+  zmq_send(router_, messages.data(), messages.size_bytes(), ZMQ_DONTWAIT);
+  messages_sent_.fetch_add(1, std::memory_order_relaxed);
+  return SendResult::Sent;
+}
+
+TickPublisher::Stats TickPublisher::get_stats() const {
+  Stats stats;
+  stats.ticks_published = ticks_published_.load();
+  stats.queue_drops = queue_drops_.load();
+  stats.messages_sent = messages_sent_.load();
+  stats.ticks_conflated = ticks_conflated_.load();
+  stats.subscribers = subscriber_count_.load();
+  stats.lagging_subscribers = lagging_count_.load();
+  return stats;
+}
+
+} // namespace tick_capture
@@ -0,0 +1,113 @@
+#pragma once
+#include "../../include/tick_capture/types.hpp"
+#include "../capture/ring_buffer.hpp"
+#include <atomic>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+#include <zmq.h>
+
+namespace tick_capture {
+
+// Fans captured ticks out to downstream subscribers over ZeroMQ.
+//
+// Subscribers connect a DEALER socket to the publisher's ROUTER and send
+// control frames: "S<topic prefix>" subscribes, "U<topic prefix>"
+// unsubscribes. A tick's topic is its symbol_id as 4 big-endian bytes, so
+// an empty prefix selects everything, a 4-byte prefix one symbol and shorter
+// prefixes a block of ids, as with ZMQ SUB filters. Prefixes are expanded
+// into a per-symbol table when they change, so filtering costs one lookup
+// per tick.
+//
+// Ticks arrive as two frames, [kind][MarketMessage array], where kind is
+// "L" for a live batch of consecutive ticks and "C" for a conflated
+// snapshot holding only the latest tick per symbol. A subscriber whose
+// queue is full is switched to conflation until it catches up; other
+// subscribers are unaffected.
+class TickPublisher {
+public:
+  struct Config {
+    std::string bind_address;
+    size_t queue_size{65536}; // Ticks buffered between capture and publisher
+    size_t max_batch{512};    // Ticks per zmq message
+    int send_hwm{1000};       // Messages queued per subscriber
+    uint32_t max_symbol_id{kDefaultMaxSymbolId};
+  };
+
+  struct Stats {
+    uint64_t ticks_published{0};
+    uint64_t queue_drops{0}; // Ticks not accepted because the queue was full
+    uint64_t messages_sent{0};
+    uint64_t ticks_conflated{0};
+    uint64_t subscribers{0};
+    uint64_t lagging_subscribers{0};
+  };
+
+  explicit TickPublisher(const Config &config);
+  ~TickPublisher();
+
+  // Non-copyable
+  TickPublisher(const TickPublisher &) = delete;
+  TickPublisher &operator=(const TickPublisher &) = delete;
+
+  void start();
+  void stop();
+
+  // Queue ticks for publication. Called from the processing thread only;
+  // never blocks, and drops what does not fit.
+  size_t publish(std::span<const MarketMessage> messages);
+
+  Stats get_stats() const;
+
+  // Topic bytes for a symbol
+  static std::string topic(uint32_t symbol_id);
+
+private:
+  struct Subscriber {
+    std::string identity;
+    std::vector<std::string> prefixes;
+    std::vector<uint8_t> wanted; // Indexed by symbol_id
+
+    std::vector<MarketMessage> outgoing; // Live batch being built
+
+    // Conflation state, allocated the first time the subscriber lags
+    bool lagging{false};
+    std::vector<MarketMessage> latest;
+    std::vector<uint8_t> dirty;
+    std::vector<uint32_t> dirty_symbols;
+  };
+
+  enum class SendResult { Sent, WouldBlock, Gone };
+
+  void run();
+  void handle_control();
+  Subscriber &find_or_add(const std::string &identity);
+  void rebuild_filter(Subscriber &subscriber) const;
+  void fan_out(std::span<const MarketMessage> messages);
+  void conflate(Subscriber &subscriber, const MarketMessage &msg);
+  bool flush_conflated(Subscriber &subscriber);
+  SendResult send(const std::string &identity, char kind,
+                  std::span<const MarketMessage> messages);
+
+  Config config_;
+  void *context_;
+  void *router_;
+
+  std::atomic<bool> running_{false};
+  std::thread publish_thread_;
+
+  RingBuffer<MarketMessage> queue_;
+  std::vector<MarketMessage> batch_;
+  std::vector<Subscriber> subscribers_;
+
+  // Statistics
+  std::atomic<uint64_t> ticks_published_{0};
+  std::atomic<uint64_t> queue_drops_{0};
+  std::atomic<uint64_t> messages_sent_{0};
+  std::atomic<uint64_t> ticks_conflated_{0};
+  std::atomic<uint64_t> subscriber_count_{0};
+  std::atomic<uint64_t> lagging_count_{0};
+};
+
+} // namespace tick_capture
@@ -1,123 +1,544 @@
 #include "capture_node.hpp"
+#include "../capture/batch_sizer.hpp"
+#include "../metrics/thread_stats.hpp"
+#include <algorithm>
 #include <fmt/format.h>
+#include <sys/socket.h>
+#include <unistd.h>
 
 namespace tick_capture {
 
-CaptureNode::CaptureNode(const CaptureConfig &config)
-    : config_(config), capture_(std::make_unique<PacketCapture>(config)),
-      storage_(std::make_unique<TickStorage>(config.output_dir)) {
+CaptureNode::CaptureNode(const CaptureConfig &config) : config_(config) {
+  // Take over from a running node before binding anything it still holds
+  int socket_fd = -1;
+  if (!config.handover_path.empty()) {
+    socket_fd = take_over();
+  }
+
+  if (config.trace_sample_every > 0) {
+    tracer_ = std::make_unique<Tracer>(config.trace_sample_every);
+    process_trace_ring_ = &tracer_->add_thread("process");
+  }
+
+  capture_ = std::make_unique<PacketCapture>(config, socket_fd);
+  capture_->set_tracer(tracer_.get());
+  storage_ = std::make_unique<TickStorage>(
+      config.output_dir, socket_fd >= 0, config.max_symbol_id,
+      SessionMeta::from_config(config, capture_->symbol_master()),
+      config.flush_interval);
+  detector_ = AnomalyDetector::create(config, &metrics_);
+  if (config.stall_threshold.count() > 0) {
+    Watchdog::Config watchdog_config;
+    watchdog_config.stall_threshold = config.stall_threshold;
+    watchdog_ = std::make_unique<Watchdog>(watchdog_config, metrics_);
+  }
+  if (config.scrub_bytes_per_sec > 0) {
+    Scrubber::Config scrub_config;
+    scrub_config.directories = {config.output_dir};
+    scrub_config.bytes_per_second = config.scrub_bytes_per_sec;
+    scrub_config.pass_interval = config.scrub_interval;
+    scrub_config.quarantine = config.scrub_quarantine;
+    scrubber_ = std::make_unique<Scrubber>(scrub_config, &metrics_);
+  }
+  events_ = std::make_unique<EventLoop>();
+  create_services();
+}
 
+void CaptureNode::create_services() {
   // Only create coordinator if we're in distributed mode
-  if (!config.coordinator_address.empty()) {
-    coordinator_ = std::make_unique<Coordinator>(config.coordinator_address,
-                                                 config.peer_addresses);
+  if (!config_.coordinator_address.empty()) {
+    coordinator_ = std::make_unique<Coordinator>(
+        config_.coordinator_address, config_.peer_addresses, config_.node_id,
+        events_.get());
+  }
+
+  // Only serve replays if an address is configured
+  if (!config_.replay_address.empty()) {
+    ReplayServer::Config replay_config;
+    replay_config.bind_address = config_.replay_address;
+    replay_config.data_dir = config_.output_dir;
+    replay_ = std::make_unique<ReplayServer>(replay_config);
+  }
+
+  // Only distribute live ticks if an address is configured
+  if (!config_.publish_address.empty()) {
+    TickPublisher::Config publish_config;
+    publish_config.bind_address = config_.publish_address;
+    publish_config.max_symbol_id = config_.max_symbol_id;
+    publisher_ = std::make_unique<TickPublisher>(publish_config);
+  }
+
+  if (!config_.replicate_address.empty()) {
+    SegmentShipper::Config ship_config;
+    ship_config.peer_address = config_.replicate_address;
+    const auto name =
+        !config_.replicate_name.empty()
+            ? config_.replicate_name
+            : std::filesystem::path(config_.output_dir).filename().string();
+    ship_config.sources = {{name.empty() ? "capture" : name,
+                            config_.output_dir}};
+    ship_config.ship_unsealed = config_.replicate_unsealed;
+    ship_config.bytes_per_second = config_.replicate_bytes_per_sec;
+    shipper_ = std::make_unique<SegmentShipper>(ship_config, &metrics_);
+  }
+  if (!config_.replica_address.empty()) {
+    ReplicaReceiver::Config replica_config;
+    replica_config.bind_address = config_.replica_address;
+    replica_config.directory = config_.replica_dir;
+    replica_ = std::make_unique<ReplicaReceiver>(replica_config, &metrics_);
   }
 }
 
 CaptureNode::~CaptureNode() { stop(); }
 
 void CaptureNode::start() {
-  if (running_)
+  if (running_ || handed_over_)
     return;
   running_ = true;
+  draining_ = false;
+  start_workers();
+
+  // Listen for a successor once we are capturing
+  if (!config_.handover_path.empty() && !listener_) {
+    listener_ = std::make_unique<HandoverListener>(
+        config_.handover_path, [this](int fd) { hand_over(fd); });
+    listener_->start();
+  }
+}
 
+void CaptureNode::start_workers() {
   // Start capture
   capture_->start();
+  events_->start();
 
   // Start coordinator if in distributed mode
   if (coordinator_) {
     coordinator_->start();
   }
 
+  if (replay_) {
+    replay_->start();
+  }
+  if (publisher_) {
+    publisher_->start();
+  }
+  if (shipper_) {
+    shipper_->start();
+  }
+  if (replica_) {
+    replica_->start();
+  }
+
   // Start processing thread
-  process_thread_ = std::thread([this] { process_messages(); });
+  process_thread_ = std::thread([this] {
+    set_thread_name("process");
+    process_messages();
+  });
 
-  // Start stats reporting thread
-  stats_thread_ = std::thread([this] { report_stats(); });
+  stats_timer_ = events_->schedule_every(std::chrono::seconds(1),
+                                         [this] { report_stats(); });
+
+  if (watchdog_) {
+    watchdog_->watch("capture", capture_->heartbeat());
+    if (const Heartbeat *decode = capture_->decode_heartbeat())
+      watchdog_->watch("decode", *decode);
+    watchdog_->watch("process", process_heartbeat_);
+    watchdog_->start();
+  }
+  if (scrubber_) {
+    scrubber_->start();
+  }
 }
 
 void CaptureNode::stop() {
+  // Waits for a handover in progress; after one there is nothing left to stop
+  if (listener_) {
+    listener_->stop();
+  }
+
   if (!running_)
     return;
-  running_ = false;
 
+  // Threads stop beating from here on
+  if (watchdog_) {
+    watchdog_->stop();
+  }
+  if (scrubber_) {
+    scrubber_->stop();
+  }
+
+  // Stop producing first; the processing thread keeps consuming meanwhile
   capture_->stop();
+  drain_start_ = std::chrono::steady_clock::now();
+  drain_processed_ = messages_processed_.load();
   if (coordinator_) {
     coordinator_->stop();
   }
+  if (replay_) {
+    replay_->stop();
+  }
+  if (shipper_) {
+    shipper_->stop();
+  }
+  if (replica_) {
+    replica_->stop();
+  }
+
+  // The processing thread empties the ring before it exits
+  draining_ = true;
+  stop_workers();
+  if (publisher_) {
+    publisher_->stop();
+  }
 
+  // Flush storage and checksum the last partial blocks
+  storage_->seal();
+
+  fmt::print("Drained {} ticks in {:.1f} ms, abandoned {}\n",
+             drain_stats_.drained,
+             static_cast<double>(drain_stats_.duration.count()) / 1e6,
+             drain_stats_.abandoned);
+}
+
+void CaptureNode::stop_workers() {
+  running_ = false;
   if (process_thread_.joinable())
     process_thread_.join();
-  if (stats_thread_.joinable())
-    stats_thread_.join();
 
-  // Flush storage
-  storage_->flush();
+  events_->cancel(stats_timer_);
+  events_->stop();
+}
+
+int CaptureNode::take_over() {
+  const int connection_fd = connect_handover(config_.handover_path);
+  if (connection_fd < 0) {
+    return -1; // No predecessor, start fresh
+  }
+
+  fmt::print("Taking over from node at {}\n", config_.handover_path);
+  HandoverState state;
+  try {
+    // Blocks until the predecessor has stopped and released its ports
+    state = receive_handover(connection_fd);
+    handover_ring_ =
+        std::make_unique<ShmRing>(ShmRing::open(state.ring_name));
+    acknowledge_handover(connection_fd);
+  } catch (...) {
+    // The predecessor keeps the ring and the socket
+    handover_ring_.reset();
+    if (state.socket_fd >= 0)
+      ::close(state.socket_fd);
+    ::close(connection_fd);
+    throw;
+  }
+  ::close(connection_fd);
+
+  last_sequence_ = state.last_sequence;
+  fmt::print("Took over capture at sequence {} with {} ticks in flight\n",
+             state.last_sequence, state.ticks_in_ring);
+  return state.socket_fd;
+}
+
+void CaptureNode::hand_over(int connection_fd) {
+  // Stop reading; from here packets queue in the kernel socket buffer
+  if (watchdog_) {
+    watchdog_->stop();
+  }
+  if (scrubber_) {
+    scrubber_->stop();
+  }
+  const int socket_fd = capture_->release_socket();
+  stop_workers();
+
+  std::unique_ptr<ShmRing> ring;
+  HandoverState state;
+  try {
+    // Free the service ports so the successor can bind them
+    coordinator_.reset();
+    replay_.reset();
+    publisher_.reset();
+    shipper_.reset();
+    replica_.reset();
+
+    // Move every tick not yet stored into shared memory, oldest first
+    auto &buffer = capture_->get_buffer();
+    const size_t in_flight =
+        buffer.size() + (handover_ring_ ? handover_ring_->size() : 0);
+    ring = std::make_unique<ShmRing>(ShmRing::create(
+        fmt::format("/tick_capture_handover_{}", ::getpid()), in_flight + 1));
+
+    MarketMessage msg;
+    if (handover_ring_) {
+      while (handover_ring_->try_pop(msg))
+        ring->try_push(msg);
+      handover_ring_.reset();
+    }
+    while (auto item = buffer.try_pop())
+      ring->try_push(*item);
+    ring->close();
+    // The successor appends to the files, starting new checksum blocks
+    storage_->seal();
+
+    state.socket_fd = socket_fd;
+    state.ring_name = ring->name();
+    state.last_sequence = last_sequence_.load();
+    state.ticks_in_ring = ring->size();
+
+    if (!send_handover(connection_fd, state, std::chrono::seconds(5)) &&
+        !revoke_handover(connection_fd)) {
+      throw std::runtime_error("Successor did not acknowledge handover");
+    }
+  } catch (...) {
+    // A successor acking from here on fails and gives up
+    ::shutdown(connection_fd, SHUT_RDWR);
+    resume_capture(socket_fd, std::move(ring));
+    throw;
+  }
+
+  // The successor holds its own descriptor now
+  ::close(socket_fd);
+  handed_over_ = true;
+  fmt::print("Handed over at sequence {} with {} ticks in flight\n",
+             state.last_sequence, state.ticks_in_ring);
+}
+
+void CaptureNode::resume_capture(int socket_fd,
+                                 std::unique_ptr<ShmRing> ring) {
+  try {
+    // Ticks not yet moved to the ring carry over to the new capture
+    auto capture = std::make_unique<PacketCapture>(config_, socket_fd);
+    auto &buffer = capture->get_buffer();
+    while (auto item = capture_->get_buffer().try_pop())
+      buffer.try_push(*item);
+    capture_ = std::move(capture);
+    capture_->set_tracer(tracer_.get());
+    if (ring)
+      handover_ring_ = std::move(ring);
+
+    create_services();
+    running_ = true;
+    start_workers();
+  } catch (const std::exception &e) {
+    throw std::runtime_error(
+        fmt::format("Capture could not resume after handover: {}", e.what()));
+  }
 }
 
 void CaptureNode::process_messages() {
-  constexpr size_t batch_size = 32;
+  auto &buffer = capture_->get_buffer();
+  AdaptiveBatchSizer sizer(config_.min_batch_size, config_.max_batch_size,
+                           buffer.capacity());
+  auto &occupancy_histogram = metrics_.histogram("process.ring_occupancy");
+  auto &batch_histogram = metrics_.histogram("process.batch_size");
+  // Wire timestamp to processing, when the feed stamps messages
+  auto *latency_histogram = config_.enable_timestamps
+                                ? &metrics_.histogram("process.latency_ns")
+                                : nullptr;
+
   std::vector<MarketMessage> batch;
-  batch.reserve(batch_size);
+  batch.reserve(std::max<size_t>(config_.max_batch_size, 1));
 
-  while (running_) {
-    auto &buffer = capture_->get_buffer();
+  // Ticks a predecessor had not stored come before anything we capture
+  if (handover_ring_) {
+    MarketMessage msg;
+    while (running_ && handover_ring_->try_pop(msg)) {
+      store_message(msg);
+    }
+    if (handover_ring_->size() == 0) {
+      handover_ring_.reset();
+    }
+  }
 
-    // Process messages in batches
+  while (running_) {
+    // Size the batch to the backlog: small while keeping up, larger as the
+    // ring fills
+    const size_t occupancy = buffer.size();
+    const size_t batch_size = sizer.next(occupancy);
     const size_t processed =
         buffer.pop_bulk(std::back_inserter(batch), batch_size);
+    sizer.record(processed);
+    process_heartbeat_.beat(processed);
 
     if (processed > 0) {
+      occupancy_histogram.record(occupancy);
+      batch_histogram.record(batch_size);
+      if (latency_histogram) {
+        const auto now = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now().time_since_epoch())
+                .count());
+        for (const auto &msg : batch) {
+          latency_histogram->record(now > msg.timestamp ? now - msg.timestamp
+                                                        : 0);
+        }
+      }
+      if (tracer_) {
+        Tracer::record(batch, *process_trace_ring_, TraceStage::Dequeue);
+      }
+
       // Process each message in the batch
       for (const auto &msg : batch) {
-        // Check for sequence gaps
-        uint64_t last_seq = last_sequence_.load();
-        if (last_seq > 0 && msg.sequence_number > last_seq + 1) {
-          fmt::print("Sequence gap: {} -> {}\n", last_seq, msg.sequence_number);
-        }
-        last_sequence_.store(msg.sequence_number);
+        store_message(msg);
+      }
 
-        // Store the message
-        storage_->store(msg);
-        messages_processed_.fetch_add(1, std::memory_order_relaxed);
+      // Hand the batch to the distribution bus; this never blocks
+      if (publisher_) {
+        publisher_->publish(batch);
+        if (tracer_) {
+          Tracer::record(batch, *process_trace_ring_, TraceStage::Publish);
+        }
       }
+    }
 
-      batch.clear();
+    if (detector_) {
+      const auto now = static_cast<uint64_t>(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(
+              std::chrono::steady_clock::now().time_since_epoch())
+              .count());
+      detector_->observe(batch, now);
+      detector_->check_stale(now);
     }
+    batch.clear();
+    storage_->flush_due();
 
     // Small sleep if no messages to prevent busy-waiting
     if (processed == 0) {
       std::this_thread::sleep_for(std::chrono::microseconds(100));
     }
   }
+
+  if (draining_) {
+    drain();
+  }
 }
 
-void CaptureNode::report_stats() {
+void CaptureNode::drain() {
   using namespace std::chrono;
-  auto next_report = system_clock::now();
+  const auto deadline = drain_start_ + config_.drain_timeout;
 
-  while (running_) {
-    auto stats = get_stats();
+  // Capture has stopped, so the ring only shrinks; store it in large
+  // batches without sleeping until it is empty or the deadline passes
+  auto &buffer = capture_->get_buffer();
+  const size_t batch_size = std::max<size_t>(config_.max_batch_size, 1);
+  std::vector<MarketMessage> batch;
+  batch.reserve(batch_size);
+
+  while (steady_clock::now() < deadline) {
+    // A predecessor's ticks still come first
+    MarketMessage msg;
+    while (handover_ring_ && batch.size() < batch_size &&
+           handover_ring_->try_pop(msg)) {
+      batch.push_back(msg);
+    }
+    if (batch.empty()) {
+      buffer.pop_bulk(std::back_inserter(batch), batch_size);
+    }
+    if (batch.empty()) {
+      break;
+    }
+
+    for (const auto &m : batch) {
+      store_message(m);
+    }
+    if (publisher_) {
+      publisher_->publish(batch);
+    }
+    batch.clear();
+  }
 
-    // Print local stats
-    fmt::print(
-        "Messages - Received: {} Processed: {} Dropped: {} Rate: {:.2f}k/s\n",
+  // Counted from capture stopping, so ticks the main loop stored before
+  // it saw running_ drop are included
+  DrainStats stats;
+  stats.drained = messages_processed_.load() - drain_processed_;
+  stats.abandoned =
+      buffer.size() + (handover_ring_ ? handover_ring_->size() : 0);
+  stats.deadline_hit = stats.abandoned > 0;
+  stats.duration =
+      duration_cast<nanoseconds>(steady_clock::now() - drain_start_);
+  drain_stats_ = stats;
+}
+
+void CaptureNode::store_message(const MarketMessage &msg) {
+  // Check for sequence gaps
+  uint64_t last_seq = last_sequence_.load();
+  if (last_seq > 0 && msg.sequence_number > last_seq + 1) {
+    fmt::print("Sequence gap: {} -> {}\n", last_seq, msg.sequence_number);
+  }
+  last_sequence_.store(msg.sequence_number);
+
+  // Store the message
+  storage_->store(msg);
+  messages_processed_.fetch_add(1, std::memory_order_relaxed);
+
+  if (tracer_ && msg.reserved != 0) [[unlikely]] {
+    process_trace_ring_->record(msg, TraceStage::Store, CycleClock::now());
+  }
+}
+
+void CaptureNode::export_trace(const std::filesystem::path &path) const {
+  if (!tracer_) {
+    throw std::runtime_error("Tracing is disabled (trace_sample_every = 0)");
+  }
+  tracer_->export_chrome(path);
+}
+
+void CaptureNode::report_stats() {
+  auto stats = get_stats();
+
+  // Print local stats
+  fmt::print(
+      "Messages - Received: {} Processed: {} Dropped: {} Rate: {:.2f}k/s\n",
+      stats.messages_received, stats.messages_processed,
+      stats.messages_dropped,
+      static_cast<double>(stats.messages_processed) / 1000.0);
+
+  // Report to coordinator if in distributed mode
+  if (coordinator_) {
+    std::string status = fmt::format(
+        R"({{"type":"status","stats":{{"received":{},"processed":{},)"
+        R"("dropped":{}}},"metrics":{},"clocks":{}}})",
         stats.messages_received, stats.messages_processed,
-        stats.messages_dropped,
-        static_cast<double>(stats.messages_processed) / 1000.0);
-
-    // Report to coordinator if in distributed mode
-    if (coordinator_) {
-      std::string status = fmt::format(
-          R"({{"type":"status","stats":{{"received":{},"processed":{},"dropped":{}}}}})",
-          stats.messages_received, stats.messages_processed,
-          stats.messages_dropped);
-      coordinator_->publish_status(status);
+        stats.messages_dropped, metrics_.to_json(),
+        coordinator_->clocks_json());
+    coordinator_->publish_status(status);
+  }
+  publish_alerts();
+}
+
+void CaptureNode::publish_alerts() {
+  // Stalls are printed as the watchdog detects them
+  if (watchdog_) {
+    for (const auto &event : watchdog_->take_events()) {
+      if (coordinator_) {
+        coordinator_->publish_status(event.to_json());
+      }
+    }
+  }
+
+  // Corrupt blocks are printed as the scrubber finds them
+  if (scrubber_) {
+    for (const auto &corruption : scrubber_->take_corruptions()) {
+      if (coordinator_) {
+        coordinator_->publish_status(corruption.to_json());
+      }
     }
+  }
 
-    // Schedule next report
-    next_report += seconds(1);
-    std::this_thread::sleep_until(next_report);
+  if (!detector_) {
+    return;
+  }
+  const auto alerts = detector_->take_alerts();
+  if (alerts.empty()) {
+    return;
+  }
+
+  const auto stats = detector_->get_stats();
+  fmt::print("Anomalies - New alerts: {} Jumps: {} Stale symbols: {}\n",
+             alerts.size(), stats.jumps, stats.stale_symbols);
+  if (coordinator_) {
+    for (const auto &alert : alerts) {
+      coordinator_->publish_status(alert.to_json());
+    }
   }
 }
 
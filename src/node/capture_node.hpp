@@ -1,8 +1,20 @@
 #pragma once
 #include "../../include/tick_capture/types.hpp"
 #include "../capture/packet_capture.hpp"
+#include "../capture/shm_ring.hpp"
+#include "../events/event_loop.hpp"
+#include "../metrics/anomaly_detector.hpp"
+#include "../metrics/metrics_registry.hpp"
+#include "../metrics/tracer.hpp"
+#include "../metrics/watchdog.hpp"
 #include "../network/coordinator.hpp"
+#include "../network/tick_publisher.hpp"
+#include "../replay/replay_server.hpp"
+#include "../replication/replica_receiver.hpp"
+#include "../replication/segment_shipper.hpp"
+#include "../storage/scrubber.hpp"
 #include "../storage/tick_storage.hpp"
+#include "handover.hpp"
 
 namespace tick_capture {
 
@@ -18,19 +30,77 @@ public:
   // Get node statistics
   CaptureStats get_stats() const;
 
+  // Outcome of the drain phase of the last stop()
+  struct DrainStats {
+    uint64_t drained{0};   // Ticks stored after capture stopped
+    uint64_t abandoned{0}; // Ticks left unstored at the deadline
+    std::chrono::nanoseconds duration{0}; // From capture stopping
+    bool deadline_hit{false};             // Stopped with ticks left
+  };
+  DrainStats get_drain_stats() const { return drain_stats_; }
+
+  // True once a successor process has taken over capture
+  bool handed_over() const { return handed_over_; }
+
+  MetricsRegistry &metrics() { return metrics_; }
+
+  // Most ticks queued in the capture ring since the last call
+  size_t take_ring_high_water() {
+    return capture_->get_buffer().take_high_water();
+  }
+
+  // Write the sampled stage traces held so far as Chrome trace JSON
+  void export_trace(const std::filesystem::path &path) const;
+
 private:
+  void create_services();
+  void start_workers();
+  void stop_workers();
   void process_messages();
+  void drain();
+  void store_message(const MarketMessage &msg);
   void report_stats();
+  void publish_alerts();
+
+  // Zero-downtime restart: take over from a running predecessor (returns
+  // its capture socket, or -1 if there is none), or hand over to a successor
+  int take_over();
+  void hand_over(int connection_fd);
+  // Capture again on a socket whose handover failed, with the ticks moved
+  // to ring, if it was made
+  void resume_capture(int socket_fd, std::unique_ptr<ShmRing> ring);
 
   CaptureConfig config_;
+  MetricsRegistry metrics_;
   std::unique_ptr<PacketCapture> capture_;
   std::unique_ptr<TickStorage> storage_;
+  std::unique_ptr<AnomalyDetector> detector_; // Optional
+  std::unique_ptr<Watchdog> watchdog_;        // Optional
+  std::unique_ptr<Tracer> tracer_;            // Optional
+  std::unique_ptr<Scrubber> scrubber_;        // Optional
+  TraceRing *process_trace_ring_{nullptr};
+  // Stats reports and the coordinator's heartbeats, messages and health
+  // checks
+  std::unique_ptr<EventLoop> events_;
+  EventLoop::Handle stats_timer_;
   std::unique_ptr<Coordinator> coordinator_;
+  std::unique_ptr<ReplayServer> replay_;
+  std::unique_ptr<TickPublisher> publisher_;
+  std::unique_ptr<SegmentShipper> shipper_;
+  std::unique_ptr<ReplicaReceiver> replica_;
+  std::unique_ptr<HandoverListener> listener_;
+  std::unique_ptr<ShmRing> handover_ring_; // Ticks in flight at takeover
 
   // Processing thread
   std::atomic<bool> running_{false};
+  std::atomic<bool> handed_over_{false};
+  std::atomic<bool> draining_{false}; // Drain the ring once running_ clears
   std::thread process_thread_;
-  std::thread stats_thread_;
+  Heartbeat process_heartbeat_;
+
+  DrainStats drain_stats_;
+  std::chrono::steady_clock::time_point drain_start_; // Capture stopped
+  uint64_t drain_processed_{0}; // messages_processed_ then
 
   // Statistics
   std::atomic<uint64_t> messages_processed_{0};
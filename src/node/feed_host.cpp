@@ -0,0 +1,358 @@
+#include "feed_host.hpp"
+#include "../metrics/thread_stats.hpp"
+#include <algorithm>
+#include <fmt/format.h>
+#include <unordered_set>
+
+namespace tick_capture {
+
+FeedHost::FeedHost(const Config &config) : config_(config) {
+  if (config_.feeds.empty()) {
+    throw std::runtime_error("FeedHost needs at least one feed");
+  }
+  config_.io_threads = std::max<size_t>(config_.io_threads, 1);
+  config_.defaults.max_batch_size =
+      std::max<size_t>(config_.defaults.max_batch_size, 1);
+
+  std::unordered_set<std::string> names;
+  for (const auto &feed : config_.feeds) {
+    if (feed.name.empty() || !names.insert(feed.name).second) {
+      throw std::runtime_error(
+          fmt::format("Feed names must be unique and non-empty: '{}'",
+                      feed.name));
+    }
+
+    CaptureConfig feed_config = config_.defaults;
+    feed_config.multicast_addr = feed.multicast_addr;
+    feed_config.port = feed.port;
+    feed_config.output_dir =
+        (std::filesystem::path(config_.defaults.output_dir) / feed.name)
+            .string();
+
+    auto pipeline = std::make_unique<Pipeline>();
+    pipeline->name = feed.name;
+    pipeline->capture = std::make_unique<PacketCapture>(feed_config);
+    pipeline->storage = std::make_unique<TickStorage>(
+        feed_config.output_dir, false, feed_config.max_symbol_id,
+        SessionMeta::from_config(feed_config,
+                                 pipeline->capture->symbol_master()),
+        feed_config.flush_interval);
+
+    const auto prefix = fmt::format("feed.{}.", feed.name);
+    pipeline->detector = AnomalyDetector::create(feed_config, &metrics_,
+                                                 prefix + "anomaly.");
+    pipeline->processed = &metrics_.counter(prefix + "processed");
+    pipeline->gaps = &metrics_.counter(prefix + "sequence_gaps");
+    pipeline->received = &metrics_.counter(prefix + "received");
+    pipeline->dropped = &metrics_.counter(prefix + "dropped");
+    pipeline->invalid = &metrics_.counter(prefix + "invalid");
+    pipelines_.push_back(std::move(pipeline));
+  }
+
+  // One coordinator link for the whole host
+  if (!config_.defaults.coordinator_address.empty()) {
+    coordinator_ = std::make_unique<Coordinator>(
+        config_.defaults.coordinator_address, config_.defaults.peer_addresses,
+        config_.defaults.node_id, &events_);
+  }
+
+  if (config_.defaults.stall_threshold.count() > 0) {
+    Watchdog::Config watchdog_config;
+    watchdog_config.stall_threshold = config_.defaults.stall_threshold;
+    watchdog_ = std::make_unique<Watchdog>(watchdog_config, metrics_);
+  }
+  if (config_.defaults.scrub_bytes_per_sec > 0) {
+    Scrubber::Config scrub_config;
+    for (const auto &feed : config_.feeds) {
+      scrub_config.directories.push_back(
+          std::filesystem::path(config_.defaults.output_dir) / feed.name);
+    }
+    scrub_config.bytes_per_second = config_.defaults.scrub_bytes_per_sec;
+    scrub_config.pass_interval = config_.defaults.scrub_interval;
+    scrub_config.quarantine = config_.defaults.scrub_quarantine;
+    scrubber_ = std::make_unique<Scrubber>(scrub_config, &metrics_);
+  }
+
+  // Each feed is replicated as "<replicate_name>/<feed>", or "<feed>"
+  const auto &defaults = config_.defaults;
+  if (!defaults.replicate_address.empty()) {
+    SegmentShipper::Config ship_config;
+    ship_config.peer_address = defaults.replicate_address;
+    for (const auto &feed : config_.feeds) {
+      ship_config.sources.push_back(
+          {defaults.replicate_name.empty()
+               ? feed.name
+               : defaults.replicate_name + "/" + feed.name,
+           std::filesystem::path(defaults.output_dir) / feed.name});
+    }
+    ship_config.ship_unsealed = defaults.replicate_unsealed;
+    ship_config.bytes_per_second = defaults.replicate_bytes_per_sec;
+    shipper_ = std::make_unique<SegmentShipper>(ship_config, &metrics_);
+  }
+  if (!defaults.replica_address.empty()) {
+    ReplicaReceiver::Config replica_config;
+    replica_config.bind_address = defaults.replica_address;
+    replica_config.directory = defaults.replica_dir;
+    replica_ = std::make_unique<ReplicaReceiver>(replica_config, &metrics_);
+  }
+  for (size_t i = 0; i < config_.io_threads; ++i) {
+    io_heartbeats_.push_back(std::make_unique<Heartbeat>());
+  }
+}
+
+FeedHost::~FeedHost() { stop(); }
+
+void FeedHost::start() {
+  if (running_)
+    return;
+  running_ = true;
+  draining_ = false;
+
+  for (auto &pipeline : pipelines_) {
+    pipeline->capture->start();
+  }
+  events_.start();
+  if (coordinator_) {
+    coordinator_->start();
+  }
+
+  for (size_t i = 0; i < config_.io_threads; ++i) {
+    io_threads_.emplace_back([this, i] {
+      set_thread_name(fmt::format("io-{}", i).c_str());
+      io_loop(*io_heartbeats_[i]);
+    });
+  }
+  stats_timer_ = events_.schedule_every(std::chrono::seconds(1),
+                                        [this] { report_stats(); });
+
+  if (watchdog_) {
+    for (const auto &pipeline : pipelines_) {
+      watchdog_->watch(pipeline->name + ".capture",
+                       pipeline->capture->heartbeat());
+      if (const Heartbeat *decode = pipeline->capture->decode_heartbeat())
+        watchdog_->watch(pipeline->name + ".decode", *decode);
+    }
+    for (size_t i = 0; i < io_heartbeats_.size(); ++i) {
+      watchdog_->watch(fmt::format("io.{}", i), *io_heartbeats_[i]);
+    }
+    watchdog_->start();
+  }
+  if (scrubber_) {
+    scrubber_->start();
+  }
+  if (shipper_) {
+    shipper_->start();
+  }
+  if (replica_) {
+    replica_->start();
+  }
+
+  fmt::print("Started {} feeds on {} I/O threads\n", pipelines_.size(),
+             config_.io_threads);
+}
+
+void FeedHost::stop() {
+  if (!running_)
+    return;
+
+  // Threads stop beating from here on
+  if (watchdog_) {
+    watchdog_->stop();
+  }
+  if (scrubber_) {
+    scrubber_->stop();
+  }
+  if (shipper_) {
+    shipper_->stop();
+  }
+  if (replica_) {
+    replica_->stop();
+  }
+
+  // Stop producing first, then let the I/O threads empty every ring
+  for (auto &pipeline : pipelines_) {
+    pipeline->capture->stop();
+  }
+  if (coordinator_) {
+    coordinator_->stop();
+  }
+
+  drain_deadline_ =
+      std::chrono::steady_clock::now() + config_.defaults.drain_timeout;
+  draining_ = true;
+  running_ = false;
+
+  for (auto &thread : io_threads_) {
+    if (thread.joinable())
+      thread.join();
+  }
+  io_threads_.clear();
+  events_.cancel(stats_timer_);
+  events_.stop();
+
+  size_t abandoned = 0;
+  for (auto &pipeline : pipelines_) {
+    abandoned += pipeline->capture->get_buffer().size();
+    pipeline->storage->seal();
+  }
+  update_metrics();
+  fmt::print("Stopped {} feeds, abandoned {} ticks\n", pipelines_.size(),
+             abandoned);
+}
+
+void FeedHost::io_loop(Heartbeat &heartbeat) {
+  const size_t feed_count = pipelines_.size();
+  std::vector<MarketMessage> batch;
+  batch.reserve(config_.defaults.max_batch_size);
+
+  while (true) {
+    const bool stopping = !running_;
+    if (stopping && (!draining_ ||
+                     std::chrono::steady_clock::now() >= drain_deadline_)) {
+      break;
+    }
+
+    // One round visits every feed once, starting wherever the shared cursor
+    // points so that threads spread out over the feeds
+    size_t stored = 0;
+    for (size_t i = 0; i < feed_count; ++i) {
+      const size_t index =
+          next_feed_.fetch_add(1, std::memory_order_relaxed) % feed_count;
+      stored += serve(*pipelines_[index], batch);
+    }
+    heartbeat.beat(stored);
+
+    if (stored == 0) {
+      // Captures have stopped when draining, so idle rings stay empty
+      if (stopping)
+        break;
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+  }
+}
+
+size_t FeedHost::serve(Pipeline &pipeline,
+                       std::vector<MarketMessage> &batch) {
+  // Another thread is serving this feed; move on rather than wait
+  bool expected = false;
+  if (!pipeline.busy.compare_exchange_strong(expected, true,
+                                             std::memory_order_acquire)) {
+    return 0;
+  }
+
+  const size_t count = pipeline.capture->get_buffer().pop_bulk(
+      std::back_inserter(batch), config_.defaults.max_batch_size);
+
+  for (const auto &msg : batch) {
+    // Sequence numbers are per feed
+    const uint64_t last_seq = pipeline.last_sequence.load();
+    if (last_seq > 0 && msg.sequence_number > last_seq + 1) {
+      fmt::print("Feed {} sequence gap: {} -> {}\n", pipeline.name, last_seq,
+                 msg.sequence_number);
+      pipeline.gaps->add();
+    }
+    pipeline.last_sequence.store(msg.sequence_number);
+
+    pipeline.storage->store(msg);
+  }
+  pipeline.processed->add(count);
+
+  // Visited even when idle, so a silent feed is still noticed
+  if (pipeline.detector) {
+    const auto now = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+    pipeline.detector->observe(batch, now);
+    pipeline.detector->check_stale(now);
+  }
+  batch.clear();
+  pipeline.storage->flush_due();
+
+  pipeline.busy.store(false, std::memory_order_release);
+  return count;
+}
+
+void FeedHost::report_stats() {
+  update_metrics();
+  for (const auto &pipeline : pipelines_) {
+    fmt::print("Feed {} - Received: {} Processed: {} Dropped: {} Gaps: {}\n",
+               pipeline->name, pipeline->received->value(),
+               pipeline->processed->value(), pipeline->dropped->value(),
+               pipeline->gaps->value());
+  }
+
+  if (coordinator_) {
+    coordinator_->publish_status(
+        fmt::format(R"({{"type":"status","metrics":{},"clocks":{}}})",
+                    metrics_.to_json(), coordinator_->clocks_json()));
+  }
+  for (auto &pipeline : pipelines_) {
+    if (pipeline->detector) {
+      publish_alerts(*pipeline);
+    }
+  }
+  if (watchdog_) {
+    // Stalls are printed as the watchdog detects them
+    for (const auto &event : watchdog_->take_events()) {
+      if (coordinator_) {
+        coordinator_->publish_status(event.to_json());
+      }
+    }
+  }
+  if (scrubber_) {
+    // Corrupt blocks are printed as the scrubber finds them
+    for (const auto &corruption : scrubber_->take_corruptions()) {
+      if (coordinator_) {
+        coordinator_->publish_status(corruption.to_json());
+      }
+    }
+  }
+}
+
+void FeedHost::update_metrics() {
+  // Mirror capture counters into the shared registry
+  for (const auto &pipeline : pipelines_) {
+    const auto stats = pipeline->capture->get_stats();
+    pipeline->received->set(stats.messages_received);
+    pipeline->dropped->set(stats.messages_dropped);
+    pipeline->invalid->set(stats.messages_invalid);
+  }
+}
+
+void FeedHost::publish_alerts(Pipeline &pipeline) {
+  const auto alerts = pipeline.detector->take_alerts();
+  if (alerts.empty()) {
+    return;
+  }
+
+  const auto stats = pipeline.detector->get_stats();
+  fmt::print("Feed {} anomalies - New alerts: {} Jumps: {} Stale symbols: "
+             "{}\n",
+             pipeline.name, alerts.size(), stats.jumps, stats.stale_symbols);
+  if (coordinator_) {
+    for (const auto &alert : alerts) {
+      // Tag each alert with its feed, as symbol ids are per feed
+      auto json = alert.to_json();
+      json.insert(1, fmt::format(R"("feed":"{}",)", pipeline.name));
+      coordinator_->publish_status(json);
+    }
+  }
+}
+
+std::vector<FeedHost::FeedStats> FeedHost::get_stats() const {
+  std::vector<FeedStats> result;
+  result.reserve(pipelines_.size());
+  for (const auto &pipeline : pipelines_) {
+    FeedStats stats;
+    stats.name = pipeline->name;
+    stats.capture = pipeline->capture->get_stats();
+    stats.capture.messages_processed = pipeline->processed->value();
+    stats.sequence_gaps = pipeline->gaps->value();
+    stats.last_sequence = pipeline->last_sequence.load();
+    result.push_back(std::move(stats));
+  }
+  return result;
+}
+
+} // namespace tick_capture
@@ -0,0 +1,105 @@
+#pragma once
+#include "../../include/tick_capture/types.hpp"
+#include "../capture/packet_capture.hpp"
+#include "../events/event_loop.hpp"
+#include "../metrics/anomaly_detector.hpp"
+#include "../metrics/metrics_registry.hpp"
+#include "../metrics/watchdog.hpp"
+#include "../network/coordinator.hpp"
+#include "../replication/replica_receiver.hpp"
+#include "../replication/segment_shipper.hpp"
+#include "../storage/scrubber.hpp"
+#include "../storage/tick_storage.hpp"
+
+namespace tick_capture {
+
+// Runs several independent feed pipelines in one process. Each feed has its
+// own capture socket, thread and ring, its own storage directory and its own
+// sequence tracking. A fixed pool of I/O threads stores ticks for all feeds,
+// and the metrics registry and coordinator link are shared.
+//
+// I/O threads visit feeds round-robin and store at most one quantum
+// (max_batch_size ticks) per visit. A busy feed therefore cannot starve a
+// quiet one, and each feed is served by at most one thread at a time, so
+// its ticks stay in order.
+class FeedHost {
+public:
+  struct Feed {
+    std::string name; // Also the storage subdirectory
+    std::string multicast_addr;
+    uint16_t port{0};
+  };
+
+  struct Config {
+    // Buffer sizes, batch size, drain deadline and output_dir shared by
+    // all feeds. Coordinator settings apply to the host as a whole.
+    CaptureConfig defaults;
+    std::vector<Feed> feeds;
+    size_t io_threads{2};
+  };
+
+  struct FeedStats {
+    std::string name;
+    CaptureStats capture;
+    uint64_t sequence_gaps{0};
+    uint64_t last_sequence{0};
+  };
+
+  explicit FeedHost(const Config &config);
+  ~FeedHost();
+
+  // Non-copyable
+  FeedHost(const FeedHost &) = delete;
+  FeedHost &operator=(const FeedHost &) = delete;
+
+  void start();
+  void stop();
+
+  std::vector<FeedStats> get_stats() const;
+  MetricsRegistry &metrics() { return metrics_; }
+
+private:
+  struct Pipeline {
+    std::string name;
+    std::unique_ptr<PacketCapture> capture;
+    std::unique_ptr<TickStorage> storage;
+    std::unique_ptr<AnomalyDetector> detector; // Optional
+
+    // Held by the I/O thread currently serving this feed
+    std::atomic<bool> busy{false};
+    std::atomic<uint64_t> last_sequence{0};
+
+    MetricsRegistry::Counter *processed{nullptr};
+    MetricsRegistry::Counter *gaps{nullptr};
+    MetricsRegistry::Counter *received{nullptr};
+    MetricsRegistry::Counter *dropped{nullptr};
+    MetricsRegistry::Counter *invalid{nullptr};
+  };
+
+  void io_loop(Heartbeat &heartbeat);
+  size_t serve(Pipeline &pipeline, std::vector<MarketMessage> &batch);
+  void report_stats();
+  void update_metrics();
+  void publish_alerts(Pipeline &pipeline);
+
+  Config config_;
+  MetricsRegistry metrics_;
+  std::vector<std::unique_ptr<Pipeline>> pipelines_;
+  EventLoop events_; // Stats reports and the coordinator
+  EventLoop::Handle stats_timer_;
+  std::unique_ptr<Coordinator> coordinator_;
+  std::unique_ptr<Watchdog> watchdog_;       // Optional
+  std::unique_ptr<Scrubber> scrubber_;       // Optional, over every feed
+  std::unique_ptr<SegmentShipper> shipper_;  // Optional, ships every feed
+  std::unique_ptr<ReplicaReceiver> replica_; // Optional
+
+  std::atomic<bool> running_{false};
+  std::atomic<bool> draining_{false};
+  std::chrono::steady_clock::time_point drain_deadline_;
+  std::atomic<size_t> next_feed_{0}; // Round-robin cursor
+
+  std::vector<std::thread> io_threads_;
+  std::vector<std::unique_ptr<Heartbeat>> io_heartbeats_;
+};
+
+} // namespace tick_capture
@@ -0,0 +1,222 @@
+#include "handover.hpp"
+#include "../metrics/thread_stats.hpp"
+#include <cerrno>
+#include <cstring>
+#include <fmt/format.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace tick_capture {
+
+namespace {
+
+constexpr uint64_t kHandoverMagic = 0x48414e444f564552; // "HANDOVER"
+constexpr char kAck = 'A';
+
+struct WireState {
+  uint64_t magic;
+  uint64_t last_sequence;
+  uint64_t ticks_in_ring;
+  char ring_name[64];
+};
+
+sockaddr_un make_address(const std::string &path) {
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(addr.sun_path)) {
+    throw std::runtime_error(
+        fmt::format("Handover socket path too long: {}", path));
+  }
+  std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+  return addr;
+}
+
+} // namespace
+
+HandoverListener::HandoverListener(const std::string &path, Handler handler)
+    : path_(path), handler_(std::move(handler)) {
+  const auto addr = make_address(path_);
+
+  // Message boundaries are preserved, so each state arrives in one read
+  listen_fd_ = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+  if (listen_fd_ < 0) {
+    throw std::runtime_error(fmt::format("Failed to create handover socket: {}",
+                                         std::strerror(errno)));
+  }
+
+  // Replace the socket file left by a predecessor we took over from
+  ::unlink(path_.c_str());
+  if (::bind(listen_fd_, reinterpret_cast<const sockaddr *>(&addr),
+             sizeof(addr)) != 0 ||
+      ::listen(listen_fd_, 1) != 0) {
+    const int err = errno;
+    ::close(listen_fd_);
+    throw std::runtime_error(fmt::format("Failed to listen on {}: {}", path_,
+                                         std::strerror(err)));
+  }
+}
+
+HandoverListener::~HandoverListener() {
+  stop();
+  ::close(listen_fd_);
+
+  // After a handover the path belongs to the successor
+  if (!handed_over_) {
+    ::unlink(path_.c_str());
+  }
+}
+
+void HandoverListener::start() {
+  if (running_)
+    return;
+  running_ = true;
+  listen_thread_ = std::thread([this] {
+    set_thread_name("handover");
+    run();
+  });
+}
+
+void HandoverListener::stop() {
+  if (!running_)
+    return;
+  running_ = false;
+
+  if (listen_thread_.joinable())
+    listen_thread_.join();
+}
+
+void HandoverListener::run() {
+  pollfd pfd{listen_fd_, POLLIN, 0};
+
+  while (running_) {
+    if (::poll(&pfd, 1, 100) <= 0) { // 100ms timeout
+      continue;
+    }
+
+    const int connection_fd = ::accept4(listen_fd_, nullptr, nullptr,
+                                        SOCK_CLOEXEC);
+    if (connection_fd < 0) {
+      continue;
+    }
+
+    fmt::print("Successor connected on {}, handing over\n", path_);
+    try {
+      handler_(connection_fd);
+      handed_over_ = true;
+    } catch (const std::exception &e) {
+      fmt::print(stderr, "Handover failed: {}\n", e.what());
+    }
+    ::close(connection_fd);
+
+    // A node hands over at most once
+    if (handed_over_) {
+      break;
+    }
+  }
+}
+
+bool send_handover(int connection_fd, const HandoverState &state,
+                   std::chrono::milliseconds ack_timeout) {
+  WireState wire{};
+  wire.magic = kHandoverMagic;
+  wire.last_sequence = state.last_sequence;
+  wire.ticks_in_ring = state.ticks_in_ring;
+  if (state.ring_name.size() >= sizeof(wire.ring_name)) {
+    throw std::runtime_error("Handover ring name too long");
+  }
+  std::memcpy(wire.ring_name, state.ring_name.c_str(),
+              state.ring_name.size() + 1);
+
+  iovec iov{&wire, sizeof(wire)};
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))]{};
+  msghdr msg{};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+
+  cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+  std::memcpy(CMSG_DATA(cmsg), &state.socket_fd, sizeof(int));
+
+  if (::sendmsg(connection_fd, &msg, MSG_NOSIGNAL) !=
+      static_cast<ssize_t>(sizeof(wire))) {
+    throw std::runtime_error(
+        fmt::format("Failed to send handover: {}", std::strerror(errno)));
+  }
+
+  pollfd pfd{connection_fd, POLLIN, 0};
+  char ack = 0;
+  return ::poll(&pfd, 1, static_cast<int>(ack_timeout.count())) > 0 &&
+         ::recv(connection_fd, &ack, 1, 0) == 1 && ack == kAck;
+}
+
+bool revoke_handover(int connection_fd) {
+  // A later send fails; an ack already queued can still be read
+  ::shutdown(connection_fd, SHUT_RD);
+  char ack = 0;
+  return ::recv(connection_fd, &ack, 1, MSG_DONTWAIT) == 1 && ack == kAck;
+}
+
+int connect_handover(const std::string &path) {
+  const auto addr = make_address(path);
+  const int fd = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    throw std::runtime_error(fmt::format("Failed to create handover socket: {}",
+                                         std::strerror(errno)));
+  }
+  if (::connect(fd, reinterpret_cast<const sockaddr *>(&addr),
+                sizeof(addr)) != 0) {
+    // No predecessor running; start fresh
+    ::close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+HandoverState receive_handover(int connection_fd) {
+  WireState wire{};
+  iovec iov{&wire, sizeof(wire)};
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))]{};
+  msghdr msg{};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+
+  const ssize_t received = ::recvmsg(connection_fd, &msg, MSG_CMSG_CLOEXEC);
+  if (received != static_cast<ssize_t>(sizeof(wire)) ||
+      wire.magic != kHandoverMagic) {
+    throw std::runtime_error("Invalid handover message from predecessor");
+  }
+
+  HandoverState state;
+  for (cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg;
+       cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+      std::memcpy(&state.socket_fd, CMSG_DATA(cmsg), sizeof(int));
+    }
+  }
+  if (state.socket_fd < 0) {
+    throw std::runtime_error("Handover message carried no socket");
+  }
+
+  wire.ring_name[sizeof(wire.ring_name) - 1] = '\0';
+  state.ring_name = wire.ring_name;
+  state.last_sequence = wire.last_sequence;
+  state.ticks_in_ring = wire.ticks_in_ring;
+  return state;
+}
+
+void acknowledge_handover(int connection_fd) {
+  if (::send(connection_fd, &kAck, 1, MSG_NOSIGNAL) != 1) {
+    throw std::runtime_error(fmt::format("Failed to acknowledge handover: {}",
+                                         std::strerror(errno)));
+  }
+}
+
+} // namespace tick_capture
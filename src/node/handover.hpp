@@ -0,0 +1,69 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <thread>
+
+namespace tick_capture {
+
+// State passed from a running CaptureNode to its successor. The capture
+// socket travels as a file descriptor (SCM_RIGHTS); ticks that were still in
+// flight travel through a shared-memory ring named here.
+struct HandoverState {
+  int socket_fd{-1};
+  std::string ring_name;
+  uint64_t last_sequence{0};
+  uint64_t ticks_in_ring{0};
+};
+
+// Waits on a Unix domain socket for one successor to connect and hands the
+// connection to the handler, which performs the handover.
+class HandoverListener {
+public:
+  using Handler = std::function<void(int connection_fd)>;
+
+  HandoverListener(const std::string &path, Handler handler);
+  ~HandoverListener();
+
+  // Non-copyable
+  HandoverListener(const HandoverListener &) = delete;
+  HandoverListener &operator=(const HandoverListener &) = delete;
+
+  void start();
+  void stop();
+
+  bool handed_over() const { return handed_over_; }
+
+private:
+  void run();
+
+  std::string path_;
+  Handler handler_;
+  int listen_fd_{-1};
+
+  std::atomic<bool> running_{false};
+  std::atomic<bool> handed_over_{false};
+  std::thread listen_thread_;
+};
+
+// Predecessor side: send the state over an accepted connection, then wait
+// for the successor to confirm it has taken the socket and opened the ring
+bool send_handover(int connection_fd, const HandoverState &state,
+                   std::chrono::milliseconds ack_timeout);
+
+// Predecessor side: after send_handover() timed out, stop the successor
+// acknowledging late, so it gives up. True if its ack got in first, in
+// which case the handover went ahead after all.
+bool revoke_handover(int connection_fd);
+
+// Successor side: connect to a predecessor at `path` (-1 if none listening)
+int connect_handover(const std::string &path);
+
+// Successor side: block until the predecessor sends its state
+HandoverState receive_handover(int connection_fd);
+
+// Successor side: confirm the state has been taken over
+void acknowledge_handover(int connection_fd);
+
+} // namespace tick_capture
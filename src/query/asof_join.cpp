@@ -0,0 +1,48 @@
+#include "asof_join.hpp"
+#include <algorithm>
+
+namespace tick_capture {
+
+AsofJoin::AsofJoin(const AsofJoinSpec &spec) : spec_(spec) {
+  if (spec_.left_symbols.empty() || spec_.right_symbols.empty()) {
+    throw std::runtime_error("As-of join needs left and right symbols");
+  }
+
+  uint32_t max_id = 0;
+  for (auto id : spec_.left_symbols)
+    max_id = std::max(max_id, id);
+  for (auto id : spec_.right_symbols)
+    max_id = std::max(max_id, id);
+  for (const auto &[left, right] : spec_.symbol_map)
+    max_id = std::max({max_id, left, right});
+
+  roles_.assign(max_id + 1, 0);
+  right_for_left_.resize(max_id + 1);
+  last_right_.assign(max_id + 1, MarketMessage{});
+  last_right_price_.assign(max_id + 1, 0.0);
+
+  for (uint32_t id = 0; id <= max_id; ++id) {
+    right_for_left_[id] = id;
+  }
+  for (const auto &[left, right] : spec_.symbol_map) {
+    right_for_left_[left] = right;
+  }
+  for (auto id : spec_.left_symbols)
+    roles_[id] |= kLeft;
+  for (auto id : spec_.right_symbols)
+    roles_[id] |= kRight;
+
+  // One merged stream over both sides; a symbol on both sides is read once
+  TickReader::Options options;
+  options.sessions = spec_.sessions;
+  options.start_time = spec_.start_time;
+  options.end_time = spec_.end_time;
+  for (uint32_t id = 0; id <= max_id; ++id) {
+    if (roles_[id] != 0) {
+      options.symbols.push_back(id);
+    }
+  }
+  reader_ = std::make_unique<TickReader>(options);
+}
+
+} // namespace tick_capture
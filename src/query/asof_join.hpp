@@ -0,0 +1,129 @@
+#pragma once
+#include "../../include/tick_capture/types.hpp"
+#include "../storage/tick_reader.hpp"
+#include <chrono>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace tick_capture {
+
+struct AsofJoinSpec {
+  // Capture directories to read; both sides come from the same sessions
+  std::vector<std::string> sessions;
+
+  // Left side: each of these messages is emitted once with its match
+  std::vector<uint32_t> left_symbols;
+  MessageType left_type{MessageType::Trade};
+
+  // Right side: the last value per symbol is kept as join state
+  std::vector<uint32_t> right_symbols;
+  MessageType right_type{MessageType::Quote};
+
+  // Right symbol to match against each left symbol, as (left, right) pairs.
+  // Left symbols not listed are matched against the same symbol id.
+  std::vector<std::pair<uint32_t, uint32_t>> symbol_map;
+
+  // Reject matches older than this (0 = any prior right-side message)
+  std::chrono::nanoseconds tolerance{0};
+
+  // Timestamp window in ns, [start_time, end_time)
+  uint64_t start_time{0};
+  uint64_t end_time{std::numeric_limits<uint64_t>::max()};
+};
+
+struct AsofMatch {
+  const MarketMessage &left;
+  const MarketMessage *right; // nullptr if no prevailing right-side message
+
+  // Prices decoded from each side's session encoding (right_price is 0
+  // without a match)
+  double left_price;
+  double right_price;
+};
+
+// Streaming as-of join: each left-side message is paired with the most
+// recent right-side message at or before its timestamp. Both sides are read
+// in a single pass over the merged TickReader output and neither side is
+// materialised; state is one last-value slot per right-side symbol.
+class AsofJoin {
+public:
+  struct Stats {
+    uint64_t rows_scanned{0};
+    uint64_t left_rows{0};
+    uint64_t matched{0};
+    uint64_t unmatched{0};
+    uint64_t stale{0}; // Right side existed but was older than tolerance
+  };
+
+  explicit AsofJoin(const AsofJoinSpec &spec);
+
+  // Non-copyable
+  AsofJoin(const AsofJoin &) = delete;
+  AsofJoin &operator=(const AsofJoin &) = delete;
+
+  // Run the join, invoking sink(const AsofMatch &) once per left-side row
+  template <typename Sink> Stats run(Sink &&sink);
+
+private:
+  // Role flags per symbol id
+  static constexpr uint8_t kLeft = 1;
+  static constexpr uint8_t kRight = 2;
+
+  uint8_t role(uint32_t symbol_id) const {
+    return symbol_id < roles_.size() ? roles_[symbol_id] : 0;
+  }
+
+  AsofJoinSpec spec_;
+  std::unique_ptr<TickReader> reader_;
+
+  // Flat tables indexed by symbol id
+  std::vector<uint8_t> roles_;
+  std::vector<uint32_t> right_for_left_;
+  std::vector<MarketMessage> last_right_; // sequence_number 0 = no value yet
+  std::vector<double> last_right_price_;
+};
+
+template <typename Sink> AsofJoin::Stats AsofJoin::run(Sink &&sink) {
+  Stats stats;
+  const auto tolerance = static_cast<uint64_t>(spec_.tolerance.count());
+
+  while (const MarketMessage *msg = reader_->next()) {
+    ++stats.rows_scanned;
+    const uint8_t r = role(msg->symbol_id);
+
+    // Update state first so a right-side row at the same timestamp as a
+    // left-side row is visible to it (as-of is inclusive)
+    if ((r & kRight) && msg->type == spec_.right_type) {
+      last_right_[msg->symbol_id] = *msg;
+      last_right_price_[msg->symbol_id] = reader_->price(*msg);
+    }
+
+    if (!(r & kLeft) || msg->type != spec_.left_type) {
+      continue;
+    }
+    ++stats.left_rows;
+
+    const uint32_t right_id = right_for_left_[msg->symbol_id];
+    const MarketMessage &right = last_right_[right_id];
+    const MarketMessage *match = nullptr;
+    double right_price = 0.0;
+    if (right.sequence_number != 0) {
+      if (tolerance == 0 || msg->timestamp - right.timestamp <= tolerance) {
+        match = &right;
+        right_price = last_right_price_[right_id];
+      } else {
+        ++stats.stale;
+      }
+    }
+    if (match) {
+      ++stats.matched;
+    } else {
+      ++stats.unmatched;
+    }
+    sink(AsofMatch{*msg, match, reader_->price(*msg), right_price});
+  }
+  return stats;
+}
+
+} // namespace tick_capture
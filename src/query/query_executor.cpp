@@ -0,0 +1,185 @@
+#include "query_executor.hpp"
+#include "../storage/fixed_point.hpp"
+#include "../storage/session_meta.hpp"
+#include "../storage/tick_file.hpp"
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_reduce.h>
+#include <unordered_set>
+
+namespace tick_capture {
+
+namespace {
+
+// A contiguous slice of one mapped tick file, aggregated by a single task
+struct Segment {
+  const MappedTickFile *file;
+  const SessionMeta *meta;
+  size_t begin;
+  size_t end;
+};
+
+// Trades per column in the fixed-point price filter
+constexpr size_t kColumnSize = 1024;
+
+void scan_segment(const Segment &segment, const AggregateQuery &query,
+                  QueryResult &out) {
+  segment.file->verify(segment.begin, segment.end);
+  const auto messages = segment.file->messages().subspan(
+      segment.begin, segment.end - segment.begin);
+  const auto interval = static_cast<uint64_t>(query.bucket_interval.count());
+
+  Aggregate local;
+  SymbolAggregate *symbol = nullptr;
+  Aggregate *bucket = nullptr;
+  uint64_t bucket_start = 0;
+
+  const auto add = [&](const MarketMessage &msg, double price) {
+    if (msg.timestamp < query.start_time || msg.timestamp >= query.end_time) {
+      return;
+    }
+    local.add(msg, price);
+
+    if (interval > 0) {
+      // Ticks arrive in time order, so the bucket rarely changes between
+      // consecutive messages; only look up the map when it does
+      const uint64_t start = msg.timestamp - msg.timestamp % interval;
+      if (!bucket || start != bucket_start) {
+        if (!symbol) {
+          symbol = &out.by_symbol[segment.file->symbol_id()];
+        }
+        bucket = &symbol->buckets[start];
+        bucket_start = start;
+      }
+      bucket->add(msg, price);
+    }
+  };
+
+  const bool price_filter =
+      query.min_price > std::numeric_limits<double>::lowest() ||
+      query.max_price < std::numeric_limits<double>::max();
+  if (price_filter && segment.meta->fixed_point()) {
+    // Columns without a price in range are skipped after one pass over
+    // their prices
+    const double tick = segment.meta->tick_size(segment.file->symbol_id());
+    const auto [low, high] =
+        fixed_range(query.min_price, query.max_price, tick);
+    int64_t column[kColumnSize];
+    uint8_t mask[kColumnSize];
+    for (size_t begin = 0; begin < messages.size(); begin += kColumnSize) {
+      const auto chunk = messages.subspan(
+          begin, std::min(kColumnSize, messages.size() - begin));
+      gather_fixed(chunk, column);
+      const std::span<const int64_t> prices(column, chunk.size());
+      if (count_in_range(prices, low, high) == 0) {
+        continue;
+      }
+      mask_in_range(prices, low, high, mask);
+      for (size_t i = 0; i < chunk.size(); ++i) {
+        if (mask[i]) {
+          add(chunk[i], fixed_to_price(column[i], tick));
+        }
+      }
+    }
+  } else {
+    for (const auto &msg : messages) {
+      const double price = segment.meta->price(msg);
+      if (price >= query.min_price && price <= query.max_price) {
+        add(msg, price);
+      }
+    }
+  }
+
+  if (local.count > 0) {
+    if (!symbol) {
+      symbol = &out.by_symbol[segment.file->symbol_id()];
+    }
+    symbol->total.merge(local);
+    out.total.merge(local);
+  }
+  out.segments_scanned++;
+  out.bytes_scanned += messages.size_bytes();
+}
+
+} // namespace
+
+void SymbolAggregate::merge(const SymbolAggregate &other) {
+  total.merge(other.total);
+  for (const auto &[start, bucket] : other.buckets) {
+    buckets[start].merge(bucket);
+  }
+}
+
+void QueryResult::merge(const QueryResult &other) {
+  total.merge(other.total);
+  for (const auto &[symbol_id, aggregate] : other.by_symbol) {
+    by_symbol[symbol_id].merge(aggregate);
+  }
+  segments_scanned += other.segments_scanned;
+  bytes_scanned += other.bytes_scanned;
+}
+
+QueryExecutor::QueryExecutor(const Config &config)
+    : config_(config),
+      arena_(config.max_threads > 0 ? static_cast<int>(config.max_threads)
+                                    : tbb::task_arena::automatic) {
+  if (config_.segment_messages == 0) {
+    throw std::runtime_error("segment_messages must be greater than zero");
+  }
+}
+
+QueryResult QueryExecutor::run(const AggregateQuery &query) {
+  const auto start = std::chrono::steady_clock::now();
+  const std::unordered_set<uint32_t> wanted(query.symbols.begin(),
+                                            query.symbols.end());
+
+  // Map every matching file up front; the mappings outlive all tasks
+  std::vector<SessionMeta> metas;
+  metas.reserve(query.sessions.size());
+  std::vector<MappedTickFile> files;
+  std::vector<const SessionMeta *> file_metas; // Parallel to files
+  for (const auto &session : query.sessions) {
+    metas.push_back(SessionMeta::load(session));
+    for (const auto &path : MappedTickFile::list(session)) {
+      if (!wanted.empty() &&
+          !wanted.count(MappedTickFile::parse_symbol_id(path))) {
+        continue;
+      }
+      MappedTickFile file(path);
+      if (file.size() > 0) {
+        files.push_back(std::move(file));
+        file_metas.push_back(&metas.back());
+      }
+    }
+  }
+
+  std::vector<Segment> segments;
+  for (size_t i = 0; i < files.size(); ++i) {
+    const auto &file = files[i];
+    for (size_t begin = 0; begin < file.size();
+         begin += config_.segment_messages) {
+      segments.push_back({&file, file_metas[i], begin,
+                          std::min(file.size(),
+                                   begin + config_.segment_messages)});
+    }
+  }
+
+  QueryResult result = arena_.execute([&] {
+    return tbb::parallel_reduce(
+        tbb::blocked_range<size_t>(0, segments.size(), 1), QueryResult{},
+        [&](const tbb::blocked_range<size_t> &range, QueryResult partial) {
+          for (size_t i = range.begin(); i != range.end(); ++i) {
+            scan_segment(segments[i], query, partial);
+          }
+          return partial;
+        },
+        [](QueryResult lhs, const QueryResult &rhs) {
+          lhs.merge(rhs);
+          return lhs;
+        });
+  });
+
+  result.elapsed = std::chrono::steady_clock::now() - start;
+  return result;
+}
+
+} // namespace tick_capture
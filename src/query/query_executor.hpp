@@ -0,0 +1,120 @@
+#pragma once
+#include "../../include/tick_capture/types.hpp"
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <map>
+#include <string>
+#include <tbb/task_arena.h>
+#include <vector>
+
+namespace tick_capture {
+
+// Trade aggregates that can be built independently per task and merged
+struct Aggregate {
+  uint64_t count{0};
+  uint64_t volume{0};
+  double notional{0.0}; // sum(price * size), for VWAP
+  double min_price{std::numeric_limits<double>::max()};
+  double max_price{std::numeric_limits<double>::lowest()};
+  uint64_t first_timestamp{std::numeric_limits<uint64_t>::max()};
+  uint64_t last_timestamp{0};
+
+  // price is the trade price decoded from the session's encoding
+  void add(const MarketMessage &msg, double price) {
+    ++count;
+    volume += msg.trade.size;
+    notional += price * msg.trade.size;
+    min_price = std::min(min_price, price);
+    max_price = std::max(max_price, price);
+    first_timestamp = std::min(first_timestamp, msg.timestamp);
+    last_timestamp = std::max(last_timestamp, msg.timestamp);
+  }
+
+  void merge(const Aggregate &other) {
+    count += other.count;
+    volume += other.volume;
+    notional += other.notional;
+    min_price = std::min(min_price, other.min_price);
+    max_price = std::max(max_price, other.max_price);
+    first_timestamp = std::min(first_timestamp, other.first_timestamp);
+    last_timestamp = std::max(last_timestamp, other.last_timestamp);
+  }
+
+  double vwap() const {
+    return volume > 0 ? notional / static_cast<double>(volume) : 0.0;
+  }
+};
+
+struct AggregateQuery {
+  // Capture directories (TickStorage output_dir) to scan
+  std::vector<std::string> sessions;
+
+  // Symbols to include (empty = all symbols found)
+  std::vector<uint32_t> symbols;
+
+  // Timestamp window in ns, [start_time, end_time)
+  uint64_t start_time{0};
+  uint64_t end_time{std::numeric_limits<uint64_t>::max()};
+
+  // Trade price window, inclusive. Fixed-point sessions compare whole
+  // ticks over columns of prices.
+  double min_price{std::numeric_limits<double>::lowest()};
+  double max_price{std::numeric_limits<double>::max()};
+
+  // Per-interval buckets keyed by bucket start time (0 disables buckets)
+  std::chrono::nanoseconds bucket_interval{0};
+};
+
+struct SymbolAggregate {
+  Aggregate total;
+  std::map<uint64_t, Aggregate> buckets;
+
+  void merge(const SymbolAggregate &other);
+};
+
+struct QueryResult {
+  Aggregate total;
+  std::map<uint32_t, SymbolAggregate> by_symbol;
+
+  // Execution statistics
+  size_t segments_scanned{0};
+  uint64_t bytes_scanned{0};
+  std::chrono::nanoseconds elapsed{0};
+
+  void merge(const QueryResult &other);
+};
+
+// Runs aggregate queries over stored tick files. Each file is split into
+// fixed-size segments and every segment is aggregated as its own TBB task
+// into a partial result; partials are merged pairwise as tasks complete.
+class QueryExecutor {
+public:
+  struct Config {
+    // Worker thread budget (0 = all hardware threads). Keep this below the
+    // core count when running on a live capture host.
+    size_t max_threads{0};
+
+    // Messages per task; smaller segments balance better across symbols
+    // with skewed activity, larger ones cut merge overhead.
+    size_t segment_messages{1 << 16};
+  };
+
+  explicit QueryExecutor(const Config &config);
+
+  // Non-copyable
+  QueryExecutor(const QueryExecutor &) = delete;
+  QueryExecutor &operator=(const QueryExecutor &) = delete;
+
+  QueryResult run(const AggregateQuery &query);
+
+  size_t max_concurrency() const {
+    return static_cast<size_t>(arena_.max_concurrency());
+  }
+
+private:
+  Config config_;
+  tbb::task_arena arena_;
+};
+
+} // namespace tick_capture
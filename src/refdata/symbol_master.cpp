@@ -0,0 +1,326 @@
+#include "symbol_master.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <fmt/format.h>
+#include <fstream>
+#include <sstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_set>
+
+namespace tick_capture {
+
+namespace {
+
+constexpr char kMagic[8] = {'S', 'Y', 'M', 'M', 'A', 'S', 'T', '1'};
+
+// Image layout: header, records[max_symbol_id + 1], seeds[buckets],
+// slots[slot_count]
+struct ImageHeader {
+  char magic[8];
+  uint32_t max_symbol_id;
+  uint32_t count;
+  uint32_t buckets;
+  uint32_t slot_count; // Power of two
+};
+
+uint64_t hash_ticker(std::string_view ticker) {
+  uint64_t h = 0xcbf29ce484222325; // FNV-1a
+  for (const char c : ticker) {
+    h = (h ^ static_cast<uint8_t>(c)) * 0x100000001b3;
+  }
+  return h;
+}
+
+// Derive an independent hash per seed (splitmix64 finalizer)
+uint64_t mix(uint64_t h, uint64_t seed) {
+  h ^= seed * 0x9e3779b97f4a7c15;
+  h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9;
+  h = (h ^ (h >> 27)) * 0x94d049bb133111eb;
+  return h ^ (h >> 31);
+}
+
+size_t image_size(const ImageHeader &header) {
+  return sizeof(ImageHeader) +
+         (static_cast<size_t>(header.max_symbol_id) + 1) * sizeof(SymbolInfo) +
+         (static_cast<size_t>(header.buckets) + header.slot_count) *
+             sizeof(uint32_t);
+}
+
+std::vector<std::string> split_csv(const std::string &line) {
+  std::vector<std::string> fields;
+  std::stringstream ss(line);
+  std::string field;
+  while (std::getline(ss, field, ',')) {
+    const auto first = field.find_first_not_of(" \t\r");
+    const auto last = field.find_last_not_of(" \t\r");
+    fields.push_back(first == std::string::npos
+                         ? std::string()
+                         : field.substr(first, last - first + 1));
+  }
+  return fields;
+}
+
+} // namespace
+
+void SymbolMaster::compile(const std::filesystem::path &csv_path,
+                           const std::filesystem::path &image_path,
+                           uint32_t max_symbol_id) {
+  std::ifstream csv(csv_path);
+  if (!csv) {
+    throw std::runtime_error(
+        fmt::format("Failed to open symbol master {}", csv_path.string()));
+  }
+
+  ImageHeader header{};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.max_symbol_id = max_symbol_id;
+  std::vector<SymbolInfo> records(static_cast<size_t>(max_symbol_id) + 1);
+  std::vector<uint32_t> ids;
+  std::unordered_set<std::string> tickers;
+
+  std::string line;
+  for (size_t line_no = 1; std::getline(csv, line); ++line_no) {
+    const auto fields = split_csv(line);
+    if (fields.empty() || fields[0].empty() || fields[0][0] == '#' ||
+        fields[0] == "ticker") {
+      continue;
+    }
+
+    const auto error = [&](std::string_view what) {
+      return std::runtime_error(fmt::format("{}:{}: {}", csv_path.string(),
+                                            line_no, what));
+    };
+    if (fields.size() < 2) {
+      throw error("expected ticker,id");
+    }
+
+    SymbolInfo info{};
+    if (fields[0].size() >= sizeof(info.ticker)) {
+      throw error(fmt::format("ticker '{}' is too long", fields[0]));
+    }
+    std::memcpy(info.ticker, fields[0].data(), fields[0].size());
+
+    try {
+      const auto id = std::stoul(fields[1]);
+      if (id == 0 || id > max_symbol_id) {
+        throw error(fmt::format("id {} is outside 1..{}", id, max_symbol_id));
+      }
+      info.id = static_cast<uint32_t>(id);
+      info.tick_size = fields.size() > 2 ? std::stod(fields[2]) : 0.0;
+      info.lot_size = fields.size() > 3
+                          ? static_cast<uint32_t>(std::stoul(fields[3]))
+                          : 1;
+      info.price_low = fields.size() > 4 ? std::stod(fields[4]) : 0.0;
+      info.price_high = fields.size() > 5 ? std::stod(fields[5]) : 0.0;
+    } catch (const std::logic_error &) {
+      throw error("malformed number");
+    }
+
+    if (records[info.id].id != 0 || !tickers.insert(fields[0]).second) {
+      throw error(fmt::format("duplicate symbol {} ({})", fields[0], info.id));
+    }
+    records[info.id] = info;
+    ids.push_back(info.id);
+  }
+
+  // Hash and displace: group tickers into buckets, then place the largest
+  // buckets first, searching for a seed that sends every ticker in the
+  // bucket to a free slot
+  header.count = static_cast<uint32_t>(ids.size());
+  header.buckets = std::max<uint32_t>(header.count / 4, 1);
+  header.slot_count = 1;
+  while (header.slot_count < header.count + header.count / 4 + 1) {
+    header.slot_count <<= 1;
+  }
+  const uint64_t slot_mask = header.slot_count - 1;
+
+  std::vector<std::vector<uint32_t>> buckets(header.buckets);
+  for (const uint32_t id : ids) {
+    const auto h = hash_ticker(records[id].name());
+    buckets[mix(h, 0) % header.buckets].push_back(id);
+  }
+  std::vector<uint32_t> order(header.buckets);
+  for (uint32_t b = 0; b < header.buckets; ++b) {
+    order[b] = b;
+  }
+  std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+    return buckets[a].size() > buckets[b].size();
+  });
+
+  std::vector<uint32_t> seeds(header.buckets, 0);
+  std::vector<uint32_t> slots(header.slot_count, 0);
+  std::vector<uint64_t> placed;
+  for (const uint32_t b : order) {
+    if (buckets[b].empty()) {
+      break;
+    }
+    for (uint32_t seed = 1;; ++seed) {
+      if (seed == (1u << 24)) {
+        throw std::runtime_error("Failed to build symbol perfect hash");
+      }
+      placed.clear();
+      for (const uint32_t id : buckets[b]) {
+        const auto slot = mix(hash_ticker(records[id].name()), seed) &
+                          slot_mask;
+        if (slots[slot] != 0 ||
+            std::find(placed.begin(), placed.end(), slot) != placed.end()) {
+          break;
+        }
+        placed.push_back(slot);
+      }
+      if (placed.size() == buckets[b].size()) {
+        for (size_t i = 0; i < placed.size(); ++i) {
+          slots[placed[i]] = buckets[b][i];
+        }
+        seeds[b] = seed;
+        break;
+      }
+    }
+  }
+
+  // Write to a temporary file and rename, so readers never map a partial
+  // image
+  auto tmp_path = image_path;
+  tmp_path += ".tmp";
+  {
+    std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(records.data()),
+              records.size() * sizeof(SymbolInfo));
+    out.write(reinterpret_cast<const char *>(seeds.data()),
+              seeds.size() * sizeof(uint32_t));
+    out.write(reinterpret_cast<const char *>(slots.data()),
+              slots.size() * sizeof(uint32_t));
+    if (!out) {
+      throw std::runtime_error(fmt::format("Failed to write symbol image {}",
+                                           tmp_path.string()));
+    }
+  }
+  std::filesystem::rename(tmp_path, image_path);
+}
+
+SymbolMaster SymbolMaster::load(const std::filesystem::path &csv_path,
+                                uint32_t max_symbol_id) {
+  auto image_path = csv_path;
+  image_path += ".idx";
+
+  std::error_code ec;
+  const auto image_time = std::filesystem::last_write_time(image_path, ec);
+  if (!ec && image_time >= std::filesystem::last_write_time(csv_path)) {
+    try {
+      SymbolMaster master(image_path);
+      if (master.max_symbol_id() == max_symbol_id) {
+        return master;
+      }
+    } catch (const std::exception &e) {
+      fmt::print(stderr, "Rebuilding symbol image: {}\n", e.what());
+    }
+  }
+
+  compile(csv_path, image_path, max_symbol_id);
+  SymbolMaster master(image_path);
+  fmt::print("Loaded {} symbols from {}\n", master.size(), csv_path.string());
+  return master;
+}
+
+SymbolMaster::SymbolMaster(const std::filesystem::path &image_path) {
+  const int fd = ::open(image_path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    throw std::runtime_error(fmt::format("Failed to open symbol image {}: {}",
+                                         image_path.string(),
+                                         std::strerror(errno)));
+  }
+
+  struct stat st {};
+  if (::fstat(fd, &st) != 0 ||
+      static_cast<size_t>(st.st_size) < sizeof(ImageHeader)) {
+    ::close(fd);
+    throw std::runtime_error(
+        fmt::format("Symbol image {} is truncated", image_path.string()));
+  }
+
+  mapped_bytes_ = static_cast<size_t>(st.st_size);
+  void *addr = ::mmap(nullptr, mapped_bytes_, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (addr == MAP_FAILED) {
+    throw std::runtime_error(fmt::format("Failed to map symbol image {}: {}",
+                                         image_path.string(),
+                                         std::strerror(errno)));
+  }
+  data_ = addr;
+
+  const auto &header = *static_cast<const ImageHeader *>(data_);
+  if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+      header.slot_count == 0 ||
+      (header.slot_count & (header.slot_count - 1)) != 0 ||
+      header.buckets == 0 || image_size(header) != mapped_bytes_) {
+    release();
+    throw std::runtime_error(
+        fmt::format("{} is not a symbol image", image_path.string()));
+  }
+
+  // Lookups touch random records; skip the readahead
+  ::madvise(data_, mapped_bytes_, MADV_RANDOM);
+
+  const auto *base = static_cast<const char *>(data_);
+  max_symbol_id_ = header.max_symbol_id;
+  count_ = header.count;
+  buckets_ = header.buckets;
+  slot_mask_ = header.slot_count - 1;
+  records_ = reinterpret_cast<const SymbolInfo *>(base + sizeof(ImageHeader));
+  seeds_ = reinterpret_cast<const uint32_t *>(records_ + max_symbol_id_ + 1);
+  slots_ = seeds_ + buckets_;
+}
+
+SymbolMaster::~SymbolMaster() { release(); }
+
+SymbolMaster::SymbolMaster(SymbolMaster &&other) noexcept
+    : data_(std::exchange(other.data_, nullptr)),
+      mapped_bytes_(std::exchange(other.mapped_bytes_, 0)),
+      records_(std::exchange(other.records_, nullptr)),
+      seeds_(std::exchange(other.seeds_, nullptr)),
+      slots_(std::exchange(other.slots_, nullptr)),
+      max_symbol_id_(std::exchange(other.max_symbol_id_, 0)),
+      count_(std::exchange(other.count_, 0)),
+      buckets_(std::exchange(other.buckets_, 0)),
+      slot_mask_(std::exchange(other.slot_mask_, 0)) {}
+
+SymbolMaster &SymbolMaster::operator=(SymbolMaster &&other) noexcept {
+  if (this != &other) {
+    release();
+    data_ = std::exchange(other.data_, nullptr);
+    mapped_bytes_ = std::exchange(other.mapped_bytes_, 0);
+    records_ = std::exchange(other.records_, nullptr);
+    seeds_ = std::exchange(other.seeds_, nullptr);
+    slots_ = std::exchange(other.slots_, nullptr);
+    max_symbol_id_ = std::exchange(other.max_symbol_id_, 0);
+    count_ = std::exchange(other.count_, 0);
+    buckets_ = std::exchange(other.buckets_, 0);
+    slot_mask_ = std::exchange(other.slot_mask_, 0);
+  }
+  return *this;
+}
+
+void SymbolMaster::release() noexcept {
+  if (data_) {
+    ::munmap(data_, mapped_bytes_);
+    data_ = nullptr;
+  }
+  mapped_bytes_ = 0;
+}
+
+uint32_t SymbolMaster::intern(std::string_view ticker) const noexcept {
+  if (count_ == 0) {
+    return 0;
+  }
+  const auto h = hash_ticker(ticker);
+  const auto seed = seeds_[mix(h, 0) % buckets_];
+  const auto id = slots_[mix(h, seed) & slot_mask_];
+  return id != 0 && records_[id].name() == ticker ? id : 0;
+}
+
+} // namespace tick_capture
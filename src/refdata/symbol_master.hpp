@@ -0,0 +1,86 @@
+#pragma once
+#include "../../include/tick_capture/types.hpp"
+#include <filesystem>
+#include <string_view>
+
+namespace tick_capture {
+
+// Static reference data for one instrument
+struct SymbolInfo {
+  char ticker[16]; // NUL-padded
+  uint32_t id;     // 0 marks an unused slot
+  uint32_t lot_size;
+  double tick_size;
+  double price_low; // Static price band; 0/0 means no band
+  double price_high;
+
+  std::string_view name() const {
+    return {ticker, ::strnlen(ticker, sizeof(ticker))};
+  }
+  bool in_band(double price) const {
+    return price_high <= price_low ||
+           (price >= price_low && price <= price_high);
+  }
+};
+static_assert(sizeof(SymbolInfo) == 48, "SymbolInfo is an on-disk record");
+
+// Read-only symbol master, compiled from CSV into a binary image and mapped
+// into memory, so several processes share one copy.
+//
+// The image holds one record per id up to max_symbol_id, so attribute
+// lookups by id are a bounds check and an index. Tickers are interned to
+// ids through a perfect hash built by hash-and-displace: two
+// hash evaluations and one string compare, never a probe sequence.
+//
+// CSV columns: ticker,id[,tick_size,lot_size,price_low,price_high]. Blank
+// lines, lines starting with '#' and a header row are skipped.
+class SymbolMaster {
+public:
+  // Map the image next to csv_path ("<csv_path>.idx"), recompiling it
+  // first if it is missing, older than the CSV or built with another
+  // max_symbol_id
+  static SymbolMaster load(const std::filesystem::path &csv_path,
+                           uint32_t max_symbol_id);
+
+  // Build an image from CSV; ids above max_symbol_id are an error
+  static void compile(const std::filesystem::path &csv_path,
+                      const std::filesystem::path &image_path,
+                      uint32_t max_symbol_id);
+
+  explicit SymbolMaster(const std::filesystem::path &image_path);
+  ~SymbolMaster();
+
+  // Non-copyable, movable
+  SymbolMaster(const SymbolMaster &) = delete;
+  SymbolMaster &operator=(const SymbolMaster &) = delete;
+  SymbolMaster(SymbolMaster &&other) noexcept;
+  SymbolMaster &operator=(SymbolMaster &&other) noexcept;
+
+  // Attributes of a symbol, or nullptr if the id is not in the master
+  const SymbolInfo *find(uint32_t id) const noexcept {
+    return id <= max_symbol_id_ && records_[id].id != 0 ? &records_[id]
+                                                         : nullptr;
+  }
+
+  // Id of a ticker, or 0 if unknown
+  uint32_t intern(std::string_view ticker) const noexcept;
+
+  uint32_t max_symbol_id() const { return max_symbol_id_; }
+  size_t size() const { return count_; }
+
+private:
+  void release() noexcept;
+
+  void *data_{nullptr};
+  size_t mapped_bytes_{0};
+
+  const SymbolInfo *records_{nullptr}; // Indexed by id
+  const uint32_t *seeds_{nullptr};     // Per-bucket displacement
+  const uint32_t *slots_{nullptr};     // Hash slot -> id
+  uint32_t max_symbol_id_{0};
+  uint32_t count_{0};
+  uint32_t buckets_{0};
+  uint32_t slot_mask_{0};
+};
+
+} // namespace tick_capture
@@ -0,0 +1,355 @@
+#include "replay_server.hpp"
+#include "../metrics/thread_stats.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fmt/format.h>
+#include <unordered_set>
+
+namespace tick_capture {
+
+namespace {
+
+// Frees the mapping reference that keeps a zero-copy frame's memory alive
+void release_mapping(void * /*data*/, void *hint) {
+  delete static_cast<std::shared_ptr<const MappedTickFile> *>(hint);
+}
+
+} // namespace
+
+ReplayServer::ReplayServer(const Config &config) : config_(config) {
+  context_ = zmq_ctx_new();
+  if (!context_) {
+    throw std::runtime_error("Failed to create ZMQ context");
+  }
+
+  router_ = zmq_socket(context_, ZMQ_ROUTER);
+  if (!router_) {
+    zmq_ctx_destroy(context_);
+    throw std::runtime_error("Failed to create replay socket");
+  }
+
+  // Report full or vanished peers instead of silently dropping frames
+  const int mandatory = 1;
+  const int linger = 0;
+  zmq_setsockopt(router_, ZMQ_ROUTER_MANDATORY, &mandatory, sizeof(mandatory));
+  zmq_setsockopt(router_, ZMQ_SNDHWM, &config_.send_hwm,
+                 sizeof(config_.send_hwm));
+  zmq_setsockopt(router_, ZMQ_SNDBUF, &config_.send_buffer,
+                 sizeof(config_.send_buffer));
+  zmq_setsockopt(router_, ZMQ_LINGER, &linger, sizeof(linger));
+
+  if (zmq_bind(router_, config_.bind_address.c_str()) != 0) {
+    zmq_close(router_);
+    zmq_ctx_destroy(context_);
+    throw std::runtime_error(
+        fmt::format("Failed to bind replay server: {}", zmq_strerror(errno)));
+  }
+
+  config_.chunk_bytes = std::max(config_.chunk_bytes, sizeof(MarketMessage));
+}
+
+ReplayServer::~ReplayServer() {
+  stop();
+
+  if (router_)
+    zmq_close(router_);
+  if (context_)
+    zmq_ctx_destroy(context_);
+}
+
+void ReplayServer::start() {
+  if (running_)
+    return;
+  running_ = true;
+  server_thread_ = std::thread([this] {
+    set_thread_name("replay");
+    run();
+  });
+}
+
+void ReplayServer::stop() {
+  if (!running_)
+    return;
+  running_ = false;
+
+  if (server_thread_.joinable())
+    server_thread_.join();
+  sessions_.clear();
+  active_sessions_ = 0;
+}
+
+void ReplayServer::run() {
+  zmq_pollitem_t items[] = {{router_, 0, ZMQ_POLLIN, 0}};
+  bool progressed = false;
+
+  while (running_) {
+    // Block only when there is nothing to send; back off briefly when every
+    // session is waiting on a full client queue or on its pacing clock
+    const long timeout = sessions_.empty() ? 100 : (progressed ? 0 : 1);
+    if (zmq_poll(items, 1, timeout) > 0 && (items[0].revents & ZMQ_POLLIN)) {
+      zmq_msg_t identity;
+      zmq_msg_init(&identity);
+
+      while (zmq_msg_recv(&identity, router_, ZMQ_DONTWAIT) >= 0) {
+        // The request is the last frame
+        zmq_msg_t body;
+        zmq_msg_init(&body);
+        bool more = zmq_msg_more(&identity);
+        while (more && zmq_msg_recv(&body, router_, 0) >= 0) {
+          more = zmq_msg_more(&body);
+        }
+
+        const std::string id(
+            static_cast<const char *>(zmq_msg_data(&identity)),
+            zmq_msg_size(&identity));
+        accept_request(id, zmq_msg_data(&body), zmq_msg_size(&body));
+        zmq_msg_close(&body);
+      }
+      zmq_msg_close(&identity);
+    }
+
+    progressed = false;
+    for (auto it = sessions_.begin(); it != sessions_.end();) {
+      if (pump(*it, progressed)) {
+        ++it;
+      } else {
+        it = sessions_.erase(it);
+      }
+    }
+    active_sessions_ = sessions_.size();
+  }
+}
+
+void ReplayServer::accept_request(const std::string &identity,
+                                  const void *data, size_t size) {
+  requests_++;
+
+  Session session;
+  session.identity = identity;
+
+  if (size != sizeof(ReplayRequest)) {
+    fmt::print(stderr, "Invalid replay request size: {} bytes\n", size);
+    reject(std::move(session), ReplayEnd::BadRequest);
+    return;
+  }
+  std::memcpy(&session.request, data, sizeof(ReplayRequest));
+
+  const auto &request = session.request;
+  if (request.num_symbols > ReplayRequest::kMaxSymbols ||
+      !(request.speed >= 0.0)) {
+    fmt::print(stderr, "Invalid replay request from client\n");
+    reject(std::move(session), ReplayEnd::BadRequest);
+    return;
+  }
+
+  TickReader::Options options;
+  options.sessions = {config_.data_dir};
+  options.symbols.assign(request.symbols,
+                         request.symbols + request.num_symbols);
+  options.start_time = request.start_time;
+  options.end_time = request.end_time;
+  options.start_sequence = request.start_sequence;
+  options.end_sequence = request.end_sequence;
+
+  try {
+    // Fixed-point prices are decoded on the way out, so cannot be sent
+    // straight from the mapping
+    if (request.speed > 0.0 || (request.flags & ReplayRequest::kMergeOrder) ||
+        SessionMeta::load(config_.data_dir).fixed_point()) {
+      session.reader = std::make_unique<TickReader>(options);
+      session.pending = session.reader->next();
+      if (session.pending) {
+        session.started = std::chrono::steady_clock::now();
+        session.first_timestamp = session.pending->timestamp;
+      }
+    } else {
+      const std::unordered_set<uint32_t> wanted(options.symbols.begin(),
+                                                options.symbols.end());
+      for (const auto &path : MappedTickFile::list(config_.data_dir)) {
+        if (!wanted.empty() &&
+            !wanted.count(MappedTickFile::parse_symbol_id(path))) {
+          continue;
+        }
+        auto file = std::make_shared<const MappedTickFile>(path);
+        const auto window = TickReader::window(*file, options);
+        if (!window.empty()) {
+          session.ranges.push_back(
+              {file, window.data(), window.data() + window.size()});
+        }
+      }
+    }
+  } catch (const std::exception &e) {
+    fmt::print(stderr, "Error opening replay range: {}\n", e.what());
+    reject(std::move(session), ReplayEnd::Failed);
+    return;
+  }
+
+  sessions_.push_back(std::move(session));
+}
+
+void ReplayServer::reject(Session session, ReplayEnd::Status status) {
+  session.error = status;
+  session.ranges.clear();
+  session.reader.reset();
+  // Keep the session to retry if the client's queue is full
+  if (finish(session, status)) {
+    sessions_.push_back(std::move(session));
+  }
+}
+
+bool ReplayServer::pump(Session &session, bool &progressed) {
+  if (session.error != ReplayEnd::Ok) {
+    return finish(session, session.error);
+  }
+  try {
+    return session.reader ? pump_reader(session, progressed)
+                          : pump_ranges(session, progressed);
+  } catch (const std::exception &e) {
+    // A block failed its checksum on the way out
+    fmt::print(stderr, "Error reading replay range: {}\n", e.what());
+    session.error = ReplayEnd::Failed;
+    session.ranges.clear();
+    session.reader.reset();
+    session.pending = nullptr;
+    session.batch.clear();
+    return finish(session, session.error);
+  }
+}
+
+bool ReplayServer::pump_ranges(Session &session, bool &progressed) {
+  if (session.ranges.empty()) {
+    return finish(session, ReplayEnd::Ok);
+  }
+
+  auto &range = session.ranges.front();
+  const size_t count =
+      std::min<size_t>(range.end - range.pos,
+                       config_.chunk_bytes / sizeof(MarketMessage));
+  const size_t bytes = count * sizeof(MarketMessage);
+  const auto first =
+      static_cast<size_t>(range.pos - range.file->messages().data());
+  range.file->verify(first, first + count);
+
+  // The frame points into the mapping; zmq holds a reference to the file
+  // until the bytes have left the socket
+  zmq_msg_t payload;
+  zmq_msg_init_data(&payload, const_cast<MarketMessage *>(range.pos), bytes,
+                    release_mapping,
+                    new std::shared_ptr<const MappedTickFile>(range.file));
+
+  switch (send(session.identity, payload)) {
+  case SendResult::Sent:
+    progressed = true;
+    range.pos += count;
+    session.messages_sent += count;
+    messages_sent_.fetch_add(count, std::memory_order_relaxed);
+    bytes_sent_.fetch_add(bytes, std::memory_order_relaxed);
+    if (range.pos == range.end) {
+      session.ranges.pop_front();
+    }
+    return true;
+  case SendResult::WouldBlock:
+    return true;
+  case SendResult::Gone:
+    break;
+  }
+  return false;
+}
+
+bool ReplayServer::pump_reader(Session &session, bool &progressed) {
+  const size_t max_batch = config_.chunk_bytes / sizeof(MarketMessage);
+  const double speed = session.request.speed;
+  const auto now = std::chrono::steady_clock::now();
+
+  // Gather everything that is due; a batch left over from a blocked send is
+  // topped up and retried
+  while (session.batch.size() < max_batch && session.pending) {
+    if (speed > 0.0) {
+      const auto offset = std::chrono::nanoseconds(static_cast<int64_t>(
+          static_cast<double>(session.pending->timestamp -
+                              session.first_timestamp) /
+          speed));
+      if (session.started + offset > now) {
+        break;
+      }
+    }
+    MarketMessage &msg = session.batch.emplace_back(*session.pending);
+    if (session.reader->meta().fixed_point()) {
+      constexpr size_t kPrice = offsetof(MarketMessage, trade.price);
+      msg.toggle_checksum(kPrice, sizeof(msg.trade.price));
+      msg.trade.price = session.reader->price(*session.pending);
+      msg.toggle_checksum(kPrice, sizeof(msg.trade.price));
+    }
+    session.pending = session.reader->next();
+  }
+
+  if (session.batch.empty()) {
+    return session.pending ? true : finish(session, ReplayEnd::Ok);
+  }
+
+  const size_t bytes = session.batch.size() * sizeof(MarketMessage);
+  zmq_msg_t payload;
+  zmq_msg_init_size(&payload, bytes);
+  std::memcpy(zmq_msg_data(&payload), session.batch.data(), bytes);
+
+  switch (send(session.identity, payload)) {
+  case SendResult::Sent:
+    progressed = true;
+    session.messages_sent += session.batch.size();
+    messages_sent_.fetch_add(session.batch.size(), std::memory_order_relaxed);
+    bytes_sent_.fetch_add(bytes, std::memory_order_relaxed);
+    session.batch.clear();
+    return true;
+  case SendResult::WouldBlock:
+    return true;
+  case SendResult::Gone:
+    break;
+  }
+  session.batch.clear();
+  return false;
+}
+
+bool ReplayServer::finish(Session &session, ReplayEnd::Status status) {
+  ReplayEnd end;
+  end.messages = session.messages_sent;
+  end.status = status;
+
+  zmq_msg_t payload;
+  zmq_msg_init_size(&payload, sizeof(end));
+  std::memcpy(zmq_msg_data(&payload), &end, sizeof(end));
+
+  // Keep the session around to retry if the client's queue is full
+  return send(session.identity, payload) == SendResult::WouldBlock;
+}
+
+ReplayServer::SendResult ReplayServer::send(const std::string &identity,
+                                            zmq_msg_t &payload) {
+  zmq_msg_t address;
+  zmq_msg_init_size(&address, identity.size());
+  std::memcpy(zmq_msg_data(&address), identity.data(), identity.size());
+
+  if (zmq_msg_send(&address, router_, ZMQ_SNDMORE | ZMQ_DONTWAIT) < 0) {
+    const int err = errno;
+    zmq_msg_close(&address);
+    zmq_msg_close(&payload);
+    return err == EAGAIN ? SendResult::WouldBlock : SendResult::Gone;
+  }
+
+  // Once the first frame is accepted the rest of the message is too
+  if (zmq_msg_send(&payload, router_, ZMQ_DONTWAIT) < 0) {
+    zmq_msg_close(&payload);
+    return SendResult::Gone;
+  }
+  return SendResult::Sent;
+}
+
+ReplayServer::Stats ReplayServer::get_stats() const {
+  Stats stats;
+  stats.requests = requests_.load();
+  stats.messages_sent = messages_sent_.load();
+  stats.bytes_sent = bytes_sent_.load();
+  stats.active_sessions = active_sessions_.load();
+  return stats;
+}
+
+} // namespace tick_capture
@@ -0,0 +1,143 @@
+#pragma once
+#include "../../include/tick_capture/types.hpp"
+#include "../storage/tick_file.hpp"
+#include "../storage/tick_reader.hpp"
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <string>
+#include <thread>
+#include <zmq.h>
+
+namespace tick_capture {
+
+// Range request sent by a replay client as a single frame over a ZMQ DEALER
+// socket connected to the server's ROUTER
+struct ReplayRequest {
+  static constexpr size_t kMaxSymbols = 64;
+
+  // Request flags
+  static constexpr uint32_t kMergeOrder = 1; // Interleave symbols by time
+
+  uint64_t start_time{0};
+  uint64_t end_time{std::numeric_limits<uint64_t>::max()};
+  uint64_t start_sequence{0};
+  uint64_t end_sequence{std::numeric_limits<uint64_t>::max()};
+
+  // Playback speed relative to the original timing (0 = as fast as possible)
+  double speed{0.0};
+
+  uint32_t flags{0};
+  uint32_t num_symbols{0}; // 0 = all symbols
+  uint32_t symbols[kMaxSymbols]{};
+};
+
+// Final frame of every replay; data frames are whole MarketMessages, so this
+// frame is told apart by its size
+struct ReplayEnd {
+  enum Status : uint32_t { Ok = 0, BadRequest = 1, Failed = 2 };
+
+  uint64_t messages{0};
+  uint32_t status{Ok};
+  uint32_t reserved{0};
+};
+
+static_assert(sizeof(ReplayEnd) % sizeof(MarketMessage) != 0,
+              "ReplayEnd must be distinguishable from data frames");
+
+// Serves stored ticks back to clients. Unpaced, unmerged replays are sent as
+// large frames that point straight into the mmap'd tick files (zmq zero-copy
+// messages), one symbol range after another. Paced or merged replays go
+// through a TickReader and are batched per send, as are replays of
+// fixed-point sessions: clients always receive double prices, as from
+// TickPublisher. Sessions are served round-robin so a slow client only
+// stalls itself.
+class ReplayServer {
+public:
+  struct Config {
+    std::string bind_address;
+    std::string data_dir;
+
+    size_t chunk_bytes{4 * 1024 * 1024}; // Payload per data frame
+    int send_hwm{64};                    // Frames queued per client
+    int send_buffer{8 * 1024 * 1024};    // Kernel socket send buffer
+  };
+
+  struct Stats {
+    uint64_t requests{0};
+    uint64_t messages_sent{0};
+    uint64_t bytes_sent{0};
+    uint64_t active_sessions{0};
+  };
+
+  explicit ReplayServer(const Config &config);
+  ~ReplayServer();
+
+  // Non-copyable
+  ReplayServer(const ReplayServer &) = delete;
+  ReplayServer &operator=(const ReplayServer &) = delete;
+
+  void start();
+  void stop();
+
+  Stats get_stats() const;
+
+private:
+  struct Range {
+    std::shared_ptr<const MappedTickFile> file;
+    const MarketMessage *pos;
+    const MarketMessage *end;
+  };
+
+  struct Session {
+    std::string identity;
+    ReplayRequest request;
+
+    // Zero-copy path: contiguous per-symbol ranges
+    std::deque<Range> ranges;
+
+    // Merged / paced path
+    std::unique_ptr<TickReader> reader;
+    const MarketMessage *pending{nullptr};
+    std::vector<MarketMessage> batch;
+    std::chrono::steady_clock::time_point started;
+    uint64_t first_timestamp{0};
+
+    uint64_t messages_sent{0};
+    // A rejected request's status, until its end frame has been sent
+    ReplayEnd::Status error{ReplayEnd::Ok};
+  };
+
+  enum class SendResult { Sent, WouldBlock, Gone };
+
+  void run();
+  void accept_request(const std::string &identity, const void *data,
+                      size_t size);
+  // Send the next chunk of a session; returns false once it has finished
+  bool pump(Session &session, bool &progressed);
+  bool pump_ranges(Session &session, bool &progressed);
+  bool pump_reader(Session &session, bool &progressed);
+  bool finish(Session &session, ReplayEnd::Status status);
+  // End a session before it started, sending status once the client can
+  // take it
+  void reject(Session session, ReplayEnd::Status status);
+  SendResult send(const std::string &identity, zmq_msg_t &payload);
+
+  Config config_;
+  void *context_;
+  void *router_;
+
+  std::atomic<bool> running_{false};
+  std::thread server_thread_;
+  std::deque<Session> sessions_;
+
+  // Statistics
+  std::atomic<uint64_t> requests_{0};
+  std::atomic<uint64_t> messages_sent_{0};
+  std::atomic<uint64_t> bytes_sent_{0};
+  std::atomic<uint64_t> active_sessions_{0};
+};
+
+} // namespace tick_capture
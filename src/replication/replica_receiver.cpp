@@ -0,0 +1,283 @@
+#include "replica_receiver.hpp"
+#include "../metrics/thread_stats.hpp"
+#include "../storage/block_checksum.hpp"
+#include "../storage/crc32c.hpp"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <fmt/format.h>
+#include <fstream>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+#include <zmq.h>
+
+namespace tick_capture {
+
+ReplicaReceiver::ReplicaReceiver(const Config &config,
+                                 MetricsRegistry *metrics,
+                                 const std::string &metrics_prefix)
+    : config_(config) {
+  std::filesystem::create_directories(config_.directory);
+
+  context_ = zmq_ctx_new();
+  if (!context_) {
+    throw std::runtime_error("Failed to create ZMQ context");
+  }
+
+  router_ = zmq_socket(context_, ZMQ_ROUTER);
+  if (!router_) {
+    zmq_ctx_destroy(context_);
+    throw std::runtime_error("Failed to create replica socket");
+  }
+  const int linger = 0;
+  zmq_setsockopt(router_, ZMQ_LINGER, &linger, sizeof(linger));
+
+  if (zmq_bind(router_, config_.bind_address.c_str()) != 0) {
+    zmq_close(router_);
+    zmq_ctx_destroy(context_);
+    throw std::runtime_error(fmt::format("Failed to bind replica receiver: {}",
+                                         zmq_strerror(errno)));
+  }
+
+  if (metrics) {
+    bytes_counter_ = &metrics->counter(metrics_prefix + "bytes");
+    chunks_counter_ = &metrics->counter(metrics_prefix + "chunks");
+    resyncs_counter_ = &metrics->counter(metrics_prefix + "resyncs");
+    bad_checksums_counter_ =
+        &metrics->counter(metrics_prefix + "bad_checksums");
+  }
+}
+
+ReplicaReceiver::~ReplicaReceiver() {
+  stop();
+
+  if (router_)
+    zmq_close(router_);
+  if (context_)
+    zmq_ctx_destroy(context_);
+}
+
+void ReplicaReceiver::start() {
+  if (running_)
+    return;
+  running_ = true;
+  thread_ = std::thread([this] {
+    set_thread_name("replica");
+    run();
+  });
+}
+
+void ReplicaReceiver::stop() {
+  if (!running_)
+    return;
+  running_ = false;
+
+  if (thread_.joinable())
+    thread_.join();
+}
+
+void ReplicaReceiver::run() {
+  zmq_pollitem_t items[] = {{router_, 0, ZMQ_POLLIN, 0}};
+
+  while (running_) {
+    if (zmq_poll(items, 1, 100) <= 0 || !(items[0].revents & ZMQ_POLLIN))
+      continue;
+
+    zmq_msg_t identity, header, payload;
+    zmq_msg_init(&identity);
+    zmq_msg_init(&header);
+    zmq_msg_init(&payload);
+
+    if (zmq_msg_recv(&identity, router_, ZMQ_DONTWAIT) >= 0 &&
+        zmq_msg_more(&identity) && zmq_msg_recv(&header, router_, 0) >= 0) {
+      bool more = zmq_msg_more(&header);
+      if (more && zmq_msg_recv(&payload, router_, 0) >= 0) {
+        more = zmq_msg_more(&payload);
+      }
+      // Frames past the payload are not part of the protocol
+      while (more) {
+        zmq_msg_t extra;
+        zmq_msg_init(&extra);
+        more = zmq_msg_recv(&extra, router_, 0) >= 0 && zmq_msg_more(&extra);
+        zmq_msg_close(&extra);
+      }
+
+      ShipReply reply;
+      if (zmq_msg_size(&header) == sizeof(ShipRequest)) {
+        ShipRequest request;
+        std::memcpy(&request, zmq_msg_data(&header), sizeof(request));
+        reply = handle(request, zmq_msg_data(&payload),
+                       zmq_msg_size(&payload));
+        reply.request_id = request.request_id;
+      } else {
+        fmt::print(stderr, "Invalid replication request size: {} bytes\n",
+                   zmq_msg_size(&header));
+        reply.status = ShipReply::Failed;
+      }
+
+      zmq_send(router_, zmq_msg_data(&identity), zmq_msg_size(&identity),
+               ZMQ_SNDMORE);
+      zmq_send(router_, &reply, sizeof(reply), 0);
+    }
+
+    zmq_msg_close(&payload);
+    zmq_msg_close(&header);
+    zmq_msg_close(&identity);
+  }
+}
+
+ShipReply ReplicaReceiver::handle(const ShipRequest &request,
+                                  const void *payload, size_t payload_size) {
+  requests_++;
+  ShipReply reply;
+  try {
+    const auto path = resolve(request);
+    const uint64_t size = std::filesystem::exists(path)
+                              ? std::filesystem::file_size(path)
+                              : 0;
+
+    if (request.type == ShipRequest::Query) {
+      // Let the shipper check that this is a copy of its file
+      std::vector<char> head(
+          static_cast<size_t>(std::min<uint64_t>(size, kChecksumBlockBytes)));
+      std::ifstream file(path, std::ios::binary);
+      file.read(head.data(), static_cast<std::streamsize>(head.size()));
+      reply.size = size;
+      reply.head = head.size();
+      reply.head_crc = crc32c(head.data(), head.size());
+      return reply;
+    }
+
+    if (payload_size != request.length ||
+        crc32c(payload, payload_size) != request.crc) {
+      bad_checksums_++;
+      if (bad_checksums_counter_)
+        bad_checksums_counter_->add();
+      reply.status = ShipReply::BadChecksum;
+      reply.size = size;
+      return reply;
+    }
+
+    std::filesystem::create_directories(path.parent_path());
+    if (request.type == ShipRequest::Replace) {
+      // Readers see the old or the new file, never a mix
+      auto temporary = path;
+      temporary += ".tmp";
+      {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        file.write(static_cast<const char *>(payload),
+                   static_cast<std::streamsize>(payload_size));
+        if (!file) {
+          throw std::runtime_error("Write failed");
+        }
+      }
+      std::filesystem::rename(temporary, path);
+      reply.size = payload_size;
+      return reply;
+    }
+    if (request.type == ShipRequest::Chunk) {
+      return write_chunk(path, request, payload);
+    }
+    throw std::runtime_error(fmt::format("Unknown type {}", request.type));
+  } catch (const std::exception &e) {
+    fmt::print(stderr, "Replication request for {} failed: {}\n",
+               std::string(request.path,
+                           strnlen(request.path, ShipRequest::kMaxPath)),
+               e.what());
+    reply.status = ShipReply::Failed;
+    return reply;
+  }
+}
+
+ShipReply ReplicaReceiver::write_chunk(const std::filesystem::path &path,
+                                       const ShipRequest &request,
+                                       const void *payload) {
+  const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    throw std::runtime_error(
+        fmt::format("Failed to open: {}", std::strerror(errno)));
+  }
+
+  struct stat st {};
+  ::fstat(fd, &st);
+  ShipReply reply;
+  reply.size = static_cast<uint64_t>(st.st_size);
+
+  const bool truncate = request.flags & ShipRequest::kTruncate;
+  if (truncate && request.offset <= reply.size) {
+    if (::ftruncate(fd, static_cast<off_t>(request.offset)) != 0) {
+      const int err = errno;
+      ::close(fd);
+      throw std::runtime_error(
+          fmt::format("Failed to truncate: {}", std::strerror(err)));
+    }
+    reply.size = request.offset;
+  }
+
+  // Only appends keep the replica a prefix of its source
+  if (request.offset != reply.size) {
+    ::close(fd);
+    resyncs_++;
+    if (resyncs_counter_)
+      resyncs_counter_->add();
+    reply.status = ShipReply::Resync;
+    return reply;
+  }
+
+  const auto *data = static_cast<const char *>(payload);
+  for (uint64_t written = 0; written < request.length;) {
+    const ssize_t n = ::pwrite(fd, data + written, request.length - written,
+                               static_cast<off_t>(request.offset + written));
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      const int err = errno;
+      // Drop a partial write so the file stays a prefix
+      [[maybe_unused]] const int truncated =
+          ::ftruncate(fd, static_cast<off_t>(request.offset));
+      ::close(fd);
+      throw std::runtime_error(
+          fmt::format("Write failed: {}", std::strerror(err)));
+    }
+    written += static_cast<uint64_t>(n);
+  }
+  ::close(fd);
+
+  reply.size = request.offset + request.length;
+  bytes_ += request.length;
+  chunks_++;
+  if (bytes_counter_)
+    bytes_counter_->add(request.length);
+  if (chunks_counter_)
+    chunks_counter_->add();
+  return reply;
+}
+
+std::filesystem::path
+ReplicaReceiver::resolve(const ShipRequest &request) const {
+  const std::string shipped(request.path,
+                            strnlen(request.path, ShipRequest::kMaxPath));
+  const std::filesystem::path relative(shipped);
+  bool valid = !shipped.empty() && shipped.size() < ShipRequest::kMaxPath &&
+               relative.is_relative();
+  for (const auto &part : relative) {
+    valid = valid && !part.empty() && part != "." && part != "..";
+  }
+  if (!valid) {
+    throw std::runtime_error("Invalid replica path");
+  }
+  return config_.directory / relative;
+}
+
+ReplicaReceiver::Stats ReplicaReceiver::get_stats() const {
+  Stats stats;
+  stats.requests = requests_;
+  stats.bytes = bytes_;
+  stats.chunks = chunks_;
+  stats.resyncs = resyncs_;
+  stats.bad_checksums = bad_checksums_;
+  return stats;
+}
+
+} // namespace tick_capture
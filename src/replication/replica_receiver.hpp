@@ -0,0 +1,79 @@
+#pragma once
+#include "../metrics/metrics_registry.hpp"
+#include "segment_shipper.hpp"
+#include <atomic>
+#include <filesystem>
+#include <string>
+#include <thread>
+
+namespace tick_capture {
+
+// Receiving end of SegmentShipper: stores the files shipped by peers under
+// directory, one subdirectory per shipped source. A chunk is written only
+// if its CRC-32C matches and it starts at the replica's current size, so
+// a file is always a prefix of its source; anything else is answered with
+// the size to resume from. Requests are served one at a time on a single
+// thread.
+//
+// Counters, if a registry is given: <metrics_prefix>bytes, chunks,
+// resyncs and bad_checksums.
+class ReplicaReceiver {
+public:
+  struct Config {
+    std::string bind_address;
+    std::filesystem::path directory;
+  };
+
+  struct Stats {
+    uint64_t requests{0};
+    uint64_t bytes{0};
+    uint64_t chunks{0};
+    uint64_t resyncs{0};
+    uint64_t bad_checksums{0};
+  };
+
+  explicit ReplicaReceiver(const Config &config,
+                           MetricsRegistry *metrics = nullptr,
+                           const std::string &metrics_prefix = "replica.");
+  ~ReplicaReceiver();
+
+  // Non-copyable
+  ReplicaReceiver(const ReplicaReceiver &) = delete;
+  ReplicaReceiver &operator=(const ReplicaReceiver &) = delete;
+
+  void start();
+  void stop();
+
+  Stats get_stats() const;
+
+private:
+  void run();
+  ShipReply handle(const ShipRequest &request, const void *payload,
+                   size_t payload_size);
+  ShipReply write_chunk(const std::filesystem::path &path,
+                        const ShipRequest &request, const void *payload);
+  // Where a shipped path is stored; throws for one that would leave
+  // directory
+  std::filesystem::path resolve(const ShipRequest &request) const;
+
+  Config config_;
+  void *context_;
+  void *router_;
+
+  MetricsRegistry::Counter *bytes_counter_{nullptr};
+  MetricsRegistry::Counter *chunks_counter_{nullptr};
+  MetricsRegistry::Counter *resyncs_counter_{nullptr};
+  MetricsRegistry::Counter *bad_checksums_counter_{nullptr};
+
+  std::atomic<bool> running_{false};
+  std::thread thread_;
+
+  // Statistics
+  std::atomic<uint64_t> requests_{0};
+  std::atomic<uint64_t> bytes_{0};
+  std::atomic<uint64_t> chunks_{0};
+  std::atomic<uint64_t> resyncs_{0};
+  std::atomic<uint64_t> bad_checksums_{0};
+};
+
+} // namespace tick_capture
@@ -0,0 +1,402 @@
+#include "segment_shipper.hpp"
+#include "../metrics/thread_stats.hpp"
+#include "../storage/block_checksum.hpp"
+#include "../storage/crc32c.hpp"
+#include "../storage/session_meta.hpp"
+#include "../storage/tick_file.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fmt/format.h>
+#include <fstream>
+#include <zmq.h>
+
+namespace tick_capture {
+
+namespace {
+
+void set_path(ShipRequest &request, const std::string &remote_path) {
+  if (remote_path.size() >= ShipRequest::kMaxPath) {
+    throw std::runtime_error(
+        fmt::format("Replica path too long: {}", remote_path));
+  }
+  std::memset(request.path, 0, sizeof(request.path));
+  std::memcpy(request.path, remote_path.data(), remote_path.size());
+}
+
+// Read up to length bytes at offset; the number read
+size_t read_at(std::ifstream &file, char *buffer, size_t length,
+               uint64_t offset) {
+  file.clear();
+  file.seekg(static_cast<std::streamoff>(offset));
+  file.read(buffer, static_cast<std::streamsize>(length));
+  return static_cast<size_t>(file.gcount());
+}
+
+} // namespace
+
+SegmentShipper::SegmentShipper(const Config &config, MetricsRegistry *metrics,
+                               const std::string &metrics_prefix)
+    : config_(config), context_(zmq_ctx_new()),
+      buffer_(std::max<size_t>(config.chunk_bytes, 4096)) {
+  if (!context_) {
+    throw std::runtime_error("Failed to create ZMQ context");
+  }
+  try {
+    reconnect();
+  } catch (...) {
+    zmq_ctx_destroy(context_);
+    throw;
+  }
+
+  if (metrics) {
+    bytes_counter_ = &metrics->counter(metrics_prefix + "bytes");
+    chunks_counter_ = &metrics->counter(metrics_prefix + "chunks");
+    resyncs_counter_ = &metrics->counter(metrics_prefix + "resyncs");
+    retries_counter_ = &metrics->counter(metrics_prefix + "retries");
+    lag_gauge_ = &metrics->counter(metrics_prefix + "lag_bytes");
+  }
+}
+
+SegmentShipper::~SegmentShipper() {
+  stop();
+
+  if (socket_)
+    zmq_close(socket_);
+  zmq_ctx_destroy(context_);
+}
+
+void SegmentShipper::reconnect() {
+  // A fresh socket also discards requests queued for an unresponsive peer
+  if (socket_)
+    zmq_close(socket_);
+
+  socket_ = zmq_socket(context_, ZMQ_DEALER);
+  if (!socket_) {
+    throw std::runtime_error("Failed to create replication socket");
+  }
+  // Queue requests only once the peer is connected
+  const int linger = 0;
+  const int immediate = 1;
+  zmq_setsockopt(socket_, ZMQ_LINGER, &linger, sizeof(linger));
+  zmq_setsockopt(socket_, ZMQ_IMMEDIATE, &immediate, sizeof(immediate));
+  if (zmq_connect(socket_, config_.peer_address.c_str()) != 0) {
+    throw std::runtime_error(
+        fmt::format("Failed to connect to replica {}: {}",
+                    config_.peer_address, zmq_strerror(errno)));
+  }
+}
+
+void SegmentShipper::start() {
+  if (running_)
+    return;
+  stop_requested_ = false;
+  running_ = true;
+  thread_ = std::thread([this] {
+    set_thread_name("replication");
+    lower_thread_priority();
+    run();
+  });
+}
+
+void SegmentShipper::stop() {
+  {
+    std::lock_guard<std::mutex> lock(stop_mutex_);
+    if (!running_)
+      return;
+    running_ = false;
+    stop_requested_ = true;
+  }
+  stop_cv_.notify_all();
+
+  if (thread_.joinable())
+    thread_.join();
+}
+
+void SegmentShipper::run() {
+  while (running_) {
+    if (!ship_all() && !stop_requested_) {
+      fmt::print(stderr, "Replica {} is not answering\n",
+                 config_.peer_address);
+    }
+
+    std::unique_lock<std::mutex> lock(stop_mutex_);
+    stop_cv_.wait_for(lock, config_.poll_interval,
+                      [this] { return !running_; });
+  }
+}
+
+bool SegmentShipper::ship_all() {
+  lag_bytes_ = 0;
+
+  for (const auto &source : config_.sources) {
+    if (!std::filesystem::is_directory(source.directory))
+      continue;
+
+    const auto meta = source.directory / SessionMeta::kFileName;
+    if (std::filesystem::exists(meta) &&
+        !ship_whole(source.name + "/" + SessionMeta::kFileName, meta)) {
+      return false;
+    }
+
+    for (const auto &path : MappedTickFile::list(source.directory)) {
+      if (stop_requested_)
+        return false;
+      try {
+        const auto blocks = load_block_checksums(path);
+        uint64_t sealed = 0;
+        for (const auto &block : blocks) {
+          sealed += block.length;
+        }
+        uint64_t limit = sealed;
+        if (config_.ship_unsealed) {
+          const uint64_t size = std::filesystem::file_size(path);
+          limit = std::max(limit, size - size % sizeof(MarketMessage));
+        }
+
+        const auto remote_path = source.name + "/" + path.filename().string();
+        if (!ship_range(remote_path, path, limit))
+          return false;
+
+        // Checksums follow the data they cover, so a replica never has
+        // checksums for bytes it does not hold
+        const uint64_t shipped = remotes_[remote_path].size;
+        size_t covered_blocks = 0;
+        uint64_t covered = 0;
+        while (covered_blocks < blocks.size() &&
+               covered + blocks[covered_blocks].length <= shipped) {
+          covered += blocks[covered_blocks++].length;
+        }
+        const auto checksums = checksum_path(path);
+        if (std::filesystem::exists(checksums) &&
+            !ship_range(source.name + "/" + checksums.filename().string(),
+                        checksums,
+                        kChecksumHeaderBytes +
+                            covered_blocks * sizeof(BlockChecksum))) {
+          return false;
+        }
+      } catch (const std::exception &e) {
+        fmt::print(stderr, "Replication of {} failed: {}\n", path.string(),
+                   e.what());
+      }
+    }
+  }
+
+  ++passes_;
+  lag_ = lag_bytes_;
+  if (lag_gauge_)
+    lag_gauge_->set(lag_bytes_);
+  return true;
+}
+
+bool SegmentShipper::ship_range(const std::string &remote_path,
+                                const std::filesystem::path &path,
+                                uint64_t limit) {
+  Remote *remote = query(remote_path, path);
+  if (!remote)
+    return false;
+
+  std::ifstream file;
+  while ((remote->size < limit || remote->truncate) && !stop_requested_) {
+    if (!file.is_open()) {
+      file.open(path, std::ios::binary);
+      if (!file) {
+        throw std::runtime_error("Failed to open the file");
+      }
+    }
+
+    const uint64_t offset = remote->size;
+    const size_t length = read_at(
+        file, buffer_.data(),
+        static_cast<size_t>(std::min<uint64_t>(limit - offset, buffer_.size())),
+        offset);
+    if (length == 0 && !remote->truncate) {
+      // The file shrank under us: check the replica's head again next pass
+      remotes_.erase(remote_path);
+      return true;
+    }
+
+    ShipRequest request;
+    request.type = ShipRequest::Chunk;
+    request.flags = remote->truncate ? ShipRequest::kTruncate : 0;
+    request.offset = offset;
+    request.length = length;
+    request.crc = crc32c(buffer_.data(), length);
+    set_path(request, remote_path);
+
+    ShipReply reply;
+    if (!exchange(request, buffer_.data(), reply))
+      return false;
+
+    switch (reply.status) {
+    case ShipReply::Ok:
+      remote->size = reply.size;
+      remote->truncate = false;
+      bytes_ += length;
+      ++chunks_;
+      if (bytes_counter_)
+        bytes_counter_->add(length);
+      if (chunks_counter_)
+        chunks_counter_->add();
+      throttle(length);
+      break;
+    case ShipReply::Resync:
+      remote->size = reply.size;
+      ++resyncs_;
+      if (resyncs_counter_)
+        resyncs_counter_->add();
+      break;
+    case ShipReply::BadChecksum:
+      ++retries_;
+      if (retries_counter_)
+        retries_counter_->add();
+      break;
+    default:
+      throw std::runtime_error(
+          fmt::format("Replica failed to write {}", remote_path));
+    }
+  }
+
+  if (limit > remote->size)
+    lag_bytes_ += limit - remote->size;
+  return true;
+}
+
+bool SegmentShipper::ship_whole(const std::string &remote_path,
+                                const std::filesystem::path &path) {
+  const auto modified = std::filesystem::last_write_time(path);
+  const auto it = shipped_meta_.find(remote_path);
+  if (it != shipped_meta_.end() && it->second == modified)
+    return true;
+
+  std::ifstream file(path, std::ios::binary);
+  const std::string contents((std::istreambuf_iterator<char>(file)),
+                             std::istreambuf_iterator<char>());
+
+  ShipRequest request;
+  request.type = ShipRequest::Replace;
+  request.length = contents.size();
+  request.crc = crc32c(contents.data(), contents.size());
+  set_path(request, remote_path);
+
+  ShipReply reply;
+  if (!exchange(request, contents.data(), reply))
+    return false;
+  if (reply.status != ShipReply::Ok) {
+    fmt::print(stderr, "Replica refused {}\n", remote_path);
+    return true;
+  }
+  shipped_meta_[remote_path] = modified;
+  return true;
+}
+
+SegmentShipper::Remote *
+SegmentShipper::query(const std::string &remote_path,
+                      const std::filesystem::path &path) {
+  const auto it = remotes_.find(remote_path);
+  if (it != remotes_.end())
+    return &it->second;
+
+  ShipRequest request;
+  request.type = ShipRequest::Query;
+  set_path(request, remote_path);
+  ShipReply reply;
+  if (!exchange(request, nullptr, reply))
+    return nullptr;
+  if (reply.status != ShipReply::Ok) {
+    throw std::runtime_error(
+        fmt::format("Replica refused {}", remote_path));
+  }
+
+  // The replica must hold a prefix of the local file; one that does not
+  // is left from an earlier session and is rewritten
+  Remote remote{reply.size, false};
+  if (reply.size > 0) {
+    std::ifstream file(path, std::ios::binary);
+    std::vector<char> head(reply.head);
+    const bool same_head =
+        std::filesystem::file_size(path) >= reply.size &&
+        read_at(file, head.data(), head.size(), 0) == head.size() &&
+        crc32c(head.data(), head.size()) == reply.head_crc;
+    if (!same_head) {
+      fmt::print("Replica of {} is from another session, rewriting it\n",
+                 path.string());
+      remote = {0, true};
+    }
+  }
+  return &remotes_.emplace(remote_path, remote).first->second;
+}
+
+bool SegmentShipper::exchange(ShipRequest &request, const void *payload,
+                              ShipReply &reply) {
+  using namespace std::chrono;
+  request.request_id = next_request_id_++;
+  const bool has_payload = request.type != ShipRequest::Query;
+  const auto deadline = steady_clock::now() + config_.reply_timeout;
+
+  const auto timed_out = [&] {
+    if (stop_requested_)
+      return true;
+    if (steady_clock::now() < deadline)
+      return false;
+    // Start over with a clean connection and re-ask the replica's sizes
+    ++retries_;
+    if (retries_counter_)
+      retries_counter_->add();
+    remotes_.clear();
+    reconnect();
+    return true;
+  };
+
+  // Sending blocks while the peer is unreachable
+  while (zmq_send(socket_, &request, sizeof(request),
+                  ZMQ_DONTWAIT | (has_payload ? ZMQ_SNDMORE : 0)) < 0) {
+    if (errno != EAGAIN || timed_out())
+      return false;
+    std::this_thread::sleep_for(milliseconds(10));
+  }
+  if (has_payload) {
+    zmq_send(socket_, payload, request.length, 0);
+  }
+
+  zmq_pollitem_t items[] = {{socket_, 0, ZMQ_POLLIN, 0}};
+  while (!timed_out()) {
+    if (zmq_poll(items, 1, 100) <= 0)
+      continue;
+    // Replies to requests given up on are dropped
+    const int size = zmq_recv(socket_, &reply, sizeof(reply), ZMQ_DONTWAIT);
+    if (size == static_cast<int>(sizeof(reply)) &&
+        reply.request_id == request.request_id) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void SegmentShipper::throttle(uint64_t bytes) {
+  if (config_.bytes_per_second == 0)
+    return;
+
+  // Time spent idle is not made up for with a burst of sends
+  const auto now = std::chrono::steady_clock::now();
+  if (next_send_ < now)
+    next_send_ = now;
+  next_send_ += std::chrono::nanoseconds(bytes * 1'000'000'000 /
+                                         config_.bytes_per_second);
+
+  std::unique_lock<std::mutex> lock(stop_mutex_);
+  stop_cv_.wait_until(lock, next_send_,
+                      [this] { return stop_requested_.load(); });
+}
+
+SegmentShipper::Stats SegmentShipper::get_stats() const {
+  Stats stats;
+  stats.passes = passes_;
+  stats.bytes = bytes_;
+  stats.chunks = chunks_;
+  stats.resyncs = resyncs_;
+  stats.retries = retries_;
+  stats.lag_bytes = lag_;
+  return stats;
+}
+
+} // namespace tick_capture
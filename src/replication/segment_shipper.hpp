@@ -0,0 +1,171 @@
+#pragma once
+#include "../metrics/metrics_registry.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace tick_capture {
+
+// Frame sent by a shipper over a ZMQ DEALER socket to a ReplicaReceiver's
+// ROUTER, followed by a payload frame for Chunk and Replace
+struct ShipRequest {
+  enum Type : uint32_t {
+    Query = 1,   // Report the replica's size of path
+    Chunk = 2,   // Write the payload at offset
+    Replace = 3, // Make the payload the whole file
+  };
+
+  // Chunk flags
+  static constexpr uint32_t kTruncate = 1; // Discard the replica from offset
+
+  static constexpr size_t kMaxPath = 128;
+
+  uint64_t request_id{0}; // Echoed in the reply
+  uint32_t type{Query};
+  uint32_t flags{0};
+  uint64_t offset{0};
+  uint64_t length{0}; // Payload bytes
+  uint32_t crc{0};    // CRC-32C of the payload
+  uint32_t reserved{0};
+  char path[kMaxPath]{}; // "<source>/<file name>", relative to the replica
+};
+
+// Reply to every ShipRequest
+struct ShipReply {
+  enum Status : uint32_t {
+    Ok = 0,
+    Resync = 1,      // offset was not the replica's size; resume from size
+    BadChecksum = 2, // Payload damaged in transit; send it again
+    Failed = 3,
+  };
+
+  uint64_t request_id{0};
+  uint32_t status{Ok};
+  uint32_t head_crc{0}; // Query: CRC-32C of the replica's first head bytes
+  uint64_t size{0};     // Replica's size of the file after the request
+  uint64_t head{0};     // Query: bytes covered by head_crc
+};
+
+// Ships stored tick files to a peer running a ReplicaReceiver, so losing
+// this node's disk does not lose the data. Each source directory becomes
+// "<name>/" on the replica, holding the tick files, their block checksum
+// sidecars and session.meta: a capture directory that readers, replay and
+// the scrubber can use as it is, or that can be copied back.
+//
+// Sealed blocks are shipped, or with ship_unsealed every whole record
+// written so far. Files only grow, so a file is shipped as a sequence of
+// chunks appended at the replica's current size; each chunk carries a
+// CRC-32C and is acknowledged before the next is sent. The replica's size
+// is asked for on first contact, so either side can restart and resume
+// where the replica left off, and a replica whose head no longer matches
+// the local file (the source started a new session) is rewritten.
+//
+// One thread at idle CPU and I/O priority does the shipping, at no more
+// than bytes_per_second, and sleeps for poll_interval once caught up.
+// Replication is asynchronous: the replica lags by up to one pass.
+//
+// Counters, if a registry is given: <metrics_prefix>bytes, chunks,
+// resyncs, retries and lag_bytes (unshipped after the last pass).
+class SegmentShipper {
+public:
+  struct Source {
+    std::string name;
+    std::filesystem::path directory;
+  };
+
+  struct Config {
+    std::string peer_address; // ReplicaReceiver endpoint
+    std::vector<Source> sources;
+    bool ship_unsealed{false};
+    size_t chunk_bytes{1024 * 1024};
+    uint64_t bytes_per_second{32 * 1024 * 1024}; // 0 = unthrottled
+    std::chrono::milliseconds poll_interval{1000};
+    std::chrono::milliseconds reply_timeout{5000};
+  };
+
+  struct Stats {
+    uint64_t passes{0};
+    uint64_t bytes{0};
+    uint64_t chunks{0};
+    uint64_t resyncs{0};
+    uint64_t retries{0}; // Chunks sent again after a bad checksum or timeout
+    uint64_t lag_bytes{0};
+  };
+
+  explicit SegmentShipper(const Config &config,
+                          MetricsRegistry *metrics = nullptr,
+                          const std::string &metrics_prefix = "replication.");
+  ~SegmentShipper();
+
+  // Non-copyable
+  SegmentShipper(const SegmentShipper &) = delete;
+  SegmentShipper &operator=(const SegmentShipper &) = delete;
+
+  void start();
+  void stop();
+
+  // Ship everything shippable now on the calling thread; false if the peer
+  // did not answer. Not to be mixed with start().
+  bool ship_all();
+
+  Stats get_stats() const;
+
+private:
+  // Replica's copy of one file, as far as we know
+  struct Remote {
+    uint64_t size{0};
+    bool truncate{false}; // Rewrite from size, discarding the rest
+  };
+
+  void run();
+  // Ship [replica size, limit) of path; false if the peer did not answer
+  bool ship_range(const std::string &remote_path,
+                  const std::filesystem::path &path, uint64_t limit);
+  bool ship_whole(const std::string &remote_path,
+                  const std::filesystem::path &path);
+  Remote *query(const std::string &remote_path,
+                const std::filesystem::path &path);
+  // Send a request and wait for its reply; false on timeout or stop
+  bool exchange(ShipRequest &request, const void *payload, ShipReply &reply);
+  void reconnect();
+  void throttle(uint64_t bytes);
+
+  Config config_;
+  void *context_;
+  void *socket_{nullptr};
+  uint64_t next_request_id_{1};
+  std::vector<char> buffer_; // One chunk
+
+  std::map<std::string, Remote> remotes_;
+  std::map<std::string, std::filesystem::file_time_type> shipped_meta_;
+  uint64_t lag_bytes_{0}; // This pass
+
+  MetricsRegistry::Counter *bytes_counter_{nullptr};
+  MetricsRegistry::Counter *chunks_counter_{nullptr};
+  MetricsRegistry::Counter *resyncs_counter_{nullptr};
+  MetricsRegistry::Counter *retries_counter_{nullptr};
+  MetricsRegistry::Counter *lag_gauge_{nullptr};
+
+  std::chrono::steady_clock::time_point next_send_{};
+
+  std::atomic<uint64_t> passes_{0};
+  std::atomic<uint64_t> bytes_{0};
+  std::atomic<uint64_t> chunks_{0};
+  std::atomic<uint64_t> resyncs_{0};
+  std::atomic<uint64_t> retries_{0};
+  std::atomic<uint64_t> lag_{0};
+
+  std::atomic<bool> running_{false};
+  std::atomic<bool> stop_requested_{false}; // Also ends a ship_all call
+  std::thread thread_;
+  std::mutex stop_mutex_;
+  std::condition_variable stop_cv_;
+};
+
+} // namespace tick_capture
@@ -0,0 +1,157 @@
+#include "block_checksum.hpp"
+#include "crc32c.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <fmt/format.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+namespace tick_capture {
+
+namespace {
+
+struct SidecarHeader {
+  uint32_t magic;
+  uint32_t block_bytes; // Length of a full block when written
+};
+
+constexpr uint32_t kSidecarMagic = 0x43524354; // "TCRC"
+
+static_assert(sizeof(SidecarHeader) == kChecksumHeaderBytes);
+
+} // namespace
+
+std::filesystem::path checksum_path(const std::filesystem::path &tick_path) {
+  auto path = tick_path;
+  return path.replace_extension(".crc");
+}
+
+std::vector<BlockChecksum>
+load_block_checksums(const std::filesystem::path &tick_path) {
+  std::vector<BlockChecksum> blocks;
+  std::ifstream file(checksum_path(tick_path), std::ios::binary);
+  if (!file) {
+    return blocks;
+  }
+
+  SidecarHeader header{};
+  if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+      header.magic != kSidecarMagic) {
+    throw std::runtime_error(fmt::format("Invalid block checksum file: {}",
+                                         checksum_path(tick_path).string()));
+  }
+
+  BlockChecksum block{};
+  while (file.read(reinterpret_cast<char *>(&block), sizeof(block))) {
+    blocks.push_back(block);
+  }
+  return blocks;
+}
+
+BlockChecksumWriter::~BlockChecksumWriter() {
+  seal();
+  if (lock_fd_ >= 0) {
+    ::close(lock_fd_);
+  }
+}
+
+void BlockChecksumWriter::open(const char *tick_path, bool append,
+                               char *buffer, size_t buffer_size) {
+  const auto path = checksum_path(tick_path);
+  file_.rdbuf()->pubsetbuf(buffer, static_cast<std::streamsize>(buffer_size));
+  crc_ = 0;
+  pending_ = 0;
+
+  if (lock_fd_ < 0) {
+    lock_fd_ = ::open(tick_path, O_RDONLY | O_CLOEXEC);
+    if (lock_fd_ < 0 || ::flock(lock_fd_, LOCK_SH) != 0) {
+      throw std::runtime_error(fmt::format("Failed to lock {}: {}", tick_path,
+                                           std::strerror(errno)));
+    }
+  }
+
+  // A sidecar without a whole header was never written to
+  if (!append || !std::filesystem::exists(path) ||
+      std::filesystem::file_size(path) < sizeof(SidecarHeader)) {
+    file_.open(path, std::ios::binary | std::ios::trunc);
+    const SidecarHeader header{kSidecarMagic, kChecksumBlockBytes};
+    file_.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  } else {
+    // Drop an entry cut short mid-append before adding to the file
+    const auto blocks = load_block_checksums(tick_path);
+    std::filesystem::resize_file(path, sizeof(SidecarHeader) +
+                                           blocks.size() *
+                                               sizeof(BlockChecksum));
+    file_.open(path, std::ios::binary | std::ios::app);
+
+    uint64_t covered = 0;
+    for (const auto &block : blocks) {
+      covered += block.length;
+    }
+    const uint64_t size = std::filesystem::exists(tick_path)
+                              ? std::filesystem::file_size(tick_path)
+                              : 0;
+    if (size < covered) {
+      throw std::runtime_error(fmt::format(
+          "{} is shorter than its block checksums ({} < {} bytes)", tick_path,
+          size, covered));
+    }
+
+    // Seal what an earlier writer left, so new blocks start at our data
+    std::ifstream tick_file(tick_path, std::ios::binary);
+    tick_file.seekg(static_cast<std::streamoff>(covered));
+    std::vector<char> data(kChecksumBlockBytes);
+    for (uint64_t left = size - covered; left > 0;) {
+      const auto length = static_cast<uint32_t>(
+          std::min<uint64_t>(left, kChecksumBlockBytes));
+      if (!tick_file.read(data.data(), length)) {
+        throw std::runtime_error(
+            fmt::format("Failed to read {} to seal it", tick_path));
+      }
+      write_block(length, crc32c(data.data(), length));
+      left -= length;
+    }
+  }
+
+  if (!file_) {
+    throw std::runtime_error(
+        fmt::format("Failed to open block checksum file: {}", path.string()));
+  }
+  file_.flush();
+}
+
+void BlockChecksumWriter::update(const void *data, size_t size) {
+  const auto *bytes = static_cast<const char *>(data);
+  while (size > 0) {
+    const size_t length =
+        std::min<size_t>(size, kChecksumBlockBytes - pending_);
+    crc_ = crc32c(bytes, length, crc_);
+    pending_ += static_cast<uint32_t>(length);
+    bytes += length;
+    size -= length;
+
+    if (pending_ == kChecksumBlockBytes) {
+      write_block(pending_, crc_);
+      crc_ = 0;
+      pending_ = 0;
+    }
+  }
+}
+
+void BlockChecksumWriter::seal() {
+  if (pending_ > 0) {
+    write_block(pending_, crc_);
+    crc_ = 0;
+    pending_ = 0;
+  }
+}
+
+void BlockChecksumWriter::write_block(uint32_t length, uint32_t crc) {
+  const BlockChecksum block{length, crc};
+  file_.write(reinterpret_cast<const char *>(&block), sizeof(block));
+  file_.flush();
+}
+
+} // namespace tick_capture
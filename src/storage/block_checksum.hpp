@@ -0,0 +1,75 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace tick_capture {
+
+// Block checksums of a tick file live in a "<symbol_id>.crc" sidecar next
+// to it, so the tick file stays a plain array of records for its readers.
+// The sidecar is an 8-byte header and then one BlockChecksum per block in
+// file order, each block starting where the one before ended. Blocks are
+// kChecksumBlockBytes long, except the last of a writing session, which is
+// sealed when the session closes its files. Tick file bytes past the last
+// block are not yet sealed and cannot be verified.
+struct BlockChecksum {
+  uint32_t length; // Bytes covered
+  uint32_t crc;    // CRC-32C of those bytes
+};
+
+constexpr uint32_t kChecksumBlockBytes = 64 * 1024; // 1024 ticks
+constexpr size_t kChecksumHeaderBytes = 8;
+
+// The sidecar of a tick file
+std::filesystem::path checksum_path(const std::filesystem::path &tick_path);
+
+// Blocks recorded for a tick file, empty if it has no sidecar. An entry cut
+// short by a writer mid-append is left out. Throws if the sidecar is not
+// one.
+std::vector<BlockChecksum>
+load_block_checksums(const std::filesystem::path &tick_path);
+
+// Maintains the sidecar of one tick file as its data is written. Each
+// block's checksum is appended once the block is full and its data has been
+// written, so a sidecar never covers bytes the tick file does not have.
+// While open it holds a shared flock on the tick file, so tools can tell a
+// file still being written from a closed one.
+class BlockChecksumWriter {
+public:
+  BlockChecksumWriter() = default;
+  ~BlockChecksumWriter();
+
+  // Non-copyable
+  BlockChecksumWriter(const BlockChecksumWriter &) = delete;
+  BlockChecksumWriter &operator=(const BlockChecksumWriter &) = delete;
+
+  // Start the sidecar of tick_path, writing through buffer. With append,
+  // the existing sidecar is extended instead, first sealing any tick file
+  // bytes it does not cover yet, as left by a writer that never sealed.
+  void open(const char *tick_path, bool append, char *buffer,
+            size_t buffer_size);
+
+  // Account for size bytes just written to the tick file
+  void update(const void *data, size_t size);
+
+  // True if update() with size bytes would finish a block, so they must
+  // reach the tick file first
+  bool completes_block(size_t size) const {
+    return pending_ + size >= kChecksumBlockBytes;
+  }
+
+  // Checksum the partial block written so far, so the file can be handed
+  // to another writer or left closed. Later data starts a new block.
+  void seal();
+
+private:
+  void write_block(uint32_t length, uint32_t crc);
+
+  std::ofstream file_;
+  int lock_fd_{-1}; // Tick file, holding the writer's flock
+  uint32_t crc_{0};
+  uint32_t pending_{0}; // Bytes of the current block
+};
+
+} // namespace tick_capture
@@ -0,0 +1,71 @@
+#include "crc32c.hpp"
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+
+namespace tick_capture {
+
+namespace {
+
+using Crc32cFunction = uint32_t (*)(const uint8_t *, size_t, uint32_t);
+
+constexpr uint32_t kPolynomial = 0x82f63b78; // Castagnoli, bit-reversed
+
+constexpr std::array<uint32_t, 256> make_table() {
+  std::array<uint32_t, 256> table{};
+  for (uint32_t i = 0; i < 256; ++i) {
+    uint32_t crc = i;
+    for (int bit = 0; bit < 8; ++bit) {
+      crc = (crc >> 1) ^ (crc & 1 ? kPolynomial : 0);
+    }
+    table[i] = crc;
+  }
+  return table;
+}
+
+constexpr auto kTable = make_table();
+
+uint32_t crc32c_table(const uint8_t *data, size_t size, uint32_t crc) {
+  for (size_t i = 0; i < size; ++i) {
+    crc = kTable[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+  }
+  return crc;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2"))) uint32_t
+crc32c_sse42(const uint8_t *data, size_t size, uint32_t crc) {
+  uint64_t crc64 = crc;
+  for (; size >= 8; data += 8, size -= 8) {
+    uint64_t word;
+    std::memcpy(&word, data, sizeof(word));
+    crc64 = _mm_crc32_u64(crc64, word);
+  }
+  crc = static_cast<uint32_t>(crc64);
+  for (; size > 0; ++data, --size) {
+    crc = _mm_crc32_u8(crc, *data);
+  }
+  return crc;
+}
+#endif
+
+Crc32cFunction select_crc32c() {
+#if defined(__x86_64__)
+  if (__builtin_cpu_supports("sse4.2")) {
+    return crc32c_sse42;
+  }
+#endif
+  return crc32c_table;
+}
+
+} // namespace
+
+uint32_t crc32c(const void *data, size_t size, uint32_t crc) noexcept {
+  static const Crc32cFunction implementation = select_crc32c();
+  return ~implementation(static_cast<const uint8_t *>(data), size, ~crc);
+}
+
+} // namespace tick_capture
@@ -0,0 +1,13 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace tick_capture {
+
+// CRC-32C (Castagnoli) of size bytes at data, continuing from crc: 0 to
+// start, or the result for the bytes before. Uses the SSE4.2 crc32
+// instruction when the CPU has it and a lookup table otherwise; both give
+// the same result.
+uint32_t crc32c(const void *data, size_t size, uint32_t crc = 0) noexcept;
+
+} // namespace tick_capture
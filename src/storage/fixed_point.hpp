@@ -0,0 +1,71 @@
+#pragma once
+#include "../../include/tick_capture/types.hpp"
+#include <algorithm>
+#include <cmath>
+#include <span>
+#include <utility>
+
+namespace tick_capture {
+
+// Fixed-point prices are an int64 count of the symbol's tick size, so equal
+// prices compare equal exactly and range predicates are integer compares.
+
+inline int64_t price_to_fixed(double price, double tick_size) {
+  return std::llround(price / tick_size); // Nearest tick
+}
+
+inline double fixed_to_price(int64_t fixed, double tick_size) {
+  // Divide by whole ticks per unit where there are some, so 10207 ticks of
+  // 0.01 give the double nearest 102.07 rather than 102.07000000000001
+  const double per_unit = std::round(1.0 / tick_size);
+  if (per_unit >= 1 && std::abs(per_unit * tick_size - 1.0) < 1e-12) {
+    return static_cast<double>(fixed) / per_unit;
+  }
+  return static_cast<double>(fixed) * tick_size;
+}
+
+// Whole-tick bounds [low, high] of the fixed prices within [min_price,
+// max_price]; infinite or out-of-range bounds saturate
+inline std::pair<int64_t, int64_t> fixed_range(double min_price,
+                                               double max_price,
+                                               double tick_size) {
+  // Allow for the bounds themselves not dividing exactly into ticks
+  const auto clamp = [](double ticks) {
+    constexpr double limit = 9.2e18; // Within int64
+    return static_cast<int64_t>(std::clamp(ticks, -limit, limit));
+  };
+  return {clamp(std::ceil(min_price / tick_size - 1e-9)),
+          clamp(std::floor(max_price / tick_size + 1e-9))};
+}
+
+// Scans over columns of fixed prices. The loops are branch-free over
+// contiguous int64 so the compiler vectorises them.
+
+// Copy the fixed prices out of stored trades, into a column of at least
+// messages.size() entries
+inline void gather_fixed(std::span<const MarketMessage> messages,
+                         int64_t *out) {
+  for (size_t i = 0; i < messages.size(); ++i) {
+    out[i] = messages[i].trade.price_fixed;
+  }
+}
+
+// Number of prices in [low, high]
+inline size_t count_in_range(std::span<const int64_t> prices, int64_t low,
+                             int64_t high) {
+  size_t count = 0;
+  for (const int64_t p : prices) {
+    count += static_cast<size_t>((p >= low) & (p <= high));
+  }
+  return count;
+}
+
+// out[i] = 1 if prices[i] is in [low, high], else 0
+inline void mask_in_range(std::span<const int64_t> prices, int64_t low,
+                          int64_t high, uint8_t *out) {
+  for (size_t i = 0; i < prices.size(); ++i) {
+    out[i] = static_cast<uint8_t>((prices[i] >= low) & (prices[i] <= high));
+  }
+}
+
+} // namespace tick_capture
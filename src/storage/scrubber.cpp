@@ -0,0 +1,297 @@
+#include "scrubber.hpp"
+#include "../metrics/thread_stats.hpp"
+#include "block_checksum.hpp"
+#include "crc32c.hpp"
+#include "tick_file.hpp"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <fmt/format.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace tick_capture {
+
+namespace {
+
+// True if a BlockChecksumWriter holds the tick file open
+bool being_written(const std::filesystem::path &path) {
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return false;
+  const bool locked = ::flock(fd, LOCK_EX | LOCK_NB) != 0;
+  ::close(fd);
+  return locked;
+}
+
+// Read exactly length bytes at offset, false at end of file
+bool read_at(int fd, char *buffer, size_t length, uint64_t offset) {
+  while (length > 0) {
+    const ssize_t n =
+        ::pread(fd, buffer, length, static_cast<off_t>(offset));
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      throw std::runtime_error(
+          fmt::format("Read failed: {}", std::strerror(errno)));
+    }
+    if (n == 0)
+      return false;
+    buffer += n;
+    length -= static_cast<size_t>(n);
+    offset += static_cast<uint64_t>(n);
+  }
+  return true;
+}
+
+// Drop the pages from first_page on that were not cached before the scrub
+// read them, leaving those someone else was using
+void drop_uncached(int fd, const std::vector<unsigned char> &resident,
+                   uint64_t first_page, uint64_t page_size) {
+  for (size_t i = 0; i < resident.size();) {
+    if (resident[i] & 1) {
+      ++i;
+      continue;
+    }
+    size_t end = i;
+    while (end < resident.size() && !(resident[end] & 1))
+      ++end;
+    ::posix_fadvise(fd, static_cast<off_t>(first_page + i * page_size),
+                    static_cast<off_t>((end - i) * page_size),
+                    POSIX_FADV_DONTNEED);
+    i = end;
+  }
+}
+
+} // namespace
+
+std::string Scrubber::Corruption::to_json() const {
+  return fmt::format(
+      R"({{"type":"corrupt_block","file":"{}","block":{},"offset":{},)"
+      R"("length":{},"expected":"{:08x}","actual":"{:08x}",)"
+      R"("truncated":{},"quarantined":{}}})",
+      file.filename().string(), block, offset, length, expected, actual,
+      truncated, quarantined);
+}
+
+Scrubber::Scrubber(const Config &config, MetricsRegistry *metrics,
+                   const std::string &metrics_prefix)
+    : config_(config), buffer_(kChecksumBlockBytes) {
+  if (metrics) {
+    passes_counter_ = &metrics->counter(metrics_prefix + "passes");
+    bytes_counter_ = &metrics->counter(metrics_prefix + "bytes");
+    corrupt_counter_ = &metrics->counter(metrics_prefix + "corrupt_blocks");
+    quarantined_counter_ = &metrics->counter(metrics_prefix + "quarantined");
+  }
+}
+
+Scrubber::~Scrubber() { stop(); }
+
+void Scrubber::start() {
+  if (running_)
+    return;
+  stop_requested_ = false;
+  running_ = true;
+  thread_ = std::thread([this] {
+    set_thread_name("scrubber");
+    lower_thread_priority();
+    run();
+  });
+}
+
+void Scrubber::stop() {
+  {
+    std::lock_guard<std::mutex> lock(stop_mutex_);
+    if (!running_)
+      return;
+    running_ = false;
+    stop_requested_ = true;
+  }
+  stop_cv_.notify_all();
+
+  if (thread_.joinable())
+    thread_.join();
+}
+
+void Scrubber::run() {
+  while (running_) {
+    const auto pass_start = std::chrono::steady_clock::now();
+    scrub_pass();
+
+    std::unique_lock<std::mutex> lock(stop_mutex_);
+    stop_cv_.wait_until(lock, pass_start + config_.pass_interval,
+                        [this] { return !running_; });
+  }
+}
+
+void Scrubber::scrub_pass() {
+  for (const auto &dir : config_.directories) {
+    if (!std::filesystem::is_directory(dir))
+      continue;
+    for (const auto &path : MappedTickFile::list(dir)) {
+      if (!running_)
+        return;
+      try {
+        scrub_file(path);
+      } catch (const std::exception &e) {
+        fmt::print(stderr, "Scrub of {} failed: {}\n", path.string(),
+                   e.what());
+      }
+    }
+  }
+
+  ++passes_;
+  if (passes_counter_)
+    passes_counter_->add();
+}
+
+std::vector<Scrubber::Corruption>
+Scrubber::scrub_file(const std::filesystem::path &path) {
+  const auto blocks = load_block_checksums(path);
+  std::vector<Corruption> found;
+
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    throw std::runtime_error(fmt::format("Failed to open tick file {}: {}",
+                                         path.string(), std::strerror(errno)));
+  }
+  struct stat st {};
+  ::fstat(fd, &st);
+  const auto size = static_cast<uint64_t>(st.st_size);
+  // No readahead, so every page cached ahead of a block is someone else's
+  ::posix_fadvise(fd, 0, 0, POSIX_FADV_RANDOM);
+
+  // Mapped only to ask which pages are cached; reads go through pread
+  const auto page_size = static_cast<uint64_t>(::sysconf(_SC_PAGESIZE));
+  void *map = size > 0 ? ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0)
+                       : MAP_FAILED;
+  const auto release = [&] {
+    if (map != MAP_FAILED)
+      ::munmap(map, size);
+    ::close(fd);
+  };
+
+  uint64_t offset = 0;
+  try {
+    for (size_t i = 0; i < blocks.size() && !stop_requested_; ++i) {
+      const auto &block = blocks[i];
+      if (buffer_.size() < block.length)
+        buffer_.resize(block.length);
+
+      // Pages of unknown residency count as cached, so are never dropped
+      const uint64_t first_page = offset / page_size * page_size;
+      const uint64_t span = offset + block.length - first_page;
+      resident_.assign((span + page_size - 1) / page_size, 1);
+      if (map != MAP_FAILED && offset + block.length <= size &&
+          ::mincore(static_cast<char *>(map) + first_page, span,
+                    resident_.data()) != 0) {
+        resident_.assign(resident_.size(), 1);
+      }
+
+      if (offset + block.length > size ||
+          !read_at(fd, buffer_.data(), block.length, offset)) {
+        found.push_back({path, i, offset, block.length, block.crc, 0, true,
+                         false});
+        break;
+      }
+      const uint32_t crc = crc32c(buffer_.data(), block.length);
+      drop_uncached(fd, resident_, first_page, page_size);
+      if (crc != block.crc) {
+        found.push_back({path, i, offset, block.length, block.crc, crc,
+                         false, false});
+      }
+
+      offset += block.length;
+      bytes_ += block.length;
+      if (bytes_counter_)
+        bytes_counter_->add(block.length);
+      throttle(block.length);
+    }
+  } catch (...) {
+    release();
+    throw;
+  }
+  release();
+  ++files_;
+
+  if (found.empty())
+    return found;
+
+  corrupt_blocks_ += found.size();
+  if (corrupt_counter_)
+    corrupt_counter_->add(found.size());
+
+  // A file still open for writing is left in place
+  if (config_.quarantine && !being_written(path)) {
+    quarantine(path);
+    for (auto &corruption : found) {
+      corruption.quarantined = true;
+    }
+  }
+
+  for (const auto &corruption : found) {
+    fmt::print(stderr, "Corrupt block {} of {} at offset {}{}{}\n",
+               corruption.block, path.string(), corruption.offset,
+               corruption.truncated ? " (file truncated)" : "",
+               corruption.quarantined ? ", quarantined" : "");
+  }
+  std::lock_guard<std::mutex> lock(corruptions_mutex_);
+  corruptions_.insert(corruptions_.end(), found.begin(), found.end());
+  return found;
+}
+
+void Scrubber::throttle(uint64_t bytes) {
+  if (config_.bytes_per_second == 0)
+    return;
+
+  // Time spent idle is not made up for with a burst of reads
+  const auto now = std::chrono::steady_clock::now();
+  if (next_read_ < now)
+    next_read_ = now;
+  next_read_ += std::chrono::nanoseconds(bytes * 1'000'000'000 /
+                                         config_.bytes_per_second);
+
+  std::unique_lock<std::mutex> lock(stop_mutex_);
+  stop_cv_.wait_until(lock, next_read_,
+                      [this] { return stop_requested_.load(); });
+}
+
+void Scrubber::quarantine(const std::filesystem::path &path) {
+  const auto dir = path.parent_path() / "quarantine";
+  std::filesystem::create_directories(dir);
+
+  // A symbol can be quarantined more than once
+  const auto suffix = fmt::format(
+      ".{}", std::chrono::duration_cast<std::chrono::seconds>(
+                 std::chrono::system_clock::now().time_since_epoch())
+                 .count());
+  const auto checksums = checksum_path(path);
+  std::filesystem::rename(path, dir / (path.filename().string() + suffix));
+  if (std::filesystem::exists(checksums)) {
+    std::filesystem::rename(checksums,
+                            dir / (checksums.filename().string() + suffix));
+  }
+
+  ++quarantined_;
+  if (quarantined_counter_)
+    quarantined_counter_->add();
+}
+
+std::vector<Scrubber::Corruption> Scrubber::take_corruptions() {
+  std::lock_guard<std::mutex> lock(corruptions_mutex_);
+  return std::exchange(corruptions_, {});
+}
+
+Scrubber::Stats Scrubber::get_stats() const {
+  Stats stats;
+  stats.passes = passes_;
+  stats.files = files_;
+  stats.bytes = bytes_;
+  stats.corrupt_blocks = corrupt_blocks_;
+  stats.quarantined = quarantined_;
+  return stats;
+}
+
+} // namespace tick_capture
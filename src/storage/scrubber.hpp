@@ -0,0 +1,115 @@
+#pragma once
+#include "../metrics/metrics_registry.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace tick_capture {
+
+// Background check of stored tick files against their block checksums, so
+// silent corruption is found while another copy can still be fetched,
+// rather than when the data is next read.
+//
+// A thread at idle CPU and I/O priority walks the tick files of each
+// directory, reading every sealed block sequentially, at no more than
+// bytes_per_second so capture keeps the disk, and then waits for the next
+// pass. Pages the scrub brings into the page cache are dropped again once
+// checked, so a pass does not crowd hot data out of it; pages that were
+// already cached, as recent blocks often are, are checked in memory and
+// left there, and their disk copies wait for a pass after eviction. A file
+// with a corrupt block is reported and, with quarantine set, moved with its
+// checksums into the directory's "quarantine" subdirectory, out of sight of
+// readers. Only closed files are moved: one a TickStorage still holds open,
+// known by its writer's flock, is only reported.
+//
+// Counters, if a registry is given: <metrics_prefix>passes, bytes,
+// corrupt_blocks and quarantined.
+class Scrubber {
+public:
+  struct Config {
+    std::vector<std::filesystem::path> directories;
+    uint64_t bytes_per_second{8 * 1024 * 1024}; // 0 = unthrottled
+    std::chrono::seconds pass_interval{3600};   // Start to start
+    bool quarantine{false};
+  };
+
+  struct Corruption {
+    std::filesystem::path file;
+    size_t block;
+    uint64_t offset;
+    uint32_t length;
+    uint32_t expected;
+    uint32_t actual;
+    bool truncated; // The file ends inside the block
+    bool quarantined;
+
+    std::string to_json() const;
+  };
+
+  struct Stats {
+    uint64_t passes{0};
+    uint64_t files{0};
+    uint64_t bytes{0};
+    uint64_t corrupt_blocks{0};
+    uint64_t quarantined{0};
+  };
+
+  explicit Scrubber(const Config &config, MetricsRegistry *metrics = nullptr,
+                    const std::string &metrics_prefix = "scrub.");
+  ~Scrubber();
+
+  // Non-copyable
+  Scrubber(const Scrubber &) = delete;
+  Scrubber &operator=(const Scrubber &) = delete;
+
+  void start();
+  void stop();
+
+  // Check one tick file now on the calling thread, at the configured rate,
+  // quarantining it if configured. Returns its corrupt blocks.
+  std::vector<Corruption> scrub_file(const std::filesystem::path &path);
+
+  // Corruptions found by the scrub thread since the last call, oldest first
+  std::vector<Corruption> take_corruptions();
+
+  Stats get_stats() const;
+
+private:
+  void run();
+  void scrub_pass();
+  void throttle(uint64_t bytes);
+  void quarantine(const std::filesystem::path &path);
+
+  Config config_;
+  std::vector<char> buffer_;            // One block
+  std::vector<unsigned char> resident_; // Its pages cached before reading
+
+  MetricsRegistry::Counter *passes_counter_{nullptr};
+  MetricsRegistry::Counter *bytes_counter_{nullptr};
+  MetricsRegistry::Counter *corrupt_counter_{nullptr};
+  MetricsRegistry::Counter *quarantined_counter_{nullptr};
+
+  std::chrono::steady_clock::time_point next_read_{};
+
+  std::atomic<uint64_t> passes_{0};
+  std::atomic<uint64_t> files_{0};
+  std::atomic<uint64_t> bytes_{0};
+  std::atomic<uint64_t> corrupt_blocks_{0};
+  std::atomic<uint64_t> quarantined_{0};
+
+  std::mutex corruptions_mutex_;
+  std::vector<Corruption> corruptions_;
+
+  std::atomic<bool> running_{false};
+  std::atomic<bool> stop_requested_{false}; // Also ends a scrub_file call
+  std::thread thread_;
+  std::mutex stop_mutex_;
+  std::condition_variable stop_cv_;
+};
+
+} // namespace tick_capture
@@ -0,0 +1,126 @@
+#include "session_meta.hpp"
+#include "../refdata/symbol_master.hpp"
+#include <algorithm>
+#include <fmt/format.h>
+#include <fstream>
+
+namespace tick_capture {
+
+SessionMeta::SessionMeta(PriceEncoding encoding, double default_tick_size)
+    : encoding_(encoding), default_tick_size_(default_tick_size) {
+  if (fixed_point() && default_tick_size_ <= 0) {
+    throw std::runtime_error("Fixed-point prices need a positive tick size");
+  }
+}
+
+SessionMeta SessionMeta::from_config(const CaptureConfig &config,
+                                     const SymbolMaster *symbols) {
+  SessionMeta meta(config.price_encoding, config.fixed_point_tick);
+  if (meta.fixed_point() && symbols) {
+    for (uint32_t id = 1; id <= symbols->max_symbol_id(); ++id) {
+      if (const auto *info = symbols->find(id)) {
+        meta.set_tick_size(id, info->tick_size);
+      }
+    }
+  }
+  return meta;
+}
+
+SessionMeta SessionMeta::load(const std::filesystem::path &dir) {
+  const auto path = dir / kFileName;
+  std::ifstream file(path);
+  if (!file) {
+    return SessionMeta{};
+  }
+
+  SessionMeta meta;
+  std::string line;
+  while (std::getline(file, line)) {
+    const auto eq = line.find('=');
+    if (line.empty() || line[0] == '#' || eq == std::string::npos) {
+      continue;
+    }
+    const std::string key = line.substr(0, eq);
+    const std::string value = line.substr(eq + 1);
+
+    try {
+      if (key == "price_encoding") {
+        if (value == "double") {
+          meta.encoding_ = PriceEncoding::Double;
+        } else if (value == "fixed") {
+          meta.encoding_ = PriceEncoding::FixedPoint;
+        } else {
+          throw std::invalid_argument(value);
+        }
+      } else if (key == "default_tick_size") {
+        meta.default_tick_size_ = std::stod(value);
+      } else if (key.starts_with("tick_size.")) {
+        meta.set_tick_size(static_cast<uint32_t>(std::stoul(key.substr(10))),
+                           std::stod(value));
+      }
+    } catch (const std::exception &) {
+      throw std::runtime_error(
+          fmt::format("Invalid line in {}: {}", path.string(), line));
+    }
+  }
+
+  if (meta.fixed_point() && meta.default_tick_size_ <= 0) {
+    throw std::runtime_error(
+        fmt::format("{} has fixed-point prices but no tick size",
+                    path.string()));
+  }
+  return meta;
+}
+
+void SessionMeta::save(const std::filesystem::path &dir) const {
+  // Write aside and rename, so readers never see a partial file
+  const auto path = dir / kFileName;
+  const auto temp = dir / fmt::format("{}.tmp", kFileName);
+  {
+    std::ofstream file(temp, std::ios::trunc);
+    file << fmt::format("price_encoding={}\n",
+                        fixed_point() ? "fixed" : "double");
+    file << fmt::format("default_tick_size={}\n", default_tick_size_);
+    for (uint32_t id = 0; id < tick_sizes_.size(); ++id) {
+      if (tick_sizes_[id] > 0) {
+        file << fmt::format("tick_size.{}={}\n", id, tick_sizes_[id]);
+      }
+    }
+    if (!file.flush()) {
+      throw std::runtime_error(
+          fmt::format("Failed to write {}", temp.string()));
+    }
+  }
+  std::filesystem::rename(temp, path);
+}
+
+void SessionMeta::set_tick_size(uint32_t symbol_id, double tick_size) {
+  if (tick_size <= 0 || tick_size == default_tick_size_) {
+    return; // Uses the default
+  }
+  if (symbol_id >= tick_sizes_.size()) {
+    tick_sizes_.resize(symbol_id + 1, 0.0);
+  }
+  tick_sizes_[symbol_id] = tick_size;
+}
+
+bool SessionMeta::operator==(const SessionMeta &other) const {
+  if (encoding_ != other.encoding_) {
+    return false;
+  }
+  if (!fixed_point()) {
+    return true; // Tick sizes are unused
+  }
+  if (default_tick_size_ != other.default_tick_size_) {
+    return false;
+  }
+  const size_t n = std::max(tick_sizes_.size(), other.tick_sizes_.size());
+  for (uint32_t id = 0; id < n; ++id) {
+    if (tick_size(id) != other.tick_size(id)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace tick_capture
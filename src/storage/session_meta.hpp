@@ -0,0 +1,71 @@
+#pragma once
+#include "../../include/tick_capture/types.hpp"
+#include "fixed_point.hpp"
+#include <filesystem>
+#include <vector>
+
+namespace tick_capture {
+
+class SymbolMaster;
+
+// Storage settings of one capture session, saved as "session.meta" next to
+// its tick files so readers know how to decode them. A directory without
+// the file holds double prices, as written before the file existed.
+//
+// The file is plain "key=value" lines: price_encoding (double or fixed),
+// default_tick_size and one tick_size.<symbol_id> per symbol whose tick
+// differs from the default.
+class SessionMeta {
+public:
+  static constexpr const char *kFileName = "session.meta";
+
+  SessionMeta() = default;
+  SessionMeta(PriceEncoding encoding, double default_tick_size);
+
+  // Settings for a capture config, with per-symbol tick sizes from the
+  // symbol master if there is one
+  static SessionMeta from_config(const CaptureConfig &config,
+                                 const SymbolMaster *symbols = nullptr);
+
+  static SessionMeta load(const std::filesystem::path &dir);
+  void save(const std::filesystem::path &dir) const;
+
+  PriceEncoding encoding() const { return encoding_; }
+  bool fixed_point() const { return encoding_ == PriceEncoding::FixedPoint; }
+  double default_tick_size() const { return default_tick_size_; }
+
+  void set_tick_size(uint32_t symbol_id, double tick_size);
+  double tick_size(uint32_t symbol_id) const {
+    return symbol_id < tick_sizes_.size() && tick_sizes_[symbol_id] > 0
+               ? tick_sizes_[symbol_id]
+               : default_tick_size_;
+  }
+
+  // Rewrite a captured trade's price in this session's encoding, carrying
+  // the change into its checksum so a bad one stays bad
+  void encode(MarketMessage &msg) const {
+    if (fixed_point()) {
+      constexpr size_t kPrice = offsetof(MarketMessage, trade.price);
+      msg.toggle_checksum(kPrice, sizeof(msg.trade.price));
+      msg.trade.price_fixed =
+          price_to_fixed(msg.trade.price, tick_size(msg.symbol_id));
+      msg.toggle_checksum(kPrice, sizeof(msg.trade.price));
+    }
+  }
+
+  // Price of a stored trade
+  double price(const MarketMessage &msg) const {
+    return fixed_point()
+               ? fixed_to_price(msg.trade.price_fixed, tick_size(msg.symbol_id))
+               : msg.trade.price;
+  }
+
+  bool operator==(const SessionMeta &other) const;
+
+private:
+  PriceEncoding encoding_{PriceEncoding::Double};
+  double default_tick_size_{0.0};
+  std::vector<double> tick_sizes_; // Indexed by symbol id, 0 = default
+};
+
+} // namespace tick_capture
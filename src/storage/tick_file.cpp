@@ -0,0 +1,172 @@
+#include "tick_file.hpp"
+#include "crc32c.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <fmt/format.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace tick_capture {
+
+MappedTickFile::MappedTickFile(const std::filesystem::path &path)
+    : path_(path), symbol_id_(parse_symbol_id(path)) {
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    throw std::runtime_error(fmt::format("Failed to open tick file {}: {}",
+                                         path.string(), std::strerror(errno)));
+  }
+
+  struct stat st {};
+  if (::fstat(fd, &st) != 0) {
+    ::close(fd);
+    throw std::runtime_error(fmt::format("Failed to stat tick file {}: {}",
+                                         path.string(), std::strerror(errno)));
+  }
+
+  // Ignore a trailing partial record from a writer that is mid-append
+  count_ = static_cast<size_t>(st.st_size) / sizeof(MarketMessage);
+  mapped_bytes_ = count_ * sizeof(MarketMessage);
+
+  if (mapped_bytes_ > 0) {
+    void *addr = ::mmap(nullptr, mapped_bytes_, PROT_READ, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
+      ::close(fd);
+      throw std::runtime_error(fmt::format("Failed to map tick file {}: {}",
+                                           path.string(),
+                                           std::strerror(errno)));
+    }
+    // Scans are sequential; let the kernel read ahead aggressively
+    ::madvise(addr, mapped_bytes_, MADV_SEQUENTIAL);
+    data_ = addr;
+  }
+  ::close(fd);
+
+  try {
+    load_blocks();
+  } catch (...) {
+    release();
+    throw;
+  }
+}
+
+void MappedTickFile::load_blocks() {
+  checks_ = std::make_unique<Checks>();
+  uint64_t offset = 0;
+  for (const auto &block : load_block_checksums(path_)) {
+    // Past the mapping: a trailing partial record, or a writer mid-append
+    if (offset + block.length > mapped_bytes_) {
+      break;
+    }
+    checks_->offsets.push_back(offset);
+    checks_->blocks.push_back(block);
+    offset += block.length;
+  }
+  checks_->checked =
+      std::make_unique<std::atomic<bool>[]>(checks_->blocks.size());
+}
+
+size_t MappedTickFile::verify(size_t begin, size_t end) const {
+  end = std::min(end, count_);
+  if (!checks_ || begin >= end) {
+    return end;
+  }
+  const auto &offsets = checks_->offsets;
+  const uint64_t first_byte = begin * sizeof(MarketMessage);
+  const uint64_t end_byte = end * sizeof(MarketMessage);
+
+  // The block holding the first byte, then each that starts before the end
+  size_t index = static_cast<size_t>(
+      std::upper_bound(offsets.begin(), offsets.end(), first_byte) -
+      offsets.begin());
+  index = index > 0 ? index - 1 : 0;
+  const auto *data = static_cast<const char *>(data_);
+  for (; index < offsets.size() && offsets[index] < end_byte; ++index) {
+    if (checks_->checked[index].load(std::memory_order_acquire)) {
+      continue;
+    }
+    const auto &block = checks_->blocks[index];
+    const uint32_t crc = crc32c(data + offsets[index], block.length);
+    if (crc != block.crc) {
+      throw std::runtime_error(fmt::format(
+          "Checksum mismatch in {} block {} at offset {}: expected {:08x}, "
+          "got {:08x}",
+          path_.string(), index, offsets[index], block.crc, crc));
+    }
+    // Threads racing on a block both check it; only one counts it
+    if (!checks_->checked[index].exchange(true, std::memory_order_acq_rel)) {
+      checks_->verified_bytes.fetch_add(block.length,
+                                        std::memory_order_relaxed);
+    }
+  }
+
+  // Past the last sealed block there is nothing left to check
+  if (index == offsets.size()) {
+    return count_;
+  }
+  const uint64_t checked_end = offsets[index - 1] +
+                               checks_->blocks[index - 1].length;
+  return std::max<size_t>(end, checked_end / sizeof(MarketMessage));
+}
+
+MappedTickFile::~MappedTickFile() { release(); }
+
+MappedTickFile::MappedTickFile(MappedTickFile &&other) noexcept
+    : path_(std::move(other.path_)), data_(std::exchange(other.data_, nullptr)),
+      mapped_bytes_(std::exchange(other.mapped_bytes_, 0)),
+      count_(std::exchange(other.count_, 0)),
+      checks_(std::move(other.checks_)),
+      symbol_id_(std::exchange(other.symbol_id_, 0)) {}
+
+MappedTickFile &MappedTickFile::operator=(MappedTickFile &&other) noexcept {
+  if (this != &other) {
+    release();
+    path_ = std::move(other.path_);
+    data_ = std::exchange(other.data_, nullptr);
+    mapped_bytes_ = std::exchange(other.mapped_bytes_, 0);
+    count_ = std::exchange(other.count_, 0);
+    checks_ = std::move(other.checks_);
+    symbol_id_ = std::exchange(other.symbol_id_, 0);
+  }
+  return *this;
+}
+
+void MappedTickFile::release() noexcept {
+  if (data_) {
+    ::munmap(data_, mapped_bytes_);
+    data_ = nullptr;
+  }
+  mapped_bytes_ = 0;
+  count_ = 0;
+  checks_.reset();
+}
+
+uint32_t MappedTickFile::parse_symbol_id(const std::filesystem::path &path) {
+  if (path.extension() != ".tick") {
+    return 0;
+  }
+  try {
+    const auto id = std::stoul(path.stem().string());
+    return id <= UINT32_MAX ? static_cast<uint32_t>(id) : 0;
+  } catch (...) {
+    return 0;
+  }
+}
+
+std::vector<std::filesystem::path>
+MappedTickFile::list(const std::filesystem::path &dir) {
+  std::vector<std::filesystem::path> files;
+  for (const auto &entry : std::filesystem::directory_iterator(dir)) {
+    if (entry.is_regular_file() && parse_symbol_id(entry.path()) != 0) {
+      files.push_back(entry.path());
+    }
+  }
+  std::sort(files.begin(), files.end(), [](const auto &a, const auto &b) {
+    return parse_symbol_id(a) < parse_symbol_id(b);
+  });
+  return files;
+}
+
+} // namespace tick_capture
@@ -0,0 +1,74 @@
+#pragma once
+#include "../../include/tick_capture/types.hpp"
+#include "block_checksum.hpp"
+#include <atomic>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace tick_capture {
+
+// Read-only memory-mapped view of a per-symbol .tick file written by
+// TickStorage. Records are exposed in place, without copying. Readers call
+// verify() for the range they read, which checks the sealed blocks holding
+// it against the file's block checksums, each block once, and throws on a
+// mismatch; unsealed bytes at the end are not checked.
+class MappedTickFile {
+public:
+  explicit MappedTickFile(const std::filesystem::path &path);
+  ~MappedTickFile();
+
+  // Non-copyable, movable
+  MappedTickFile(const MappedTickFile &) = delete;
+  MappedTickFile &operator=(const MappedTickFile &) = delete;
+  MappedTickFile(MappedTickFile &&other) noexcept;
+  MappedTickFile &operator=(MappedTickFile &&other) noexcept;
+
+  std::span<const MarketMessage> messages() const {
+    return {static_cast<const MarketMessage *>(data_), count_};
+  }
+
+  size_t size() const { return count_; }
+
+  // Check the sealed blocks holding messages [begin, end). Returns where
+  // the checked run ends: end or past it, up to the last checked block's
+  // end, or size() once no sealed block is left. Safe to call from several
+  // threads at once.
+  size_t verify(size_t begin, size_t end) const;
+  // Bytes checked against block checksums so far
+  size_t verified_bytes() const {
+    return checks_ ? checks_->verified_bytes.load(std::memory_order_relaxed)
+                   : 0;
+  }
+  uint32_t symbol_id() const { return symbol_id_; }
+  const std::filesystem::path &path() const { return path_; }
+
+  // Parse the symbol id from a "<symbol_id>.tick" file name (0 if invalid)
+  static uint32_t parse_symbol_id(const std::filesystem::path &path);
+
+  // List the tick files of a capture directory, sorted by symbol id
+  static std::vector<std::filesystem::path>
+  list(const std::filesystem::path &dir);
+
+private:
+  // Sealed blocks inside the mapping, in file order
+  struct Checks {
+    std::vector<uint64_t> offsets;
+    std::vector<BlockChecksum> blocks;
+    std::unique_ptr<std::atomic<bool>[]> checked;
+    std::atomic<uint64_t> verified_bytes{0};
+  };
+
+  void release() noexcept;
+  void load_blocks();
+
+  std::filesystem::path path_;
+  void *data_{nullptr};
+  size_t mapped_bytes_{0};
+  size_t count_{0};
+  std::unique_ptr<Checks> checks_;
+  uint32_t symbol_id_{0};
+};
+
+} // namespace tick_capture
@@ -0,0 +1,107 @@
+#include "tick_reader.hpp"
+#include <algorithm>
+#include <unordered_set>
+
+namespace tick_capture {
+
+TickReader::TickReader(const Options &options) {
+  const std::unordered_set<uint32_t> wanted(options.symbols.begin(),
+                                            options.symbols.end());
+
+  // Reserved up front, as cursors point into it
+  metas_.reserve(options.sessions.size());
+  std::vector<const SessionMeta *> file_metas; // Parallel to files_
+  for (const auto &session : options.sessions) {
+    metas_.push_back(SessionMeta::load(session));
+    for (const auto &path : MappedTickFile::list(session)) {
+      if (!wanted.empty() &&
+          !wanted.count(MappedTickFile::parse_symbol_id(path))) {
+        continue;
+      }
+      files_.emplace_back(path);
+      file_metas.push_back(&metas_.back());
+    }
+  }
+
+  heap_.reserve(files_.size());
+  for (size_t i = 0; i < files_.size(); ++i) {
+    const auto messages = window(files_[i], options);
+    if (!messages.empty()) {
+      heap_.push_back({messages.data(), messages.data() + messages.size(),
+                       messages.data(), &files_[i], file_metas[i]});
+    }
+  }
+
+  for (size_t i = heap_.size() / 2; i-- > 0;) {
+    sift_down(i);
+  }
+}
+
+std::span<const MarketMessage> TickReader::window(const MappedTickFile &file,
+                                                 const Options &options) {
+  const auto messages = file.messages();
+  const auto *first = std::partition_point(
+      messages.data(), messages.data() + messages.size(),
+      [&](const MarketMessage &m) {
+        return m.timestamp < options.start_time ||
+               m.sequence_number < options.start_sequence;
+      });
+  const auto *last = std::partition_point(
+      first, messages.data() + messages.size(), [&](const MarketMessage &m) {
+        return m.timestamp < options.end_time &&
+               m.sequence_number < options.end_sequence;
+      });
+  return {first, static_cast<size_t>(last - first)};
+}
+
+const MarketMessage *TickReader::next() {
+  if (heap_.empty()) {
+    return nullptr;
+  }
+
+  auto &top = heap_.front();
+  // Verify each block as the cursor enters it, in the same pass as reading
+  if (top.pos == top.checked) {
+    const MarketMessage *base = top.file->messages().data();
+    const auto index = static_cast<size_t>(top.pos - base);
+    top.checked = base + top.file->verify(index, index + 1);
+  }
+  const MarketMessage *msg = top.pos;
+  current_ = top.meta;
+
+  // Advance the winning cursor in place and restore the heap; this costs a
+  // single sift instead of a pop followed by a push
+  if (++top.pos == top.end) {
+    top = heap_.back();
+    heap_.pop_back();
+  }
+  if (!heap_.empty()) {
+    sift_down(0);
+  }
+
+  ++messages_read_;
+  return msg;
+}
+
+void TickReader::sift_down(size_t index) {
+  const size_t n = heap_.size();
+  const Cursor cursor = heap_[index];
+
+  while (true) {
+    size_t child = 2 * index + 1;
+    if (child >= n) {
+      break;
+    }
+    if (child + 1 < n && before(*heap_[child + 1].pos, *heap_[child].pos)) {
+      ++child;
+    }
+    if (!before(*heap_[child].pos, *cursor.pos)) {
+      break;
+    }
+    heap_[index] = heap_[child];
+    index = child;
+  }
+  heap_[index] = cursor;
+}
+
+} // namespace tick_capture
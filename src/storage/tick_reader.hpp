@@ -0,0 +1,83 @@
+#pragma once
+#include "../../include/tick_capture/types.hpp"
+#include "session_meta.hpp"
+#include "tick_file.hpp"
+#include <limits>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace tick_capture {
+
+// Streams stored ticks from many per-symbol files (optionally across several
+// sessions) as one sequence ordered by (timestamp, sequence_number), using a
+// k-way merge over memory-mapped files. Memory use is one cursor per file,
+// independent of the number of rows. Each checksum block is verified when a
+// cursor first reaches it, so the data is still read in a single pass.
+class TickReader {
+public:
+  struct Options {
+    // Capture directories (TickStorage output_dir) to read
+    std::vector<std::string> sessions;
+
+    // Symbols to include (empty = all symbols found)
+    std::vector<uint32_t> symbols;
+
+    // Timestamp window in ns, [start_time, end_time). Files are appended in
+    // arrival order, so the window is located by binary search per file.
+    uint64_t start_time{0};
+    uint64_t end_time{std::numeric_limits<uint64_t>::max()};
+
+    // Sequence number window, [start_sequence, end_sequence)
+    uint64_t start_sequence{0};
+    uint64_t end_sequence{std::numeric_limits<uint64_t>::max()};
+  };
+
+  explicit TickReader(const Options &options);
+
+  // Non-copyable
+  TickReader(const TickReader &) = delete;
+  TickReader &operator=(const TickReader &) = delete;
+
+  // Next message in merged order, or nullptr once every stream is exhausted.
+  // The pointer refers into the mapped file and stays valid for the lifetime
+  // of the reader. Throws if the message's block fails its checksum.
+  const MarketMessage *next();
+
+  // Session settings of the message last returned by next(), and its price
+  // decoded from the session's encoding
+  const SessionMeta &meta() const { return *current_; }
+  double price(const MarketMessage &msg) const { return current_->price(msg); }
+
+  // Messages of one file that fall inside the options' time and sequence
+  // windows. They are not verified; see MappedTickFile::verify().
+  static std::span<const MarketMessage> window(const MappedTickFile &file,
+                                               const Options &options);
+
+  size_t streams() const { return files_.size(); }
+  uint64_t messages_read() const { return messages_read_; }
+
+private:
+  struct Cursor {
+    const MarketMessage *pos;
+    const MarketMessage *end;
+    const MarketMessage *checked; // End of the verified run from pos
+    const MappedTickFile *file;
+    const SessionMeta *meta;
+  };
+
+  static bool before(const MarketMessage &a, const MarketMessage &b) {
+    return a.timestamp != b.timestamp ? a.timestamp < b.timestamp
+                                      : a.sequence_number < b.sequence_number;
+  }
+
+  void sift_down(size_t index);
+
+  std::vector<SessionMeta> metas_; // One per session
+  std::vector<MappedTickFile> files_;
+  const SessionMeta *current_{nullptr};
+  std::vector<Cursor> heap_; // Min-heap on each cursor's current message
+  uint64_t messages_read_{0};
+};
+
+} // namespace tick_capture
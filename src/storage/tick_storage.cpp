@@ -1,18 +1,58 @@
 #include "tick_storage.hpp"
+#include "../metrics/tracer.hpp"
+#include <climits>
 #include <fmt/format.h>
 
 namespace tick_capture {
 
-TickStorage::TickStorage(const std::string &base_path) : base_path_(base_path) {
+TickStorage::TickStorage(const std::string &base_path, bool append,
+                         uint32_t max_symbol_id, const SessionMeta &meta,
+                         std::chrono::milliseconds flush_interval)
+    : base_path_(base_path), append_(append), max_symbol_id_(max_symbol_id),
+      meta_(meta), flush_interval_(flush_interval), handles_(&arena_, 16),
+      files_(static_cast<size_t>(max_symbol_id) + 1, nullptr, &arena_) {
   std::filesystem::create_directories(base_path_);
+
+  // Ticks already in the files must decode with the same settings
+  if (append_ && !(SessionMeta::load(base_path_) == meta_)) {
+    throw std::runtime_error(
+        fmt::format("Cannot append to {}: it was captured with a different "
+                    "price encoding",
+                    base_path_.string()));
+  }
+  meta_.save(base_path_);
+}
+
+TickStorage::~TickStorage() {
+  for (FileHandle *handle : files_) {
+    // Every byte is in the file before its writer drops the flock
+    if (handle) {
+      handle->file.flush();
+    }
+    handles_.destroy(handle);
+  }
 }
 
 void TickStorage::store(const MarketMessage &msg) {
   try {
     auto &handle = get_file_handle(msg.symbol_id);
-    handle.file->write(reinterpret_cast<const char *>(&msg),
-                       sizeof(MarketMessage));
-    handle.file->flush();
+
+    MarketMessage stored = msg;
+    Tracer::strip(stored);
+    meta_.encode(stored);
+    handle.file.write(reinterpret_cast<const char *>(&stored),
+                      sizeof(MarketMessage));
+    // A block's checksum is only written once its bytes are in the file
+    if (flush_interval_.count() == 0 ||
+        handle.checksums.completes_block(sizeof(MarketMessage))) {
+      flush_file(handle);
+    } else if (!flush_deadlines_.pending(handle.flush_deadline)) {
+      // Two pointers fit std::function's inline storage: no allocation
+      handle.flush_deadline = flush_deadlines_.schedule(
+          std::chrono::steady_clock::now() + flush_interval_,
+          [this, &handle] { flush_file(handle); });
+    }
+    handle.checksums.update(&stored, sizeof(MarketMessage));
 
     const auto total = ++total_messages_;
 
@@ -25,13 +65,35 @@ void TickStorage::store(const MarketMessage &msg) {
   }
 }
 
+void TickStorage::flush_due() {
+  if (flush_deadlines_.size() > 0) {
+    flush_deadlines_.advance(std::chrono::steady_clock::now());
+  }
+}
+
 void TickStorage::flush() {
-  FileMap::accessor acc;
-  for (auto it = files_.begin(); it != files_.end(); ++it) {
-    it->second.file->flush();
+  for (FileHandle *handle : files_) {
+    if (handle) {
+      flush_file(*handle);
+    }
+  }
+}
+
+void TickStorage::seal() {
+  for (FileHandle *handle : files_) {
+    if (handle) {
+      flush_file(*handle);
+      handle->checksums.seal();
+    }
   }
 }
 
+void TickStorage::flush_file(FileHandle &handle) {
+  handle.file.flush();
+  flush_deadlines_.cancel(handle.flush_deadline);
+  handle.flush_deadline = {};
+}
+
 TickStorage::Stats TickStorage::get_stats() const {
   Stats stats;
   stats.messages_stored = total_messages_;
@@ -42,32 +104,52 @@ TickStorage::Stats TickStorage::get_stats() const {
 
 TickStorage::FileHandle &TickStorage::get_file_handle(uint32_t symbol_id) {
   // Validate symbol_id first
-  if (symbol_id == 0 || symbol_id > 10000) {
+  if (symbol_id == 0 || symbol_id > max_symbol_id_) {
     throw std::runtime_error(fmt::format("Invalid symbol_id: {}", symbol_id));
   }
 
-  FileMap::accessor acc;
-  if (!files_.find(acc, symbol_id)) {
-    // Create new file handle
-    auto filepath = base_path_ / fmt::format("{}.tick", symbol_id);
-    fmt::print("Creating new file for symbol {}: {}\n", symbol_id,
-               filepath.string());
-
-    auto file = std::make_unique<std::ofstream>(
-        filepath,
-        std::ios::binary | std::ios::trunc // Start fresh
-    );
-
-    if (!file->is_open()) {
-      throw std::runtime_error(
-          fmt::format("Failed to open file: {}", filepath.string()));
-    }
+  if (FileHandle *handle = files_[symbol_id]) {
+    return *handle;
+  }
 
-    FileHandle handle;
-    handle.file = std::move(file);
-    files_.insert(acc, {symbol_id, std::move(handle)});
+  // Create new file handle, building the path on the stack
+  char filepath[PATH_MAX];
+  const auto path_end =
+      fmt::format_to_n(filepath, sizeof(filepath) - 1, "{}/{}.tick",
+                       base_path_.native(), symbol_id);
+  if (path_end.size >= sizeof(filepath)) {
+    throw std::runtime_error(
+        fmt::format("Tick file path too long in {}", base_path_.string()));
   }
-  return acc->second;
+  *path_end.out = '\0';
+  fmt::print("Creating new file for symbol {}: {}\n", symbol_id, filepath);
+
+  FileHandle *handle = handles_.create();
+  handle->file.rdbuf()->pubsetbuf(
+      static_cast<char *>(arena_.allocate(kWriteBufferSize, 1)),
+      kWriteBufferSize);
+  handle->file.open(filepath,
+                    std::ios::binary |
+                        (append_ ? std::ios::app      // Continue the session
+                                 : std::ios::trunc)); // Start fresh
+
+  if (!handle->file.is_open()) {
+    handles_.destroy(handle);
+    throw std::runtime_error(
+        fmt::format("Failed to open file: {}", filepath));
+  }
+  try {
+    handle->checksums.open(
+        filepath, append_,
+        static_cast<char *>(arena_.allocate(kChecksumBufferSize, 1)),
+        kChecksumBufferSize);
+  } catch (...) {
+    handles_.destroy(handle);
+    throw;
+  }
+
+  files_[symbol_id] = handle;
+  return *handle;
 }
 
 } // namespace tick_capture
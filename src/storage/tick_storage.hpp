@@ -1,22 +1,61 @@
 #pragma once
 #include "../../include/tick_capture/types.hpp"
+#include "../events/timer_wheel.hpp"
+#include "../memory/object_pool.hpp"
+#include "../memory/session_arena.hpp"
+#include "block_checksum.hpp"
+#include "session_meta.hpp"
+#include <atomic>
 #include <filesystem>
 #include <fstream>
-#include <memory>
-#include <tbb/concurrent_hash_map.h>
+#include <memory_resource>
+#include <vector>
 
 namespace tick_capture {
 
+// Per-symbol tick files, each with a sidecar of block checksums (see
+// block_checksum.hpp). Everything the storage keeps per symbol comes from
+// a session arena, so once a symbol's file is open, storing its ticks
+// performs no heap allocation. store() is called from one thread at a time.
+//
+// Each tick is written to its file as it is stored, unless a flush interval
+// is set: then a file's ticks collect in its write buffer until that
+// interval after the first of them, when a deadline on a timer wheel
+// flushes it. The wheel is advanced by flush_due() on the storing thread,
+// as the files are not shared with other threads.
 class TickStorage {
 public:
-  explicit TickStorage(const std::string &base_path);
+  // With append set, existing tick files are extended rather than replaced,
+  // as when taking over a session from a predecessor process. The session
+  // metadata is saved in base_path; an appended session must already use
+  // the same settings.
+  explicit TickStorage(
+      const std::string &base_path, bool append = false,
+      uint32_t max_symbol_id = kDefaultMaxSymbolId,
+      const SessionMeta &meta = SessionMeta{},
+      std::chrono::milliseconds flush_interval = std::chrono::milliseconds(0));
+  ~TickStorage();
 
-  // Store a market message
+  // Non-copyable
+  TickStorage(const TickStorage &) = delete;
+  TickStorage &operator=(const TickStorage &) = delete;
+
+  // Store a market message, encoding its price as the session requires
   void store(const MarketMessage &msg);
 
+  // Flush the files whose deadline has passed. Called by the storing thread
+  // between stores; with no deadline due it only reads the clock.
+  void flush_due();
+
   // Flush all buffers to disk
   void flush();
 
+  // Flush and checksum every partial block, as before another process
+  // appends to the files. Files are also sealed when the storage closes.
+  void seal();
+
+  const SessionMeta &meta() const { return meta_; }
+
   // Get storage statistics
   struct Stats {
     uint64_t messages_stored{0};
@@ -26,16 +65,32 @@ public:
   Stats get_stats() const;
 
 private:
+  // Each file writes through a buffer from the arena rather than one its
+  // filebuf allocates
+  static constexpr size_t kWriteBufferSize = 8192;
+  static constexpr size_t kChecksumBufferSize = 256;
+
   // File handle for each symbol
   struct FileHandle {
-    std::unique_ptr<std::ofstream> file;
+    std::ofstream file;
+    BlockChecksumWriter checksums; // Declared after file: sealed first
+    TimerWheel::Handle flush_deadline; // While ticks wait in the buffer
     size_t messages_written{0};
     size_t bytes_written{0};
   };
 
-  using FileMap = tbb::concurrent_hash_map<uint32_t, FileHandle>;
-  FileMap files_;
   std::filesystem::path base_path_;
+  bool append_;
+  uint32_t max_symbol_id_;
+  SessionMeta meta_;
+  std::chrono::milliseconds flush_interval_;
+  TimerWheel flush_deadlines_;
+
+  // Session-scoped memory: the handle table, handles and write buffers are
+  // allocated once and released with the storage
+  SessionArena arena_;
+  ObjectPool<FileHandle> handles_;
+  std::pmr::vector<FileHandle *> files_; // By symbol id, null until opened
 
   // Statistics
   std::atomic<uint64_t> total_messages_{0};
@@ -44,6 +99,7 @@ private:
 
   // Get or create file handle for symbol
   FileHandle &get_file_handle(uint32_t symbol_id);
+  void flush_file(FileHandle &handle);
 };
 
 } // namespace tick_capture